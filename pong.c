@@ -13,35 +13,21 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
-
-#define WINDOW_WIDTHF (1200.)
-#define WINDOW_HEIGHTF (900.)
-
-// timing constants
-#define FRAME_RATE (60.)
-#define SCORE_DELAY (1.)
-#define RESUME_DELAY (1.)
-
-// game constants
-#define PADDLE_SPEED (4.)
-#define INITIAL_BALL_SPEED (10)
-#define MAX_BALL_SPEED (24.)
-#define BALL_SPEED_ACCELERATION (1.03)
-#define MAX_BOUNCE_ANGLE (60.)
-#define TARGET_SCORE (10.)
-#define PADDLE_HEIGHT (WINDOW_HEIGHTF / 8.)
-#define PADDLE_WIDTH (WINDOW_WIDTHF / 90.)
-#define BALL_RADIUS (WINDOW_WIDTHF / 240.)
-
-// computer aiming probabilities
-#define PROB_TOP (23)
-#define PROB_BOTTOM (23)
-#define PROB_FLAT (15)
-#define PROB_EASY (5)
-#define PROB_AGGRESSIVE (24)
-#define PROB_ERRATIC_UP (5)
-#define PROB_ERRATIC_DOWN (5)
-#define PROB_WEIGHT_SUM (PROB_TOP + PROB_BOTTOM + PROB_FLAT + PROB_EASY + PROB_AGGRESSIVE + PROB_ERRATIC_UP + PROB_ERRATIC_DOWN)
+#include <stdio.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "pong_core.h"
+#include "pong_sync.h"
+#include "pong_render.h"
+#include "pong_scene.h"
+#include "pong_stats.h"
+#include "pong_trace.h"
+#include "pong_record.h"
+#include "pong_rollback.h"
+#include "pong_net.h"
 
 // game colors
 #define BACKGROUND_COLOR 0.,0.,0.
@@ -50,40 +36,29 @@
 #define BUTTON_COLOR 1.,1.,1.
 #define HOVER_BUTTON_COLOR .8,.8,.8
 #define BUTTON_TEXT_COLOR 0.,0.,0.
-#define PADDLE_COLOR 1.,1.,1.
-#define BALL_COLOR 1.,1.,1.
-#define GAME_ENVIRONMENT_COLOR 0.8,0.8,0.8
 
 // derived timings
-#define SEC_PER_FRAME (1000. / (FRAME_RATE))
-#define SCORE_DELAY_MS (1000. * SCORE_DELAY)
-#define RESUME_DELAY_MS (1000. * RESUME_DELAY)
-
-#define max(a, b) ((a) > (b) ? (a) : (b))
-#define min(a, b) ((a) < (b) ? (a) : (b))
-
-// derived game values
-#define MAX_BOUNCE_ANGLE_RAD (M_PI * MAX_BOUNCE_ANGLE / 180.)
-#define COMPUTER_AIMING_TOLERANCE (PADDLE_SPEED)
-#define PADDLE_INVISIBLE_COLLIDER_WIDTH (max(0, MAX_BALL_SPEED - PADDLE_WIDTH))
-#define BALL_DIM (2. * BALL_RADIUS)
-#define MAX_PADDLE_Y (WINDOW_HEIGHTF - PADDLE_HEIGHT)
-#define MIN_PADDLE_Y (0.)
-#define MIDDLE_PADDLE_Y ((MAX_PADDLE_Y - MIN_PADDLE_Y) / 2.)
-#define LEFT_PADDLE_X (50.)
-#define RIGHT_PADDLE_X (WINDOW_WIDTHF - LEFT_PADDLE_X)
-#define INIT_PADDLE_Y (MIDDLE_PADDLE_Y)
-
-// score counter drawing constants
-#define DIGIT_HEIGHT (WINDOW_HEIGHTF / 9.)
-#define DIGIT_STROKE_WEIGHT (WINDOW_WIDTHF / 100.)
-#define DIGIT_WIDTH ((DIGIT_HEIGHT + DIGIT_STROKE_WEIGHT) / 2.)
-#define DIGIT_OFFSET (DIGIT_WIDTH / 2.)
-
-// centerline drawing constants
-#define DASH_HEIGHT (WINDOW_HEIGHTF / 49.)
-#define DASH_WIDTH (WINDOW_WIDTHF / 200.)
-#define DASH_OFFSET (DASH_WIDTH / 2.)
+#define SEC_PER_TICK (1. / (FRAME_RATE))
+// furthest the simulation thread catches up after falling behind, longer stalls are dropped
+#define MAX_FRAME_SEC (.25)
+// input and menu requests waiting for the simulation thread, power of two
+#define COMMAND_QUEUE_SIZE (64)
+
+// latency measurement (--latency)
+// inputs in flight from the simulation thread to the screen, power of two
+#define PROBE_QUEUE_SIZE (64)
+// inputs per paddle waiting for the paddle to change course
+#define MAX_PENDING_INPUTS (8)
+// an input that hasn't changed its paddle's motion by then never will (paused, pinned against a wall)
+#define LATENCY_TIMEOUT_TICKS (FRAME_RATE)
+
+// stats overlay, the percentiles are recomputed every STATS_REFRESH_FRAMES frames
+#define STATS_REFRESH_FRAMES (30)
+#define STATS_FONT_WIDTH (8.)
+#define STATS_FONT_HEIGHT (11.)
+#define STATS_FONT_SPACING (3.)
+#define STATS_LINE_HEIGHT (18.)
+#define STATS_MARGIN (10.)
 
 // button drawing constants
 #define BUTTON_WIDTH (WINDOW_WIDTHF / 2.5)
@@ -98,7 +73,6 @@
 #define BUTTON_FONT_WIDTH (BUTTON_WIDTH / 14.)
 #define BUTTON_FONT_HEIGHT (BUTTON_HEIGHT * 2. / 3.)
 #define BUTTON_FONT_SPACING (BUTTON_FONT_WIDTH / 3.)
-#define BUTTON_FONT_STROKE (BUTTON_FONT_WIDTH / 4.)
 
 // logo drawing constants
 #define LOGO_FONT_WIDTH (BUTTON_WIDTH / 4.)
@@ -106,111 +80,187 @@
 #define LOGO_FONT_SPACING (BUTTON_FONT_WIDTH / 3.)
 #define LOGO_FONT_STROKE (LOGO_FONT_WIDTH / 6.)
 
-// conversion to gl coordinate system
-#define Xpos(x) (((x) * 2. / WINDOW_WIDTHF) - 1.)
-#define Ypos(y) (((y) * 2. / WINDOW_HEIGHTF) - 1.)
+// geometry that never changes for each screen, built once at startup
+vertexBatch menuGeometry, pauseGeometry, gameGeometry;
+// geometry rebuilt every frame
+vertexBatch frameGeometry;
+// batch the drawing helpers add to
+vertexBatch* canvas;
 
-unsigned char leftScore = 0, rightScore = 0;
+// simulation thread state, only touched by the simulation thread once it is running
 
-float ballX = 0, ballY = 0, leftPaddleY = 0, rightPaddleY = 0;
-float ballVelocityX = 0, ballVelocityY = 0;
-float ballSpeed = 0;
+// match and round timers, copied whole into rollback snapshots
+tickState game;
 
-// ball starting direction
-bool leftStart = true;
+// match as of the previous tick, published alongside match so drawing can blend between them
+matchState previousMatch;
 
-// menu management booleans
-bool inPlay = false, menu = true, pauseMenu = false;
+// current keypresses, as last reported over the command queue
+bool upButton = false, specialUpButton = false, downButton = false, specialDownButton = false;
 
-// menu button press management
-bool playerNumberButtonHover = false, playButtonHover = false, resumeButtonHover = false, exitButtonHover = false;
+// true while the game is being played and not paused
+bool running = false;
 
-// current keypresses
-bool upButton = false, specialUpButton = false, downButton = false, specialDownButton = false;
+// game the simulation is playing and whether it has been won
+unsigned int simulatedGame = 0;
+bool gameOver = false;
 
-// used to prevent multiple fixed_update timers being triggered on spamming menu
-int menuInstance = 0;
+// timings of the last tick, in seconds
+double controllerTime = 0, physicsTime = 0, tickLateness = 0;
 
-// gamemode
-enum {
-    ONE_PLAYER = 0, TWO_PLAYER = 1, ZERO_PLAYER = 2
-} gameType = ONE_PLAYER;
+// --record writes each game started from the menu to recordPath, replacing the previous one
+const char* recordPath = NULL;
+uint64_t recordSeed;
+replayWriter recorder;
+bool recording = false;
+
+// --replay plays a recording instead of the controllers until it ends
+replayReader replay;
+bool replaying = false;
+
+// --host and --connect play one game against a peer over UDP, the local player may use either set of keys
+netSession net;
+bool netplaying = false;
+bool desyncReported = false;
 
-// paddle movement directives
+// glut thread state
+
+// menu management booleans
+bool menu = true, pauseMenu = false;
+
+// menu buttons, indexes into widgets
 typedef enum {
-    UP, DOWN, STATIC
-} direction;
+    PLAYER_NUMBER_BUTTON, PLAY_BUTTON, RESUME_BUTTON, EXIT_BUTTON, WIDGET_COUNT, NO_WIDGET = WIDGET_COUNT
+} widgetId;
 
-// computer controlled shot types
 typedef enum {
-    FLAT, TOP, BOTTOM, AGGRESSIVE, EASY, ERRATIC_UP, ERRATIC_DOWN
-} computerShot;
+    MAIN_SCREEN, PAUSE_SCREEN, GAME_SCREEN
+} screenId;
 
-computerShot leftComputerShot = FLAT, rightComputerShot = FLAT;
+/**
+ * a button on one of the menu screens, in window coordinates
+*/
+typedef struct {
+    screenId screen;
+    float x1, y1, x2, y2;
+} widget;
+
+// every button's place, shared by drawing and hit testing
+const widget widgets[WIDGET_COUNT] = {
+    [PLAYER_NUMBER_BUTTON] = {MAIN_SCREEN, WINDOW_WIDTHF / 2 - BUTTON_OFFSET_X, WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y,
+            WINDOW_WIDTHF / 2 + BUTTON_OFFSET_X, WINDOW_HEIGHTF / 2 + BUTTON_OFFSET_Y},
+    [PLAY_BUTTON] = {MAIN_SCREEN, WINDOW_WIDTHF / 2 - BUTTON_OFFSET_X, WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING,
+            WINDOW_WIDTHF / 2 + BUTTON_OFFSET_X, WINDOW_HEIGHTF / 2 + BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING},
+    [RESUME_BUTTON] = {PAUSE_SCREEN, WINDOW_WIDTHF / 2 - PAUSE_BUTTON_OFFSET_X, WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y + BUTTON_SPACING / 2,
+            WINDOW_WIDTHF / 2 + PAUSE_BUTTON_OFFSET_X, WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y + BUTTON_HEIGHT + BUTTON_SPACING / 2},
+    [EXIT_BUTTON] = {PAUSE_SCREEN, WINDOW_WIDTHF / 2 - PAUSE_BUTTON_OFFSET_X, WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING / 2,
+            WINDOW_WIDTHF / 2 + PAUSE_BUTTON_OFFSET_X, WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_SPACING / 2}
+};
+
+// button under the mouse and the last mouse position (flipped like the click coordinates)
+widgetId hoveredWidget = NO_WIDGET;
+int mouseX = -1, mouseY = -1;
+
+// game most recently started from the menu
+unsigned int shownGame = 0;
+
+// frame timings, the overlay's text is refreshed every STATS_REFRESH_FRAMES
+frameStats stats;
+bool statsOverlay = false;
+char statsLines[PHASE_COUNT + 1][64];
+// per frame records for --stats-csv, NULL if not requested
+FILE* statsCsv = NULL;
+double lastDisplayTime = 0;
+
+// gamemode
+typedef enum {
+    ONE_PLAYER = 0, TWO_PLAYER = 1, ZERO_PLAYER = 2
+} gameMode;
+gameMode gameType = ONE_PLAYER;
 
 /**
- * Generates a random shot type for the computer to aim for
+ * everything display needs from one simulation tick
 */
-computerShot getRandomShot() {
-    int r = rand() % PROB_WEIGHT_SUM;
-    if (r < PROB_FLAT) return FLAT;
-    r -= PROB_FLAT;
-    if (r < PROB_TOP) return TOP;
-    r -= PROB_TOP;
-    if (r < PROB_BOTTOM) return BOTTOM;
-    r -= PROB_BOTTOM;
-    if (r < PROB_AGGRESSIVE) return AGGRESSIVE;
-    r -= PROB_AGGRESSIVE;
-    if (r < PROB_EASY) return EASY;
-    r -= PROB_EASY;
-    if (r < PROB_ERRATIC_UP) return ERRATIC_UP;
-    r -= PROB_ERRATIC_UP;
-    return ERRATIC_DOWN;
-}
+typedef struct {
+    matchState match, previous;
+    // monotonic time the tick finished
+    double tickTime;
+    // how long the tick's controllers and physics took and how late it started, in seconds
+    double controllerTime, physicsTime, tickLateness;
+    // simulation thread ticks so far, including this one
+    unsigned long tick;
+    unsigned int game;
+    bool over;
+} frameSnapshot;
+
+// handoff from the simulation thread to the glut thread
+frameSnapshot snapshots[3];
+tripleBuffer frames;
+// snapshot being drawn, refreshed once per frame
+const frameSnapshot* shown;
+
+// keys that can be held
+typedef enum {
+    W_KEY, S_KEY, UP_KEY, DOWN_KEY
+} gameKey;
+
+// requests from the glut thread to the simulation thread
+typedef enum {
+    KEY_PRESS, KEY_RELEASE, START_GAME, PAUSE_GAME, RESUME_GAME, STOP_GAME
+} commandType;
 
 /**
- * Returns the y value of the next time the ball will intersect a paddle
- * pass the current ball position and y velocity
- * Does not need the x velocity
+ * one request to the simulation thread
+ * value is the gameKey for key commands and the gameMode for START_GAME
 */
-float ballIntersectY(float tBallX, float tBallY, float tBallVelocityY) {
-    float yBounceTime;
-    if (tBallVelocityY > 0) {
-        yBounceTime = (WINDOW_HEIGHTF - tBallY) / tBallVelocityY;
-    } else {
-        yBounceTime = tBallY / -tBallVelocityY;
-    }
-    float xBounceTime;
-    if (ballVelocityX < 0) {
-        xBounceTime = (LEFT_PADDLE_X - tBallX) / ballVelocityX;
-    } else {
-        xBounceTime = (RIGHT_PADDLE_X - tBallX) / ballVelocityX;
-    }
+typedef struct {
+    commandType type;
+    int value;
+    // monotonic time the glut thread received it
+    double time;
+} gameCommand;
 
-    // if hits a paddle next, return height of collision
-    if (xBounceTime < yBounceTime) {
-        return tBallY + tBallVelocityY * xBounceTime;
-    }
+gameCommand commandStorage[COMMAND_QUEUE_SIZE];
+spscQueue commands;
 
-    return ballIntersectY(tBallX + ballVelocityX * yBounceTime, (tBallVelocityY > 0) ? WINDOW_HEIGHTF : 0, -tBallVelocityY);
-}
+// measure input to photon latency, set before the simulation thread starts
+bool measureLatency = false;
 
 /**
- * returns the amount to shift the paddle in order to send the ball a specified distance (y value)
- * up or down on the other side
+ * a keyboard input that has moved its paddle, on its way to the screen
 */
-float targetAimingShift(float yChange) {
-    float angle = M_PI / 2. - atan2f(RIGHT_PADDLE_X - LEFT_PADDLE_X, fabsf(yChange));
-    float relY = angle / MAX_BOUNCE_ANGLE_RAD * PADDLE_HEIGHT / 2.;
-    relY = min(relY, PADDLE_HEIGHT / 2 - COMPUTER_AIMING_TOLERANCE);
-    float shift = -copysignf(relY, yChange);
-    return shift;
-}
+typedef struct {
+    // when the glut thread received the input and when the tick that first moved the paddle for it finished
+    double inputTime, tickTime;
+    unsigned long tick;
+} latencyProbe;
+
+latencyProbe probeStorage[PROBE_QUEUE_SIZE];
+spscQueue probes;
+
+// simulation thread: game mode being played, ticks so far
+gameMode simulatedMode = ONE_PLAYER;
+unsigned long tickCount = 0;
+
+// simulation thread: per paddle (left, right) receive times of inputs that haven't moved it yet,
+// the paddle's motion (-1, 0, 1) when the first of them arrived and on the last tick, and when the first arrived
+double pendingInputs[2][MAX_PENDING_INPUTS];
+int pendingCount[2] = {0, 0};
+int pendingMotion[2] = {0, 0}, lastMotion[2] = {0, 0};
+unsigned long pendingSince[2];
+
+// inputs that never showed up on screen, or didn't fit in the queues
+atomic_ulong droppedInputs = 0;
+
+// glut thread: inputs whose tick hasn't been shown yet, and the finished measurements
+latencyProbe unpresented[PROBE_QUEUE_SIZE];
+int unpresentedCount = 0;
+latencyStats latency;
 
 /**
  * paddle controller for one player mode
 */
-direction onePlayerController() {
+direction onePlayerController(matchState* m) {
     if ((downButton || specialDownButton) ^ (upButton || specialUpButton)) {
         if (downButton || specialDownButton) {
             return DOWN;
@@ -224,7 +274,7 @@ direction onePlayerController() {
 /**
  * left paddle controller for two player mode
 */
-direction wasdPlayerController() {
+direction wasdPlayerController(matchState* m) {
     if (downButton ^ upButton) {
         if (downButton) {
             return DOWN;
@@ -238,7 +288,7 @@ direction wasdPlayerController() {
 /**
  * right paddle controller for two player mode
 */
-direction arrowPlayerController() {
+direction arrowPlayerController(matchState* m) {
     if (specialDownButton ^ specialUpButton) {
         if (specialDownButton) {
             return DOWN;
@@ -249,154 +299,383 @@ direction arrowPlayerController() {
     return STATIC;
 }
 
+paddleController leftPaddleController = onePlayerController;
+paddleController rightPaddleController = rightComputerController;
+
 /**
- * computer controller for the left paddle
+ * seconds on the monotonic clock
 */
-direction leftComputerController() {
-    float targetY;
-    if (ballVelocityX > 0 || !inPlay) targetY = MIDDLE_PADDLE_Y;
-    else {
-        if (ballVelocityY == 0) targetY = ballY;
-        else targetY = ballIntersectY(ballX + BALL_RADIUS, ballY + BALL_RADIUS, ballVelocityY);
-        targetY -= PADDLE_HEIGHT / 2;
-        switch (leftComputerShot) {
-            case TOP:
-                targetY += targetAimingShift(MAX_PADDLE_Y - leftPaddleY - PADDLE_HEIGHT / 2.);
-                break;
-            case BOTTOM:
-                targetY += targetAimingShift(-leftPaddleY + PADDLE_HEIGHT / 2.);
-                break;
-            case FLAT:
-                // dummy target
-                break;
-            case AGGRESSIVE:
-                targetY += targetAimingShift(rightPaddleY > MIDDLE_PADDLE_Y ? -leftPaddleY + PADDLE_HEIGHT / 2. : MAX_PADDLE_Y - leftPaddleY - PADDLE_HEIGHT / 2.);
-                break;
-            case EASY:
-                targetY += targetAimingShift(rightPaddleY - leftPaddleY);
-                break;
-            case ERRATIC_UP:
-                targetY -= (PADDLE_HEIGHT / 2) - COMPUTER_AIMING_TOLERANCE;
-                break;
-            case ERRATIC_DOWN:
-                targetY += (PADDLE_HEIGHT / 2) - COMPUTER_AIMING_TOLERANCE;
-                break;
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * sends a request to the simulation thread, glut thread only
+ * the queue is drained every tick so it only fills if the simulation thread is stuck, then the request is dropped
+*/
+void sendCommand(commandType type, int value) {
+    gameCommand c = {type, value, now()};
+    pushQueue(&commands, &c);
+}
+
+/**
+ * closes the game being recorded, final is its last state
+*/
+void stopRecording(const matchState* final) {
+    if (!recording) return;
+    if (!finishReplay(&recorder, final)) fprintf(stderr, "failed to write %s\n", recordPath);
+    recording = false;
+}
+
+/**
+ * starts recording the game from the current match state
+*/
+void startRecording() {
+    stopRecording(&game.match);
+    recording = createReplay(&recorder, recordPath, recordSeed, &game.match);
+}
+
+/**
+ * adds the tick that started in state before to the recording, if there is one
+*/
+void recordTick(const matchState* before, replayTick t) {
+    if (recording) recordReplayTick(&recorder, before, t);
+}
+
+/**
+ * ends playback of a recording as if the game had been won
+*/
+void endReplay() {
+    closeReplay(&replay);
+    replaying = false;
+    resetMatch(&game.match);
+    game.match.inPlay = false;
+    running = false;
+    gameOver = true;
+}
+
+/**
+ * prints how the network held up
+*/
+void printNetReport() {
+    const netStats* s = &net.stats;
+    fprintf(stderr, "netplay: %lu rollbacks (%lu ticks resimulated, deepest %d), %lu stalls, %lu sync waits, "
+            "%lu packets sent, %lu received, %lu state hashes checked\n", s->rollbacks, s->resimulated, s->deepestRollback,
+            s->stalls, s->syncWaits, s->packetsSent, s->packetsReceived, s->hashesChecked);
+}
+
+/**
+ * ends a netplay game as if it had been won, the peer having won, left or dropped
+*/
+void endNetplay() {
+    printNetReport();
+    closeNet(&net);
+    netplaying = false;
+    resetMatch(&game.match);
+    game.match.inPlay = false;
+    running = false;
+    gameOver = true;
+}
+
+/**
+ * starts waiting for a key input to change its paddle's motion, simulation thread only
+*/
+void noteInput(const gameCommand* c) {
+    if (simulatedMode == ZERO_PLAYER) return;
+    // every key drives the left paddle in one player mode, and this side's paddle in netplay
+    int side = netplaying ? !net.host : simulatedMode == TWO_PLAYER && (c->value == UP_KEY || c->value == DOWN_KEY);
+    if (pendingCount[side] == 0) {
+        pendingMotion[side] = lastMotion[side];
+        pendingSince[side] = tickCount;
+    }
+    if (pendingCount[side] < MAX_PENDING_INPUTS) pendingInputs[side][pendingCount[side]++] = c->time;
+    else droppedInputs++;
+}
+
+/**
+ * hands inputs whose paddle changed course this tick to the glut thread, simulation thread only
+ * every input waiting on a paddle is credited to the first tick its motion differs from when the first of them arrived
+*/
+void resolveInputs() {
+    double t = now();
+    float moved[2] = {game.match.leftPaddleY - previousMatch.leftPaddleY, game.match.rightPaddleY - previousMatch.rightPaddleY};
+    for (int side = 0; side < 2; side++) {
+        int motion = (moved[side] > 0) - (moved[side] < 0);
+        lastMotion[side] = motion;
+        if (pendingCount[side] == 0) continue;
+        if (motion != pendingMotion[side]) {
+            for (int i = 0; i < pendingCount[side]; i++) {
+                latencyProbe p = {pendingInputs[side][i], t, tickCount};
+                if (!pushQueue(&probes, &p)) droppedInputs++;
+            }
+            pendingCount[side] = 0;
+        } else if (tickCount - pendingSince[side] >= LATENCY_TIMEOUT_TICKS) {
+            droppedInputs += pendingCount[side];
+            pendingCount[side] = 0;
         }
     }
-    
-    if (leftPaddleY < targetY - COMPUTER_AIMING_TOLERANCE) {
-        return UP;
+}
+
+/**
+ * carries out a request from the glut thread, simulation thread only
+*/
+void applyCommand(const gameCommand* c) {
+    bool pressed = c->type == KEY_PRESS;
+    switch (c->type) {
+        case KEY_PRESS:
+        case KEY_RELEASE: {
+            bool* button = c->value == W_KEY ? &upButton : c->value == S_KEY ? &downButton
+                    : c->value == UP_KEY ? &specialUpButton : c->value == DOWN_KEY ? &specialDownButton : NULL;
+            // a press of a key already held can't change the paddle's course, so it isn't waited on
+            if (!button || *button == pressed) break;
+            if (measureLatency) noteInput(c);
+            *button = pressed;
+            break;
+        }
+        case START_GAME:
+            simulatedMode = c->value;
+            switch ((gameMode) c->value) {
+                case ONE_PLAYER:
+                    leftPaddleController = onePlayerController;
+                    rightPaddleController = rightComputerController;
+                    break;
+                case TWO_PLAYER:
+                    leftPaddleController = wasdPlayerController;
+                    rightPaddleController = arrowPlayerController;
+                    break;
+                case ZERO_PLAYER:
+                    leftPaddleController = leftComputerController;
+                    rightPaddleController = rightComputerController;
+                    break;
+            }
+            hideBall(&game.match);
+            game.match.leftPaddleY = INIT_PADDLE_Y;
+            game.match.rightPaddleY = INIT_PADDLE_Y;
+            // set delay before starting
+            game.serveDelay = RESUME_DELAY_TICKS;
+            game.resumeDelay = 0;
+            simulatedGame++;
+            gameOver = false;
+            running = true;
+            if (recordPath) startRecording();
+            break;
+        case PAUSE_GAME:
+            // a netplay game carries on for the peer, so it keeps running behind the pause menu
+            if (!netplaying) running = false;
+            break;
+        case RESUME_GAME:
+            if (netplaying) break;
+            game.resumeDelay = RESUME_DELAY_TICKS;
+            running = true;
+            break;
+        case STOP_GAME:
+            stopRecording(&game.match);
+            if (replaying) closeReplay(&replay);
+            replaying = false;
+            if (netplaying) {
+                printNetReport();
+                closeNet(&net);
+            }
+            netplaying = false;
+            hideBall(&game.match);
+            resetMatch(&game.match);
+            game.match.inPlay = false;
+            game.serveDelay = 0;
+            running = false;
+            break;
     }
-    if (leftPaddleY > targetY + COMPUTER_AIMING_TOLERANCE) {
-        return DOWN;
+}
+
+/**
+ * runs a paddle controller inside a trace span
+ * when the controller has to predict the ball's intercept, the span records how many wall bounces the prediction covers
+*/
+direction tracedController(paddleController controller, const bool* predicted, const char* name) {
+    traceBegin(name);
+    bool cached = *predicted;
+    direction d = controller(&game.match);
+    if (!cached && *predicted) {
+        traceEndArg(name, "bounces", ballBounces(game.match.ballX + BALL_RADIUS, game.match.ballY + BALL_RADIUS, game.match.ballVelocityX, game.match.ballVelocityY));
+    } else {
+        traceEnd(name);
     }
-    return STATIC;
+    return d;
 }
 
 /**
- * computer controller for the right paddle
+ * advances the game by one fixed tick
+ * round delays count down in ticks so they stay in step with the simulation
 */
-direction rightComputerController() {
-    float targetY;
-    if (ballVelocityX < 0 || !inPlay) targetY = MIDDLE_PADDLE_Y;
-    else {
-        if (ballVelocityY == 0) targetY = ballY;
-        else targetY = ballIntersectY(ballX + BALL_RADIUS, ballY + BALL_RADIUS, ballVelocityY);
-        targetY -= PADDLE_HEIGHT / 2;
-        switch (rightComputerShot) {
-            case TOP:
-                targetY += targetAimingShift(MAX_PADDLE_Y - rightPaddleY - PADDLE_HEIGHT / 2.);
-                break;
-            case BOTTOM:
-                targetY += targetAimingShift(-rightPaddleY + PADDLE_HEIGHT / 2.);
-                break;
-            case FLAT:
-                // dummy target
-                break;
-            case AGGRESSIVE:
-                targetY += targetAimingShift(leftPaddleY > MIDDLE_PADDLE_Y ? -rightPaddleY + PADDLE_HEIGHT / 2. : MAX_PADDLE_Y - rightPaddleY - PADDLE_HEIGHT / 2.);
-                break;
-            case EASY:
-                targetY += targetAimingShift(leftPaddleY - rightPaddleY);
-                break;
-            case ERRATIC_UP:
-                targetY -= (PADDLE_HEIGHT / 2) - COMPUTER_AIMING_TOLERANCE;
-                break;
-            case ERRATIC_DOWN:
-                targetY += (PADDLE_HEIGHT / 2) - COMPUTER_AIMING_TOLERANCE;
-                break;
-        }
+void fixedUpdate() {
+    controllerTime = physicsTime = 0;
+    matchState before;
+    if (recording) before = game.match;
+    bool serve;
+    if (!beginTick(&game, &serve)) {
+        if (game.resumeDelay == 0) traceInstant("resume");
+        recordTick(&before, (replayTick) {STATIC, STATIC, false, true});
+        return;
     }
-    if (rightPaddleY < targetY - COMPUTER_AIMING_TOLERANCE) {
-        return UP;
+    if (serve) {
+        traceInstant("serve");
+        // the ball jumps to the center, don't draw it sliding there
+        previousMatch = game.match;
     }
-    if (rightPaddleY > targetY + COMPUTER_AIMING_TOLERANCE) {
-        return DOWN;
+    double start = now();
+    direction left = tracedController(leftPaddleController, &game.match.leftPredicted, "leftController");
+    direction right = tracedController(rightPaddleController, &game.match.rightPredicted, "rightController");
+    double decided = now();
+    traceBegin("stepMatch");
+    matchEvent event = endTick(&game, (tickInput) {left, right});
+    traceEnd("stepMatch");
+    double stepped = now();
+    controllerTime = decided - start;
+    physicsTime = stepped - decided;
+    recordTick(&before, (replayTick) {left, right, serve, false});
+    switch (event) {
+        case LEFT_WIN:
+        case RIGHT_WIN:
+            stopRecording(&game.match);
+            resetMatch(&game.match);
+            game.match.inPlay = false;
+            running = false;
+            gameOver = true;
+            break;
+        case LEFT_POINT:
+        case RIGHT_POINT:
+            traceInstant("point");
+            break;
+        case NO_EVENT:
+            break;
     }
-    return STATIC;
 }
 
-// paddle controller functions (called to determine direction to move)
-direction (*leftPaddleController)() = onePlayerController;
-direction (*rightPaddleController)() = rightComputerController;
-
 /**
- * increases the speed of the ball
+ * advances a replay by one recorded tick, in place of fixedUpdate
 */
-void accelerateBall() {
-    ballSpeed = min(ballSpeed * BALL_SPEED_ACCELERATION, MAX_BALL_SPEED);
-    float vel = sqrtf(ballVelocityX * ballVelocityX + ballVelocityY * ballVelocityY);
-    vel /= ballSpeed;
-    ballVelocityX /= vel;
-    if (ballVelocityY != 0) ballVelocityY /= vel;
+void replayUpdate() {
+    replayTick t;
+    if (!nextReplayTick(&replay, &t)) {
+        endReplay();
+        return;
+    }
+    if (t.serve) {
+        serveBall(&game.match);
+        previousMatch = game.match;
+    }
+    if (t.idle) return;
+    matchEvent event = stepMatch(&game.match, t.left, t.right);
+    if (event == LEFT_WIN || event == RIGHT_WIN) endReplay();
 }
 
 /**
- * resets the ball position for a new round
+ * advances a netplay game by one tick, in place of fixedUpdate
 */
-void reset(int value) {
-    ballSpeed = INITIAL_BALL_SPEED;
-    ballX = WINDOW_WIDTHF / 2;
-    ballY = WINDOW_HEIGHTF / 2;
-    ballVelocityX = leftStart ? -10. : 10.;
-    ballVelocityY = sinf((float) rand());
-    float vel = sqrtf(ballVelocityX * ballVelocityX + ballVelocityY * ballVelocityY);
-    vel /= ballSpeed;
-    ballVelocityX /= vel;
-    if (ballVelocityY != 0) ballVelocityY /= vel;
-    leftStart = !leftStart;
-    inPlay = true;
-    glutPostRedisplay();
+void netUpdate() {
+    bool wasInPlay = game.match.inPlay;
+    netTick(&net, onePlayerController(&game.match));
+    game = net.state;
+    // the ball jumps to the center on a serve, don't draw it sliding there
+    if (!wasInPlay && game.match.inPlay) previousMatch = game.match;
+    if (net.stats.desynced && !desyncReported) {
+        fprintf(stderr, "netplay: desync, the peers' states differ from tick %lu\n", net.stats.desyncTick);
+        desyncReported = true;
+    }
+    if (net.disconnected) fprintf(stderr, "netplay: peer stopped responding\n");
+    if (net.result != NO_EVENT || net.disconnected) endNetplay();
 }
 
 /**
- * glut callback (see below for definition)
+ * hands the state after a tick to the glut thread without waiting on it
 */
-void fixedUpdate(int);
+void publishFrame() {
+    frameSnapshot* s = tripleBufferBack(&frames);
+    s->match = game.match;
+    s->previous = previousMatch;
+    s->tickTime = now();
+    s->controllerTime = controllerTime;
+    s->physicsTime = physicsTime;
+    s->tickLateness = tickLateness;
+    s->tick = tickCount;
+    s->game = simulatedGame;
+    s->over = gameOver;
+    publishTripleBuffer(&frames);
+}
 
 /**
- * sets state variables for leaving the main menu and entering the game
+ * simulation thread, ticks at FRAME_RATE on absolute deadlines so tick cost and wakeup jitter don't add up
+ * after a long stall (suspend, debugger) the schedule restarts instead of racing to catch up
 */
-void exitMenu() {
-    menu = false;
-    // hide ball
-    ballX = -BALL_DIM;
-    ballY = -BALL_DIM;
-    leftPaddleY = INIT_PADDLE_Y;
-    rightPaddleY = INIT_PADDLE_Y;
-    // set delay before starting
-    glutTimerFunc(RESUME_DELAY_MS, reset, 0);
-    glutTimerFunc(SEC_PER_FRAME, fixedUpdate, menuInstance);
-    glutPostRedisplay();
+void* simulationLoop(void* arg) {
+    traceThreadName("simulation");
+    double next = now();
+    for (;;) {
+        tickLateness = max(now() - next, 0);
+        tickCount++;
+        gameCommand c;
+        while (popQueue(&commands, &c)) applyCommand(&c);
+        previousMatch = game.match;
+        if (running) {
+            traceBegin("fixedUpdate");
+            if (replaying) replayUpdate();
+            else if (netplaying) netUpdate();
+            else fixedUpdate();
+            traceEnd("fixedUpdate");
+        }
+        if (measureLatency) resolveInputs();
+        publishFrame();
+
+        next += SEC_PER_TICK;
+        double t = now();
+        if (t - next > MAX_FRAME_SEC) {
+            next = t;
+        } else if (next > t) {
+            struct timespec deadline = {(time_t) next, (long) ((next - (time_t) next) * 1e9)};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) != 0);
+        }
+    }
+    return NULL;
 }
 
+/**
+ * hover tracking (see below for definition)
+*/
+void updateHover();
+
 /**
  * sets state variables for entering the main menu
 */
 void startMenu() {
     menu = true;
-    inPlay = false;
-    menuInstance++;
+    glutIdleFunc(NULL);
+    updateHover();
+    glutPostRedisplay();
+}
+
+/**
+ * main game loop on the glut thread, idle callback
+ * picks up the newest tick and redraws, buffer swaps pace it to the display
+*/
+void frame() {
+    shown = readTripleBuffer(&frames);
+    if (shown->game == shownGame && shown->over) {
+        startMenu();
+        return;
+    }
+    glutPostRedisplay();
+}
+
+/**
+ * sets state variables for leaving the main menu and entering the game
+*/
+void exitMenu() {
+    menu = false;
+    shownGame++;
+    sendCommand(START_GAME, gameType);
+    glutIdleFunc(frame);
+    updateHover();
     glutPostRedisplay();
 }
 
@@ -405,7 +684,9 @@ void startMenu() {
 */
 void startPauseMenu() {
     pauseMenu = true;
-    menuInstance++;
+    sendCommand(PAUSE_GAME, 0);
+    glutIdleFunc(NULL);
+    updateHover();
     glutPostRedisplay();
 }
 
@@ -414,7 +695,9 @@ void startPauseMenu() {
 */
 void resumeFromPause() {
     pauseMenu = false;
-    glutTimerFunc(RESUME_DELAY_MS, fixedUpdate, menuInstance);
+    sendCommand(RESUME_GAME, 0);
+    glutIdleFunc(frame);
+    updateHover();
     glutPostRedisplay();
 }
 
@@ -423,99 +706,15 @@ void resumeFromPause() {
 */
 void exitFromPause() {
     pauseMenu = false;
-    // hide ball
-    ballX = -BALL_DIM;
-    ballY = -BALL_DIM;
-    ballVelocityX = 0;
-    ballVelocityY = 0;
-    leftPaddleY = rightPaddleY = INIT_PADDLE_Y;
-    leftScore = rightScore = 0;
+    sendCommand(STOP_GAME, 0);
     startMenu();
 }
 
 /**
- * main game loop
- * should execute at frame rate while game is in play
+ * linear blend from a to b
 */
-void fixedUpdate(int value) {
-    if (value != menuInstance) return;
-    direction d = leftPaddleController();
-    if (d == DOWN) {
-        leftPaddleY = max(leftPaddleY - WINDOW_HEIGHTF / 512. * PADDLE_SPEED, MIN_PADDLE_Y);
-    } else if (d == UP) {
-        leftPaddleY = min(leftPaddleY + WINDOW_HEIGHTF / 512. * PADDLE_SPEED, MAX_PADDLE_Y);
-    }
-    d = rightPaddleController();
-    if (d == DOWN) {
-        rightPaddleY = max(rightPaddleY - WINDOW_HEIGHTF / 512. * PADDLE_SPEED, MIN_PADDLE_Y);
-    } else if (d == UP) {
-        rightPaddleY = min(rightPaddleY + WINDOW_HEIGHTF / 512. * PADDLE_SPEED, MAX_PADDLE_Y);
-    }
-
-    ballX += ballVelocityX;
-    ballY += ballVelocityY;
-
-    // only calculate collisions if ball is in play
-    if (inPlay) {
-        // Simple collision resolvers that rely on low speed and small BALL_DIM to be accurate
-        // top and bottom
-        if (ballY + BALL_DIM > WINDOW_HEIGHTF) {
-            ballVelocityY = -ballVelocityY;
-            ballY += ballVelocityY;
-        } else if (ballY < 0) {
-            ballVelocityY = -ballVelocityY;
-            ballY += ballVelocityY;
-        }
-        
-        // paddles
-        if (ballX < LEFT_PADDLE_X && ballX > LEFT_PADDLE_X - PADDLE_INVISIBLE_COLLIDER_WIDTH - PADDLE_WIDTH && ballY + BALL_DIM > leftPaddleY && ballY < leftPaddleY + PADDLE_HEIGHT) {
-            ballX -= ballVelocityX;
-            float relY = ballY + BALL_RADIUS - leftPaddleY - (PADDLE_HEIGHT / 2);
-            relY /= (PADDLE_HEIGHT / 2);
-            float bounceAngle = relY * MAX_BOUNCE_ANGLE_RAD;
-            ballVelocityX = ballSpeed * cosf(bounceAngle);
-            ballVelocityY = ballSpeed * sinf(bounceAngle);
-            ballY += ballVelocityY;
-            leftComputerShot = getRandomShot();
-            accelerateBall();
-        } else if (ballX + BALL_DIM > RIGHT_PADDLE_X && ballX + BALL_DIM < RIGHT_PADDLE_X + PADDLE_WIDTH + PADDLE_INVISIBLE_COLLIDER_WIDTH && ballY + BALL_DIM > rightPaddleY && ballY < rightPaddleY + PADDLE_HEIGHT) {
-            ballX -= ballVelocityX;
-            float relY = ballY + BALL_RADIUS - rightPaddleY - (PADDLE_HEIGHT / 2);
-            relY /= (PADDLE_HEIGHT / 2);
-            float bounceAngle = relY * MAX_BOUNCE_ANGLE_RAD;
-            ballVelocityX = -ballSpeed * cosf(bounceAngle);
-            ballVelocityY = ballSpeed * sinf(bounceAngle);
-            ballY += ballVelocityY;
-            rightComputerShot = getRandomShot();
-            accelerateBall();
-        }
-
-        // score colliders
-        if (ballX < 0) {
-            rightScore++;
-            inPlay = false;
-            if (rightScore == TARGET_SCORE) {
-                leftScore = rightScore = 0;
-                leftPaddleY = rightPaddleY = INIT_PADDLE_Y;
-                startMenu();
-                return;
-            }
-            glutTimerFunc(SCORE_DELAY_MS, reset, 0);
-        } else if (ballX + BALL_DIM > WINDOW_WIDTHF) {
-            leftScore++;
-            inPlay = false;
-            if (leftScore == TARGET_SCORE) {
-                leftScore = rightScore = 0;
-                leftPaddleY = rightPaddleY = INIT_PADDLE_Y;
-                startMenu();
-                return;
-            }
-            glutTimerFunc(SCORE_DELAY_MS, reset, 0);
-        }
-    }
-    
-    glutPostRedisplay();
-    glutTimerFunc(SEC_PER_FRAME, fixedUpdate, value);
+static inline float lerp(float a, float b, float t) {
+    return a + (b - a) * t;
 }
 
 /**
@@ -525,35 +724,64 @@ inline bool inRect(int x, int y, int lbX, int lbY, int ubX, int ubY) {
     return x >= lbX && x <= ubX && y >= lbY && y <= ubY;
 }
 
+/**
+ * screen currently shown
+*/
+screenId currentScreen() {
+    return menu ? MAIN_SCREEN : pauseMenu ? PAUSE_SCREEN : GAME_SCREEN;
+}
+
+/**
+ * button of the current screen at the given (flipped) coords, NO_WIDGET if there is none
+*/
+widgetId widgetAt(int x, int y) {
+    screenId screen = currentScreen();
+    for (int i = 0; i < WIDGET_COUNT; i++) {
+        const widget* w = &widgets[i];
+        if (w->screen == screen && inRect(x, y, w->x1, w->y1, w->x2, w->y2)) return i;
+    }
+    return NO_WIDGET;
+}
+
+/**
+ * hit tests the last mouse position and asks for a redraw only if that changes which button is lit
+ * glut merges redraw requests, so however many events arrive before the next frame it is painted once
+*/
+void updateHover() {
+    widgetId hovered = widgetAt(mouseX, mouseY);
+    if (hovered == hoveredWidget) return;
+    hoveredWidget = hovered;
+    // the game screen redraws every frame anyway
+    if (currentScreen() != GAME_SCREEN) glutPostRedisplay();
+}
+
 void printLogo(int x, int y) {
     // P
-    glRectf(Xpos(x), Ypos(y), Xpos(x + LOGO_FONT_STROKE), Ypos(y + LOGO_FONT_HEIGHT));
-    glRectf(Xpos(x), Ypos(y + LOGO_FONT_HEIGHT - LOGO_FONT_STROKE), Xpos(x + LOGO_FONT_WIDTH), Ypos(y + LOGO_FONT_HEIGHT));
-    glRectf(Xpos(x), Ypos(y + (LOGO_FONT_HEIGHT - LOGO_FONT_STROKE) / 2), Xpos(x + LOGO_FONT_WIDTH), Ypos(y + (LOGO_FONT_HEIGHT + LOGO_FONT_STROKE) / 2));
-    glRectf(Xpos(x + LOGO_FONT_WIDTH - LOGO_FONT_STROKE), Ypos(y + (LOGO_FONT_HEIGHT - LOGO_FONT_STROKE) / 2), Xpos(x + LOGO_FONT_WIDTH), Ypos(y + LOGO_FONT_HEIGHT));
+    pushRect(canvas, x, y, x + LOGO_FONT_STROKE, y + LOGO_FONT_HEIGHT);
+    pushRect(canvas, x, y + LOGO_FONT_HEIGHT - LOGO_FONT_STROKE, x + LOGO_FONT_WIDTH, y + LOGO_FONT_HEIGHT);
+    pushRect(canvas, x, y + (LOGO_FONT_HEIGHT - LOGO_FONT_STROKE) / 2, x + LOGO_FONT_WIDTH, y + (LOGO_FONT_HEIGHT + LOGO_FONT_STROKE) / 2);
+    pushRect(canvas, x + LOGO_FONT_WIDTH - LOGO_FONT_STROKE, y + (LOGO_FONT_HEIGHT - LOGO_FONT_STROKE) / 2, x + LOGO_FONT_WIDTH, y + LOGO_FONT_HEIGHT);
     // O
     x += LOGO_FONT_WIDTH + LOGO_FONT_SPACING;
-    glRectf(Xpos(x), Ypos(y), Xpos(x + LOGO_FONT_STROKE), Ypos(y + LOGO_FONT_HEIGHT));
-    glRectf(Xpos(x + LOGO_FONT_WIDTH - LOGO_FONT_STROKE), Ypos(y), Xpos(x + LOGO_FONT_WIDTH), Ypos(y + LOGO_FONT_HEIGHT));
-    glRectf(Xpos(x), Ypos(y), Xpos(x + LOGO_FONT_WIDTH), Ypos(y + LOGO_FONT_STROKE));
-    glRectf(Xpos(x), Ypos(y + LOGO_FONT_HEIGHT), Xpos(x + LOGO_FONT_WIDTH), Ypos(y + LOGO_FONT_HEIGHT - LOGO_FONT_STROKE));
+    pushRect(canvas, x, y, x + LOGO_FONT_STROKE, y + LOGO_FONT_HEIGHT);
+    pushRect(canvas, x + LOGO_FONT_WIDTH - LOGO_FONT_STROKE, y, x + LOGO_FONT_WIDTH, y + LOGO_FONT_HEIGHT);
+    pushRect(canvas, x, y, x + LOGO_FONT_WIDTH, y + LOGO_FONT_STROKE);
+    pushRect(canvas, x, y + LOGO_FONT_HEIGHT, x + LOGO_FONT_WIDTH, y + LOGO_FONT_HEIGHT - LOGO_FONT_STROKE);
     // N
     x += LOGO_FONT_WIDTH + LOGO_FONT_SPACING;
-    glRectf(Xpos(x), Ypos(y), Xpos(x + LOGO_FONT_STROKE), Ypos(y + LOGO_FONT_HEIGHT));
-    glRectf(Xpos(x + LOGO_FONT_WIDTH), Ypos(y), Xpos(x + LOGO_FONT_WIDTH - LOGO_FONT_STROKE), Ypos(y + LOGO_FONT_HEIGHT));
-    glBegin(GL_QUADS);
-        glVertex2f(Xpos(x + LOGO_FONT_STROKE), Ypos(y + LOGO_FONT_HEIGHT));
-        glVertex2f(Xpos(x + LOGO_FONT_STROKE), Ypos(y + LOGO_FONT_HEIGHT - 1.5 * LOGO_FONT_STROKE));
-        glVertex2f(Xpos(x + LOGO_FONT_WIDTH - LOGO_FONT_STROKE), Ypos(y));
-        glVertex2f(Xpos(x + LOGO_FONT_WIDTH - LOGO_FONT_STROKE), Ypos(y + 1.5 * LOGO_FONT_STROKE));
-    glEnd();
+    pushRect(canvas, x, y, x + LOGO_FONT_STROKE, y + LOGO_FONT_HEIGHT);
+    pushRect(canvas, x + LOGO_FONT_WIDTH, y, x + LOGO_FONT_WIDTH - LOGO_FONT_STROKE, y + LOGO_FONT_HEIGHT);
+    pushVertex(canvas, x + LOGO_FONT_STROKE, y + LOGO_FONT_HEIGHT);
+    pushVertex(canvas, x + LOGO_FONT_STROKE, y + LOGO_FONT_HEIGHT - 1.5 * LOGO_FONT_STROKE);
+    pushVertex(canvas, x + LOGO_FONT_WIDTH - LOGO_FONT_STROKE, y);
+    pushVertex(canvas, x + LOGO_FONT_WIDTH - LOGO_FONT_STROKE, y + 1.5 * LOGO_FONT_STROKE);
     // G
     x += LOGO_FONT_WIDTH + LOGO_FONT_SPACING;
-    glRectf(Xpos(x), Ypos(y), Xpos(x + LOGO_FONT_STROKE), Ypos(y + LOGO_FONT_HEIGHT));
-    glRectf(Xpos(x), Ypos(y + LOGO_FONT_HEIGHT - LOGO_FONT_STROKE), Xpos(x + LOGO_FONT_WIDTH), Ypos(y + LOGO_FONT_HEIGHT));
-    glRectf(Xpos(x), Ypos(y), Xpos(x + LOGO_FONT_WIDTH), Ypos(y + LOGO_FONT_STROKE));
-    glRectf(Xpos(x + LOGO_FONT_WIDTH - LOGO_FONT_STROKE), Ypos(y), Xpos(x + LOGO_FONT_WIDTH), Ypos(y + (LOGO_FONT_HEIGHT + LOGO_FONT_STROKE) / 2));
-    glRectf(Xpos(x + LOGO_FONT_WIDTH / 2), Ypos(y + (LOGO_FONT_HEIGHT - LOGO_FONT_STROKE) / 2), Xpos(x + LOGO_FONT_WIDTH), Ypos(y + (LOGO_FONT_HEIGHT + LOGO_FONT_STROKE) / 2));
+    pushRect(canvas, x, y, x + LOGO_FONT_STROKE, y + LOGO_FONT_HEIGHT);
+    pushRect(canvas, x, y + LOGO_FONT_HEIGHT - LOGO_FONT_STROKE, x + LOGO_FONT_WIDTH, y + LOGO_FONT_HEIGHT);
+    pushRect(canvas, x, y, x + LOGO_FONT_WIDTH, y + LOGO_FONT_STROKE);
+    pushRect(canvas, x + LOGO_FONT_WIDTH - LOGO_FONT_STROKE, y, x + LOGO_FONT_WIDTH, y + (LOGO_FONT_HEIGHT + LOGO_FONT_STROKE) / 2);
+    pushRect(canvas, x + LOGO_FONT_WIDTH / 2, y + (LOGO_FONT_HEIGHT - LOGO_FONT_STROKE) / 2, x + LOGO_FONT_WIDTH, y + (LOGO_FONT_HEIGHT + LOGO_FONT_STROKE) / 2);
 }
 
 inline void printLogoCentered(int x, int y) {
@@ -561,174 +789,152 @@ inline void printLogoCentered(int x, int y) {
 }
 
 /**
- * prints the character c at the given coords
- * WARNING! partial implementation, check code to see if your character is supported
- * Note: prints only uppercase, requires a lowercase char c
+ * prints the string at the given coords in the button font
 */
-void printButtonChar(int x, int y, char c) {
-    switch (c) {
-        case 'a':
-            glRectf(Xpos(x), Ypos(y), Xpos(x + BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-            glRectf(Xpos(x + BUTTON_FONT_WIDTH), Ypos(y), Xpos(x + BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-            glRectf(Xpos(x), Ypos(y + (BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE) / 2), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + (BUTTON_FONT_HEIGHT + BUTTON_FONT_STROKE) / 2));
-            glRectf(Xpos(x), Ypos(y + BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_HEIGHT));
-            break;
-        case 'e':
-            glRectf(Xpos(x), Ypos(y + (BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE) / 2), Xpos(x + 0.75 * BUTTON_FONT_WIDTH), Ypos(y + (BUTTON_FONT_HEIGHT + BUTTON_FONT_STROKE) / 2));
-        case 'c':
-            glRectf(Xpos(x), Ypos(y + BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_HEIGHT));
-        case 'l':
-            glRectf(Xpos(x), Ypos(y), Xpos(x + BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-            glRectf(Xpos(x), Ypos(y), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_STROKE));
-            break;
-        case 'm':
-            glRectf(Xpos(x + (BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE) / 2), Ypos(y), Xpos(x + (BUTTON_FONT_WIDTH + BUTTON_FONT_STROKE) / 2), Ypos(y + BUTTON_FONT_HEIGHT));
-        case 'n':
-            glRectf(Xpos(x), Ypos(y), Xpos(x + BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-            glRectf(Xpos(x), Ypos(y + BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_HEIGHT));
-            glRectf(Xpos(x + BUTTON_FONT_WIDTH), Ypos(y), Xpos(x + BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-            break;
-        case 'o':
-            glRectf(Xpos(x), Ypos(y), Xpos(x + BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-            glRectf(Xpos(x + BUTTON_FONT_WIDTH), Ypos(y), Xpos(x + BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-            glRectf(Xpos(x), Ypos(y), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_STROKE));
-            glRectf(Xpos(x), Ypos(y + BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_HEIGHT));
-            break;
-        case 's':
-            glRectf(Xpos(x), Ypos(y), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_STROKE));
-            glRectf(Xpos(x), Ypos(y + BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_HEIGHT));
-            glRectf(Xpos(x), Ypos(y + (BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE) / 2), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + (BUTTON_FONT_HEIGHT + BUTTON_FONT_STROKE) / 2));
-            glRectf(Xpos(x), Ypos(y + (BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE) / 2), Xpos(x + BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-            glRectf(Xpos(x + BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE), Ypos(y), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + (BUTTON_FONT_HEIGHT + BUTTON_FONT_STROKE) / 2));
-            break;
-        case 'r':
-            glBegin(GL_QUADS);
-                glVertex2f(Xpos(x + 1.5 * BUTTON_FONT_STROKE), Ypos(y + (BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE) / 2));
-                glVertex2f(Xpos(x + 2.5 * BUTTON_FONT_STROKE), Ypos(y + (BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE) / 2));
-                glVertex2f(Xpos(x + BUTTON_FONT_WIDTH), Ypos(y));
-                glVertex2f(Xpos(x + BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE), Ypos(y));
-            glEnd();
-        case 'p':
-            glRectf(Xpos(x), Ypos(y), Xpos(x + BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-            glRectf(Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + (BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE) / 2), Xpos(x + BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-            glRectf(Xpos(x), Ypos(y + (BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE) / 2), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + (BUTTON_FONT_HEIGHT + BUTTON_FONT_STROKE) / 2));
-            glRectf(Xpos(x), Ypos(y + BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_HEIGHT));
-            break;
-        case 'i':
-            glRectf(Xpos(x), Ypos(y), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_STROKE));
-        case 't':
-            glRectf(Xpos(x + (BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE) / 2), Ypos(y), Xpos(x + (BUTTON_FONT_WIDTH + BUTTON_FONT_STROKE) / 2), Ypos(y + BUTTON_FONT_HEIGHT));
-            glRectf(Xpos(x), Ypos(y + BUTTON_FONT_HEIGHT - BUTTON_FONT_STROKE), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_HEIGHT));
-            break;
-        case 'w':
-            glRectf(Xpos(x + (BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE) / 2), Ypos(y), Xpos(x + (BUTTON_FONT_WIDTH + BUTTON_FONT_STROKE) / 2), Ypos(y + BUTTON_FONT_HEIGHT));
-        case 'u':
-            glRectf(Xpos(x), Ypos(y), Xpos(x + BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-            glRectf(Xpos(x), Ypos(y), Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_STROKE));
-            glRectf(Xpos(x + BUTTON_FONT_WIDTH), Ypos(y), Xpos(x + BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-            break;
-        case 'x':
-            glBegin(GL_QUADS);
-                glVertex2f(Xpos(x), Ypos(y));
-                glVertex2f(Xpos(x + BUTTON_FONT_STROKE), Ypos(y));
-                glVertex2f(Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_HEIGHT));
-                glVertex2f(Xpos(x + BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-                glVertex2f(Xpos(x + BUTTON_FONT_WIDTH), Ypos(y));
-                glVertex2f(Xpos(x + BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE), Ypos(y));
-                glVertex2f(Xpos(x), Ypos(y + BUTTON_FONT_HEIGHT));
-                glVertex2f(Xpos(x + BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-            glEnd();
-            break;
-        case 'y':
-            glRectf(Xpos(x + (BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE) / 2), Ypos(y), Xpos(x + (BUTTON_FONT_WIDTH + BUTTON_FONT_STROKE) / 2), Ypos(y + BUTTON_FONT_HEIGHT / 2));
-            glBegin(GL_QUADS);
-                glVertex2f(Xpos(x + (BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE) / 2), Ypos(y + BUTTON_FONT_HEIGHT / 2));
-                glVertex2f(Xpos(x + (BUTTON_FONT_WIDTH + BUTTON_FONT_STROKE) / 2), Ypos(y + BUTTON_FONT_HEIGHT / 2));
-                glVertex2f(Xpos(x + BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-                glVertex2f(Xpos(x), Ypos(y + BUTTON_FONT_HEIGHT));
-                glVertex2f(Xpos(x + (BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE) / 2), Ypos(y + BUTTON_FONT_HEIGHT / 2));
-                glVertex2f(Xpos(x + (BUTTON_FONT_WIDTH + BUTTON_FONT_STROKE) / 2), Ypos(y + BUTTON_FONT_HEIGHT / 2));
-                glVertex2f(Xpos(x + BUTTON_FONT_WIDTH), Ypos(y + BUTTON_FONT_HEIGHT));
-                glVertex2f(Xpos(x + BUTTON_FONT_WIDTH - BUTTON_FONT_STROKE), Ypos(y + BUTTON_FONT_HEIGHT));
-
-            glEnd();
-            break;
-    }
+inline void printButtonString(int x, int y, const char* string) {
+    pushText(canvas, x, y, BUTTON_FONT_WIDTH, BUTTON_FONT_HEIGHT, BUTTON_FONT_SPACING, string);
 }
 
 /**
- * prints the string at the given coords
- * WARNING! partial implementation, check code to see if your character is supported
- * Note: prints only uppercase, requires string be all lowercase
+ * prints the string centered at the given coords in the button font
 */
-inline void printButtonString(int x, int y, const char* string) {
-    while (*string) {
-        printButtonChar(x, y, *string++);
-        x += BUTTON_FONT_SPACING + BUTTON_FONT_WIDTH;
-    }
+inline void printButtonStringCentered(int x, int y, const char* string) {
+    printButtonString(x - textWidth(string, BUTTON_FONT_WIDTH, BUTTON_FONT_SPACING) / 2, y, string);
 }
 
+
 /**
- * prints the string centered at the given coords
- * WARNING! partial implementation, check code to see if your character is supported
- * Note: prints only uppercase, requires string be all lowercase
+ * draws a button's background, shaded if the mouse is over it
 */
-inline void printButtonStringCentered(int x, int y, const char* string) {
-    size_t l = strlen(string);
-    printButtonString(x - (l * BUTTON_FONT_WIDTH + (l - 1) * BUTTON_FONT_SPACING) / 2, y, string);
+void printWidget(widgetId id) {
+    const widget* w = &widgets[id];
+    if (hoveredWidget == id) setVertexColor(canvas, HOVER_BUTTON_COLOR);
+    else setVertexColor(canvas, BUTTON_COLOR);
+    pushRect(canvas, w->x1, w->y1, w->x2, w->y2);
 }
 
 /**
- * prints digit with x and y giving the position of the bottom left corner of the digit
- */
-void printDigit(int x, int y, unsigned char digit) {
-    // bottom bar
-    if (digit == 0 || digit == 2 || digit == 3 || digit == 5 || digit == 6 || digit == 8) {
-        glRectf(Xpos(x), Ypos(y), Xpos(x + DIGIT_WIDTH), Ypos(y + DIGIT_STROKE_WEIGHT));
-    }
-    // middle bar
-    if ((digit >= 2 && digit <= 6) || digit == 8 || digit == 9) {
-        glRectf(Xpos(x), Ypos(y + DIGIT_WIDTH - DIGIT_STROKE_WEIGHT), Xpos(x + DIGIT_WIDTH), Ypos(y + DIGIT_WIDTH));
-    }
-    // top bar
-    if (digit == 0 || digit == 2 || digit == 3 || (digit >= 5 && digit <= 9)) {
-        glRectf(Xpos(x), Ypos(y + DIGIT_HEIGHT), Xpos(x + DIGIT_WIDTH), Ypos(y + DIGIT_HEIGHT - DIGIT_STROKE_WEIGHT));
+ * rebuilds the overlay text from the current window of frames, in microseconds
+*/
+void refreshStatsLines() {
+    snprintf(statsLines[0], sizeof(statsLines[0]), "%-11s %6s %6s %6s", "us", "p50", "p99", "max");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        phaseSummary s = summarizePhase(&stats, p);
+        snprintf(statsLines[p + 1], sizeof(statsLines[p + 1]), "%-11s %6.0f %6.0f %6.0f", phaseNames[p], s.p50 * 1e6, s.p99 * 1e6, s.max * 1e6);
     }
-    // upper left side
-    if (digit == 0 || digit == 4 || digit == 5 || digit == 6 || digit == 8 || digit == 9) {
-        glRectf(Xpos(x + DIGIT_STROKE_WEIGHT), Ypos(y + DIGIT_WIDTH - DIGIT_STROKE_WEIGHT), Xpos(x), Ypos(y + DIGIT_HEIGHT));
+}
+
+/**
+ * adds one game frame's timings to the window and the csv
+ * the tick phases are those of the tick being shown
+*/
+void recordFrameStats(double displayTime, double swapTime, double frameTime) {
+    double durations[PHASE_COUNT] = {
+        [CONTROLLER_PHASE] = shown->controllerTime,
+        [PHYSICS_PHASE] = shown->physicsTime,
+        [TICK_LATENESS_PHASE] = shown->tickLateness,
+        [DISPLAY_PHASE] = displayTime,
+        [SWAP_PHASE] = swapTime,
+        [FRAME_PHASE] = frameTime
+    };
+    recordFrame(&stats, durations);
+    if (stats.frames % STATS_REFRESH_FRAMES == 1) refreshStatsLines();
+    if (statsCsv) {
+        fprintf(statsCsv, "%lu,%.6f", stats.frames, shown->tickTime);
+        for (int p = 0; p < PHASE_COUNT; p++) fprintf(statsCsv, ",%.1f", durations[p] * 1e6);
+        fputc('\n', statsCsv);
     }
-    // lower left side
-    if (digit == 0 || digit == 2 || digit == 6 || digit == 8) {
-        glRectf(Xpos(x), Ypos(y), Xpos(x + DIGIT_STROKE_WEIGHT), Ypos(y + DIGIT_WIDTH));
+}
+
+/**
+ * completes the latency of every input whose tick is in the frame just presented
+*/
+void presentInputs(double presentTime) {
+    latencyProbe p;
+    while (unpresentedCount < PROBE_QUEUE_SIZE && popQueue(&probes, &p)) unpresented[unpresentedCount++] = p;
+    int waiting = 0;
+    for (int i = 0; i < unpresentedCount; i++) {
+        const latencyProbe* q = &unpresented[i];
+        if (q->tick <= shown->tick) recordLatency(&latency, q->inputTime, q->tickTime, presentTime);
+        else unpresented[waiting++] = *q;
     }
-    // upper right side
-    if (!(digit == 5 || digit == 6)) {
-        glRectf(Xpos(x + DIGIT_WIDTH - DIGIT_STROKE_WEIGHT), Ypos(y + DIGIT_HEIGHT), Xpos(x + DIGIT_WIDTH), Ypos(y + DIGIT_WIDTH - DIGIT_STROKE_WEIGHT));
+    unpresentedCount = waiting;
+}
+
+/**
+ * prints the input to photon latency distributions, installed with atexit by --latency
+*/
+void printLatencyReport() {
+    printf("%-17s %7s %7s %7s  (ms over the last %lu of %lu inputs)\n", "latency", "p50", "p99", "max",
+            min(latency.inputs, LATENCY_WINDOW), latency.inputs);
+    for (int leg = 0; leg < LEG_COUNT; leg++) {
+        phaseSummary s = summarizeLatency(&latency, leg);
+        printf("%-17s %7.2f %7.2f %7.2f\n", legNames[leg], s.p50 * 1e3, s.p99 * 1e3, s.max * 1e3);
     }
-    // lower right side
-    if (digit != 2) {
-        glRectf(Xpos(x + DIGIT_WIDTH - DIGIT_STROKE_WEIGHT), Ypos(y), Xpos(x + DIGIT_WIDTH), Ypos(y + DIGIT_WIDTH));
+    printf("%lu inputs never changed a paddle's motion on screen\n", atomic_load(&droppedInputs));
+}
+
+/**
+ * opens the --stats-csv file and writes its header
+ * returns false if it can't be created
+*/
+bool openStatsCsv(const char* path) {
+    statsCsv = fopen(path, "w");
+    if (!statsCsv) {
+        perror(path);
+        return false;
     }
+    fprintf(statsCsv, "frame,tick_time");
+    for (int p = 0; p < PHASE_COUNT; p++) fprintf(statsCsv, ",%s_us", phaseNames[p]);
+    fputc('\n', statsCsv);
+    return true;
+}
+
+/**
+ * builds the geometry that never changes into each screen's cached batch
+*/
+void buildStaticGeometry() {
+    initVertexBatch(&menuGeometry, GL_STATIC_DRAW);
+    initVertexBatch(&pauseGeometry, GL_STATIC_DRAW);
+    initVertexBatch(&gameGeometry, GL_STATIC_DRAW);
+    initVertexBatch(&frameGeometry, GL_STREAM_DRAW);
+
+    canvas = &menuGeometry;
+    // logo
+    setVertexColor(canvas, LOGO_COLOR);
+    printLogoCentered(WINDOW_WIDTHF / 2., WINDOW_HEIGHTF / 2. + BUTTON_OFFSET_Y + BUTTON_SPACING);
+    // play button label
+    setVertexColor(canvas, BUTTON_TEXT_COLOR);
+    printButtonStringCentered(WINDOW_WIDTHF / 2, WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING + (BUTTON_HEIGHT - BUTTON_FONT_HEIGHT) / 2, "play");
+
+    canvas = &pauseGeometry;
+    // button labels
+    setVertexColor(canvas, BUTTON_TEXT_COLOR);
+    printButtonStringCentered(WINDOW_WIDTHF / 2, WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y + BUTTON_SPACING / 2 + (BUTTON_HEIGHT - BUTTON_FONT_HEIGHT) / 2, "resume");
+    printButtonStringCentered(WINDOW_WIDTHF / 2, WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING / 2 + (BUTTON_HEIGHT - BUTTON_FONT_HEIGHT) / 2, "exit");
+    // pause
+    setVertexColor(canvas, TEXT_COLOR);
+    printButtonStringCentered(WINDOW_WIDTHF / 2, WINDOW_HEIGHTF / 2 + BUTTON_SPACING + BUTTON_HEIGHT, "pause");
+
+    // dashes
+    pushCenterLine(&gameGeometry);
 }
 
 /**
- * draws the screen
+ * draws the screen with one draw call for the cached geometry and one for everything that moves
  * glut callback for screen display
 */
 void display() {
+    traceBegin("display");
+    double start = now();
     glClearColor(BACKGROUND_COLOR, 1.);
     glClear(GL_COLOR_BUFFER_BIT);
 
+    clearVertexBatch(&frameGeometry);
+    canvas = &frameGeometry;
     if (menu) {
-        // logo
-        glColor3f(LOGO_COLOR);
-        printLogoCentered(WINDOW_WIDTHF / 2., WINDOW_HEIGHTF / 2. + BUTTON_OFFSET_Y + BUTTON_SPACING);
-
         // player number button
-        if (playerNumberButtonHover) glColor3f(HOVER_BUTTON_COLOR);
-        else glColor3f(BUTTON_COLOR);
-        glRectf(Xpos(WINDOW_WIDTHF / 2 - BUTTON_OFFSET_X), Ypos(WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y), Xpos(WINDOW_WIDTHF / 2 + BUTTON_OFFSET_X), Ypos(WINDOW_HEIGHTF / 2 + BUTTON_OFFSET_Y));
+        printWidget(PLAYER_NUMBER_BUTTON);
         const char* str;
         switch (gameType) {
             case ONE_PLAYER:
@@ -741,54 +947,65 @@ void display() {
                 str = "computer";
                 break;
         }
-        glColor3f(BUTTON_TEXT_COLOR);
+        setVertexColor(canvas, BUTTON_TEXT_COLOR);
         printButtonStringCentered(WINDOW_WIDTHF / 2, WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y + (BUTTON_HEIGHT - BUTTON_FONT_HEIGHT) / 2, str);
 
         // play button
-        if (playButtonHover) glColor3f(HOVER_BUTTON_COLOR);
-        else glColor3f(BUTTON_COLOR);
-        glRectf(Xpos(WINDOW_WIDTHF / 2 - BUTTON_OFFSET_X), Ypos(WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING), Xpos(WINDOW_WIDTHF / 2 + BUTTON_OFFSET_X), Ypos(WINDOW_HEIGHTF / 2 + BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING));
-        glColor3f(BUTTON_TEXT_COLOR);
-        printButtonStringCentered(WINDOW_WIDTHF / 2, WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING + (BUTTON_HEIGHT - BUTTON_FONT_HEIGHT) / 2, "play");
+        printWidget(PLAY_BUTTON);
+
+        // static labels go over the buttons
+        drawVertexBatch(&frameGeometry);
+        drawVertexBatch(&menuGeometry);
     } else if (pauseMenu) {
         // resume button
-        if (resumeButtonHover) glColor3f(HOVER_BUTTON_COLOR);
-        else glColor3f(BUTTON_COLOR);
-        glRectf(Xpos(WINDOW_WIDTHF / 2 - PAUSE_BUTTON_OFFSET_X), Ypos(WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y + BUTTON_SPACING / 2), Xpos(WINDOW_WIDTHF / 2 + PAUSE_BUTTON_OFFSET_X), Ypos(WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y + BUTTON_HEIGHT + BUTTON_SPACING / 2));
-        glColor3f(BUTTON_TEXT_COLOR);
-        printButtonStringCentered(WINDOW_WIDTHF / 2, WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y + BUTTON_SPACING / 2 + (BUTTON_HEIGHT - BUTTON_FONT_HEIGHT) / 2, "resume");
+        printWidget(RESUME_BUTTON);
 
         // exit button
-        if (exitButtonHover) glColor3f(HOVER_BUTTON_COLOR);
-        else glColor3f(BUTTON_COLOR);
-        glRectf(Xpos(WINDOW_WIDTHF / 2 - PAUSE_BUTTON_OFFSET_X), Ypos(WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING / 2), Xpos(WINDOW_WIDTHF / 2 + PAUSE_BUTTON_OFFSET_X), Ypos(WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_SPACING / 2));
-        glColor3f(BUTTON_TEXT_COLOR);
-        printButtonStringCentered(WINDOW_WIDTHF / 2, WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING / 2 + (BUTTON_HEIGHT - BUTTON_FONT_HEIGHT) / 2, "exit");
-
-        // pause
-        glColor3f(TEXT_COLOR);
-        printButtonStringCentered(WINDOW_WIDTHF / 2, WINDOW_HEIGHTF / 2 + BUTTON_SPACING + BUTTON_HEIGHT, "pause");
+        printWidget(EXIT_BUTTON);
+
+        drawVertexBatch(&frameGeometry);
+        drawVertexBatch(&pauseGeometry);
     } else {
-        // paddles
-        glColor3f(PADDLE_COLOR);
-        glRectf(Xpos(LEFT_PADDLE_X - PADDLE_WIDTH), Ypos(leftPaddleY), Xpos(LEFT_PADDLE_X), Ypos(leftPaddleY + PADDLE_HEIGHT));
-        glRectf(Xpos(RIGHT_PADDLE_X), Ypos(rightPaddleY), Xpos(RIGHT_PADDLE_X + PADDLE_WIDTH), Ypos(rightPaddleY + PADDLE_HEIGHT));
-        // scores (left, right)
-        glColor3f(GAME_ENVIRONMENT_COLOR);
-        printDigit((WINDOW_WIDTHF / 2) - DIGIT_OFFSET - DIGIT_WIDTH, WINDOW_HEIGHTF - DIGIT_HEIGHT - DIGIT_OFFSET, leftScore);
-        printDigit((WINDOW_WIDTHF / 2) + DIGIT_OFFSET, WINDOW_HEIGHTF - DIGIT_HEIGHT - DIGIT_OFFSET, rightScore);
-        // dashes
-        float xtmp = (WINDOW_WIDTHF / 2) - DASH_OFFSET;
-        for (float ytmp = 0; ytmp < WINDOW_HEIGHTF; ytmp += 2 * DASH_HEIGHT) {
-            glRectf(Xpos(xtmp), Ypos(ytmp), Xpos(xtmp + DASH_WIDTH), Ypos(ytmp + DASH_HEIGHT));
+        // blend between the last two ticks by how far real time has got into the next one
+        const matchState* m = &shown->match;
+        const matchState* p = &shown->previous;
+        float alpha = min((now() - shown->tickTime) / SEC_PER_TICK, 1.);
+        float leftPaddleY = lerp(p->leftPaddleY, m->leftPaddleY, alpha);
+        float rightPaddleY = lerp(p->rightPaddleY, m->rightPaddleY, alpha);
+        float ballX = lerp(p->ballX, m->ballX, alpha);
+        float ballY = lerp(p->ballY, m->ballY, alpha);
+
+        // paddles, scores and ball
+        pushGamePieces(canvas, leftPaddleY, rightPaddleY, ballX, ballY, m->leftScore, m->rightScore);
+        // timings
+        if (statsOverlay) {
+            setVertexColor(canvas, TEXT_COLOR);
+            for (int i = 0; i <= PHASE_COUNT; i++) {
+                pushText(canvas, STATS_MARGIN, WINDOW_HEIGHTF - STATS_MARGIN - STATS_FONT_HEIGHT - i * STATS_LINE_HEIGHT,
+                        STATS_FONT_WIDTH, STATS_FONT_HEIGHT, STATS_FONT_SPACING, statsLines[i]);
+            }
         }
-        // ball
-        glColor3f(BALL_COLOR);
-        glRectf(Xpos(ballX), Ypos(ballY), Xpos(ballX + BALL_DIM), Ypos(ballY + BALL_DIM));
+
+        // moving pieces go over the centerline
+        drawVertexBatch(&gameGeometry);
+        drawVertexBatch(&frameGeometry);
     }
     
+    double drawn = now();
+    traceBegin("swap");
     glFlush();
     glutSwapBuffers();
+    traceEnd("swap");
+    double swapped = now();
+    if (!menu && !pauseMenu) {
+        if (measureLatency) presentInputs(swapped);
+        recordFrameStats(drawn - start, swapped - drawn, lastDisplayTime > 0 ? start - lastDisplayTime : 0);
+        lastDisplayTime = start;
+    } else {
+        // the first frame after a menu would count the whole time spent in it
+        lastDisplayTime = 0;
+    }
+    traceEnd("display");
 }
 
 /**
@@ -802,8 +1019,8 @@ void reshape(int width, int height) {
  * glut callback for keypresses
 */
 void keypress(unsigned char key, int mouseX, int mouseY) {
-    if (key == 'w') upButton = true;
-    else if (key == 's') downButton = true;
+    if (key == 'w') sendCommand(KEY_PRESS, W_KEY);
+    else if (key == 's') sendCommand(KEY_PRESS, S_KEY);
     else if (key == 27 /*ESC*/) {
         if (!menu) {
             if (pauseMenu) resumeFromPause();
@@ -816,24 +1033,25 @@ void keypress(unsigned char key, int mouseX, int mouseY) {
  * glut callback for special keypresses
 */
 void specialKeypress(int key, int mouseX, int mouseY) {
-    if (key == GLUT_KEY_UP) specialUpButton = true;
-    else if (key == GLUT_KEY_DOWN) specialDownButton = true;
+    if (key == GLUT_KEY_UP) sendCommand(KEY_PRESS, UP_KEY);
+    else if (key == GLUT_KEY_DOWN) sendCommand(KEY_PRESS, DOWN_KEY);
+    else if (key == GLUT_KEY_F3) statsOverlay = !statsOverlay;
 }
 
 /**
  * glut callback for key releases
 */
 void keyrelease(unsigned char key, int mouseX, int mouseY) {
-    if (key == 'w') upButton = false;
-    else if (key == 's') downButton = false;
+    if (key == 'w') sendCommand(KEY_RELEASE, W_KEY);
+    else if (key == 's') sendCommand(KEY_RELEASE, S_KEY);
 }
 
 /**
  * glut callback for special key releases
 */
 void specialKeyrelease(int key, int mouseX, int mouseY) {
-    if (key == GLUT_KEY_UP) specialUpButton = false;
-    else if (key == GLUT_KEY_DOWN) specialDownButton = false;
+    if (key == GLUT_KEY_UP) sendCommand(KEY_RELEASE, UP_KEY);
+    else if (key == GLUT_KEY_DOWN) sendCommand(KEY_RELEASE, DOWN_KEY);
 }
 
 /**
@@ -841,39 +1059,10 @@ void specialKeyrelease(int key, int mouseX, int mouseY) {
  * handles shading buttons when hovered
 */
 void hoverHandler(int x, int y) {
-    if (menu || pauseMenu) {
-        // flip x and y
-        y = WINDOW_HEIGHTF - y;
-        x = WINDOW_WIDTHF - x;
-        if(inRect(x, y, (WINDOW_WIDTHF / 2 - BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y), (WINDOW_WIDTHF / 2 + BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 + BUTTON_OFFSET_Y))) {
-            playerNumberButtonHover = true;
-            glutPostRedisplay();
-        } else if (playerNumberButtonHover) {
-            playerNumberButtonHover = false;
-            glutPostRedisplay();
-        }
-        if(inRect(x, y, (WINDOW_WIDTHF / 2 - BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING), (WINDOW_WIDTHF / 2 + BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 + BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING))) {
-            playButtonHover = true;
-            glutPostRedisplay();
-        } else if (playButtonHover) {
-            playButtonHover = false;
-            glutPostRedisplay();
-        }
-        if(inRect(x, y, (WINDOW_WIDTHF / 2 - PAUSE_BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y + BUTTON_SPACING / 2), (WINDOW_WIDTHF / 2 + PAUSE_BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y + BUTTON_HEIGHT + BUTTON_SPACING / 2))) {
-            resumeButtonHover = true;
-            glutPostRedisplay();
-        } else if (resumeButtonHover) {
-            resumeButtonHover = false;
-            glutPostRedisplay();
-        }
-        if(inRect(x, y, (WINDOW_WIDTHF / 2 - PAUSE_BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING / 2), (WINDOW_WIDTHF / 2 + PAUSE_BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_SPACING / 2))) {
-            exitButtonHover = true;
-            glutPostRedisplay();
-        } else if (exitButtonHover) {
-            exitButtonHover = false;
-            glutPostRedisplay();
-        }
-    }
+    // flip x and y
+    mouseY = WINDOW_HEIGHTF - y;
+    mouseX = WINDOW_WIDTHF - x;
+    updateHover();
 }
 
 /**
@@ -885,52 +1074,156 @@ void clickHandler(int button, int state, int x, int y) {
         // flip x and y
         y = WINDOW_HEIGHTF - y;
         x = WINDOW_WIDTHF - x;
-        if (menu) {
-            if (inRect(x, y, (WINDOW_WIDTHF / 2 - BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y), (WINDOW_WIDTHF / 2 + BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 + BUTTON_OFFSET_Y))) {
-                // player number button
+        switch (widgetAt(x, y)) {
+            case PLAYER_NUMBER_BUTTON:
                 gameType = ++gameType % 3;
-                switch (gameType) {
-                    case ONE_PLAYER:
-                        leftPaddleController = onePlayerController;
-                        rightPaddleController = rightComputerController;
-                        break;
-                    case TWO_PLAYER:
-                        leftPaddleController = wasdPlayerController;
-                        rightPaddleController = arrowPlayerController;
-                        break;
-                    case ZERO_PLAYER:
-                        leftPaddleController = leftComputerController;
-                        rightPaddleController = rightComputerController;
-                        break;
-                }
                 glutPostRedisplay();
-            } else if (inRect(x, y, (WINDOW_WIDTHF / 2 - BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING), (WINDOW_WIDTHF / 2 + BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 + BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING))) {
-                // play button
+                break;
+            case PLAY_BUTTON:
                 exitMenu();
-            }
-        } else if (pauseMenu) {
-            if (inRect(x, y, (WINDOW_WIDTHF / 2 - PAUSE_BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y + BUTTON_SPACING / 2), (WINDOW_WIDTHF / 2 + PAUSE_BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y + BUTTON_HEIGHT + BUTTON_SPACING / 2))) {
-                // resume button
+                break;
+            case RESUME_BUTTON:
                 resumeFromPause();
-            } else if (inRect(x, y, (WINDOW_WIDTHF / 2 - PAUSE_BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_HEIGHT - BUTTON_SPACING / 2), (WINDOW_WIDTHF / 2 + PAUSE_BUTTON_OFFSET_X), (WINDOW_HEIGHTF / 2 - BUTTON_OFFSET_Y - BUTTON_SPACING / 2))) {
-                // exit button
+                break;
+            case EXIT_BUTTON:
                 exitFromPause();
-            }
+                break;
+            default:
+                break;
         }
     }
 }
 
 /**
  * main function, glut init
+ * usage: pong [-c] [-s seed] [--stats-csv file] [--trace file] [--latency] [--record file] [--replay file [--seek tick]] [--host port | --connect host:port] [--input-delay ticks] [--net-delay ms] [--net-loss percent]
+ * --trace writes chrome trace events (chrome://tracing, perfetto) to the file on exit
+ * --latency prints input to photon latency percentiles on exit
+ * --record saves the last game played, --replay plays a saved game in real time from the given tick
+ * --host waits for a peer to --connect and plays it over UDP, the host on the left, with the host's -s, -c and --input-delay
+ * --net-delay and --net-loss hold back and drop this side's packets, for trying out bad connections
+ * F3 toggles the frame timing overlay during a game
 */
-int main(int argc, char* argv) {
-    srand(time(NULL));
-    glutInit(&argc, &argv);
+int main(int argc, char** argv) {
+    glutInit(&argc, argv);
+    uint64_t seed = time(NULL);
+    int opt;
+    bool swept = false;
+    const char* replayPath = NULL;
+    unsigned long seekTick = 0;
+    const char* hostPort = NULL;
+    const char* connectAddress = NULL;
+    int inputDelay = NET_DEFAULT_INPUT_DELAY;
+    netLink link = {0, 0, 0};
+    enum {STATS_CSV_OPTION = 256, TRACE_OPTION, LATENCY_OPTION, RECORD_OPTION, REPLAY_OPTION, SEEK_OPTION,
+        HOST_OPTION, CONNECT_OPTION, INPUT_DELAY_OPTION, NET_DELAY_OPTION, NET_LOSS_OPTION};
+    const struct option longOptions[] = {
+        {"stats-csv", required_argument, NULL, STATS_CSV_OPTION},
+        {"trace", required_argument, NULL, TRACE_OPTION},
+        {"latency", no_argument, NULL, LATENCY_OPTION},
+        {"record", required_argument, NULL, RECORD_OPTION},
+        {"replay", required_argument, NULL, REPLAY_OPTION},
+        {"seek", required_argument, NULL, SEEK_OPTION},
+        {"host", required_argument, NULL, HOST_OPTION},
+        {"connect", required_argument, NULL, CONNECT_OPTION},
+        {"input-delay", required_argument, NULL, INPUT_DELAY_OPTION},
+        {"net-delay", required_argument, NULL, NET_DELAY_OPTION},
+        {"net-loss", required_argument, NULL, NET_LOSS_OPTION},
+        {NULL, 0, NULL, 0}
+    };
+    while ((opt = getopt_long(argc, argv, "cs:", longOptions, NULL)) != -1) {
+        if (opt == 's') {
+            seed = strtoull(optarg, NULL, 10);
+        } else if (opt == 'c') {
+            swept = true;
+        } else if (opt == STATS_CSV_OPTION) {
+            if (!openStatsCsv(optarg)) return 1;
+        } else if (opt == TRACE_OPTION) {
+            if (!startTrace(optarg)) return 1;
+            traceThreadName("glut");
+        } else if (opt == LATENCY_OPTION) {
+            measureLatency = true;
+            resetLatency(&latency);
+            atexit(printLatencyReport);
+        } else if (opt == RECORD_OPTION) {
+            recordPath = optarg;
+        } else if (opt == REPLAY_OPTION) {
+            replayPath = optarg;
+        } else if (opt == SEEK_OPTION) {
+            seekTick = strtoul(optarg, NULL, 10);
+        } else if (opt == HOST_OPTION) {
+            hostPort = optarg;
+        } else if (opt == CONNECT_OPTION) {
+            connectAddress = optarg;
+        } else if (opt == INPUT_DELAY_OPTION) {
+            inputDelay = atoi(optarg);
+        } else if (opt == NET_DELAY_OPTION) {
+            link.delay = atof(optarg) / 1e3;
+        } else if (opt == NET_LOSS_OPTION) {
+            link.loss = atof(optarg) / 100;
+        } else {
+            fprintf(stderr, "usage: %s [-c] [-s seed] [--stats-csv file] [--trace file] [--latency] [--record file] [--replay file [--seek tick]] [--host port | --connect host:port] [--input-delay ticks] [--net-delay ms] [--net-loss percent]\n", argv[0]);
+            return 1;
+        }
+    }
+    resetStats(&stats);
+    refreshStatsLines();
+    initMatch(&game.match, seed);
+    game.match.sweptCollisions = swept;
+    recordSeed = seed;
+    if (replayPath) {
+        if (!openReplay(&replay, replayPath)) return 1;
+        if (!seekReplay(&replay, seekTick, &game.match)) {
+            fprintf(stderr, "%s: tick %lu is past the end\n", replayPath, seekTick);
+            return 1;
+        }
+        // go straight to the game screen
+        replaying = running = true;
+        simulatedGame = shownGame = 1;
+        menu = false;
+    } else if (hostPort || connectAddress) {
+        if (hostPort) {
+            fprintf(stderr, "waiting for a peer on port %s\n", hostPort);
+            netplaying = netHost(&net, atoi(hostPort), seed, swept, inputDelay, link, NULL);
+        } else {
+            char host[256];
+            const char* colon = strrchr(connectAddress, ':');
+            int length = colon ? colon - connectAddress : 0;
+            if (!colon || length >= (int) sizeof(host)) {
+                fprintf(stderr, "--connect takes host:port\n");
+                return 1;
+            }
+            snprintf(host, sizeof(host), "%.*s", length, connectAddress);
+            netplaying = netConnect(&net, host, atoi(colon + 1), link);
+        }
+        if (!netplaying) {
+            fprintf(stderr, "no peer to play\n");
+            return 1;
+        }
+        // go straight to the game screen, the match starts as one from the menu would
+        game = net.state;
+        running = true;
+        simulatedGame = shownGame = 1;
+        menu = false;
+    }
+    previousMatch = game.match;
+
+    // every slot starts out holding the idle match so the first read is always valid
+    for (int i = 0; i < 3; i++) snapshots[i] = (frameSnapshot) {.match = game.match, .previous = game.match, .tickTime = now(), .game = simulatedGame};
+    initTripleBuffer(&frames, &snapshots[0], &snapshots[1], &snapshots[2]);
+    shown = readTripleBuffer(&frames);
+    initQueue(&commands, commandStorage, sizeof(gameCommand), COMMAND_QUEUE_SIZE);
+    initQueue(&probes, probeStorage, sizeof(latencyProbe), PROBE_QUEUE_SIZE);
+
     glutInitWindowSize((int)WINDOW_WIDTHF, (int)WINDOW_HEIGHTF);
     glutInitWindowPosition(100, 100);
     glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE);
 
     glutCreateWindow("Pong");
+    // holding a key sends one press, not a stream of them
+    glutIgnoreKeyRepeat(1);
+    setWindowProjection(WINDOW_WIDTHF, WINDOW_HEIGHTF);
+    buildStaticGeometry();
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
     glutMouseFunc(clickHandler);
@@ -940,6 +1233,13 @@ int main(int argc, char* argv) {
     glutSpecialUpFunc(specialKeyrelease);
     glutMotionFunc(hoverHandler);
     glutPassiveMotionFunc(hoverHandler);
+    if (replaying || netplaying) glutIdleFunc(frame);
+
+    pthread_t simulation;
+    if (pthread_create(&simulation, NULL, simulationLoop, NULL) != 0) {
+        fprintf(stderr, "failed to start simulation thread\n");
+        return 1;
+    }
     
     glutMainLoop();
-}
\ No newline at end of file
+}
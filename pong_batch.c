@@ -0,0 +1,377 @@
+#include "pong_batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BATCH_X86
+#endif
+
+_Static_assert(sizeof(direction) == sizeof(int32_t), "batch kernels load directions as 32 bit lanes");
+_Static_assert(sizeof(matchEvent) == sizeof(int32_t), "batch kernels store events as 32 bit lanes");
+_Static_assert(sizeof(computerShot) == sizeof(int32_t), "batch kernels load shots as 32 bit lanes");
+
+// aiming shots only ever pass targetAimingShift paddle height differences, and paddles start at the middle and
+// move PADDLE_STEP a tick, so those are multiples of 1 / AIM_STEPS_PER_UNIT; the kernels read the shift from here
+#define AIM_STEPS_PER_UNIT (32)
+// every rise up to MAX_PADDLE_Y, larger ones go through the scalar controller
+#define AIM_TABLE_SIZE (25201)
+
+// targetAimingShift of minus every rise before its clamp, exactly as the scalar controllers compute it
+static float aimOffsets[AIM_TABLE_SIZE];
+
+__attribute__((constructor)) static void buildAimOffsets() {
+    // a tolerance of -WINDOW_HEIGHTF puts the clamp out of reach of any bounce angle
+    for (int k = 0; k < AIM_TABLE_SIZE; k++) {
+        aimOffsets[k] = -targetAimingShift((float) k / AIM_STEPS_PER_UNIT, -WINDOW_HEIGHTF);
+    }
+}
+
+/**
+ * one side's computer controller on lane i, reading only the fields it needs straight from the lane arrays
+ * while the ball is out of play or moving away the computer just heads for the middle, as computerTarget
+ * would, so the view is only built for the side the ball is coming at
+*/
+static inline direction laneComputerDirection(matchBatch* b, int i, bool left) {
+    float paddleY = left ? b->leftPaddleY[i] : b->rightPaddleY[i];
+    double tolerance = aimingTolerance(left ? &b->leftConfig[i] : &b->rightConfig[i]);
+    float velocityX = b->ballVelocityX[i];
+    if (!b->inPlay[i] || (left ? velocityX > 0 : velocityX < 0)) return steerPaddle(paddleY, MIDDLE_PADDLE_Y, tolerance);
+    computerView v = {
+        left, b->ballX[i], b->ballY[i], velocityX, b->ballVelocityY[i], true,
+        paddleY, left ? b->rightPaddleY[i] : b->leftPaddleY[i],
+        left ? b->leftComputerShot[i] : b->rightComputerShot[i], tolerance,
+        left ? &b->leftIntercept[i] : &b->rightIntercept[i], left ? &b->leftPredicted[i] : &b->rightPredicted[i]
+    };
+    return computerDirection(&v);
+}
+
+#ifdef BATCH_X86
+
+/**
+ * table[i] for each lane of i, SSE2 has no gather instruction
+*/
+static inline __m128 gatherSse2(const float* table, __m128i i) {
+    int32_t k[4];
+    _mm_storeu_si128((__m128i*) k, i);
+    return _mm_setr_ps(table[k[0]], table[k[1]], table[k[2]], table[k[3]]);
+}
+
+// SSE2 kernel, baseline on every x86-64 cpu
+#define KERNEL_SUFFIX Sse2
+#define VW 4
+#define VF __m128
+#define VI __m128i
+#define VLOAD(p) _mm_load_ps(p)
+#define VSTORE(p, v) _mm_store_ps(p, v)
+#define VSET1(a) _mm_set1_ps(a)
+#define VADD(a, b) _mm_add_ps(a, b)
+#define VSUB(a, b) _mm_sub_ps(a, b)
+#define VMUL(a, b) _mm_mul_ps(a, b)
+#define VMIN(a, b) _mm_min_ps(a, b)
+#define VMAX(a, b) _mm_max_ps(a, b)
+#define VCMPLT(a, b) _mm_cmplt_ps(a, b)
+#define VCMPGT(a, b) _mm_cmpgt_ps(a, b)
+#define VCMPEQ(a, b) _mm_cmpeq_ps(a, b)
+#define VAND(a, b) _mm_and_ps(a, b)
+#define VOR(a, b) _mm_or_ps(a, b)
+#define VANDNOT(a, b) _mm_andnot_ps(a, b)
+#define VBLEND(a, b, m) _mm_or_ps(_mm_and_ps(m, b), _mm_andnot_ps(m, a))
+#define VMOVEMASK(a) _mm_movemask_ps(a)
+#define VILOAD(p) _mm_load_si128((const __m128i*) (p))
+#define VISTORE(p, v) _mm_store_si128((__m128i*) (p), v)
+#define VISET1(a) _mm_set1_epi32(a)
+#define VISUB(a, b) _mm_sub_epi32(a, b)
+#define VICMPEQ(a, b) _mm_cmpeq_epi32(a, b)
+#define VIAND(a, b) _mm_and_si128(a, b)
+#define VIOR(a, b) _mm_or_si128(a, b)
+#define VIANDNOT(a, b) _mm_andnot_si128(a, b)
+#define VICMPGT(a, b) _mm_cmpgt_epi32(a, b)
+#define VICAST(a) _mm_castsi128_ps(a)
+#define VFCAST(a) _mm_castps_si128(a)
+#define VCVTTI(a) _mm_cvttps_epi32(a)
+#define VCVTIF(a) _mm_cvtepi32_ps(a)
+#define VGATHER(table, i) gatherSse2(table, i)
+#define VDW 2
+#define VD __m128d
+#define VDLOAD(p) _mm_loadu_pd(p)
+#define VDSET1(a) _mm_set1_pd(a)
+#define VDADD(a, b) _mm_add_pd(a, b)
+#define VDSUB(a, b) _mm_sub_pd(a, b)
+#define VDCMPLT(a, b) _mm_cmplt_pd(a, b)
+#define VDCMPGT(a, b) _mm_cmpgt_pd(a, b)
+#define VDMOVEMASK(a) _mm_movemask_pd(a)
+#define VDLO(a) _mm_cvtps_pd(a)
+#define VDHI(a) _mm_cvtps_pd(_mm_movehl_ps(a, a))
+#define VDTOF(lo, hi) _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi))
+#include "pong_batch_kernel.h"
+#undef KERNEL_SUFFIX
+#undef VW
+#undef VF
+#undef VI
+#undef VLOAD
+#undef VSTORE
+#undef VSET1
+#undef VADD
+#undef VSUB
+#undef VMUL
+#undef VMIN
+#undef VMAX
+#undef VCMPLT
+#undef VCMPGT
+#undef VCMPEQ
+#undef VAND
+#undef VOR
+#undef VANDNOT
+#undef VBLEND
+#undef VMOVEMASK
+#undef VILOAD
+#undef VISTORE
+#undef VISET1
+#undef VISUB
+#undef VICMPEQ
+#undef VIAND
+#undef VIOR
+#undef VIANDNOT
+#undef VICMPGT
+#undef VICAST
+#undef VFCAST
+#undef VCVTTI
+#undef VCVTIF
+#undef VGATHER
+#undef VDW
+#undef VD
+#undef VDLOAD
+#undef VDSET1
+#undef VDADD
+#undef VDSUB
+#undef VDCMPLT
+#undef VDCMPGT
+#undef VDMOVEMASK
+#undef VDLO
+#undef VDHI
+#undef VDTOF
+
+// AVX2 kernel, selected at runtime
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#define KERNEL_SUFFIX Avx2
+#define VW 8
+#define VF __m256
+#define VI __m256i
+#define VLOAD(p) _mm256_load_ps(p)
+#define VSTORE(p, v) _mm256_store_ps(p, v)
+#define VSET1(a) _mm256_set1_ps(a)
+#define VADD(a, b) _mm256_add_ps(a, b)
+#define VSUB(a, b) _mm256_sub_ps(a, b)
+#define VMUL(a, b) _mm256_mul_ps(a, b)
+#define VMIN(a, b) _mm256_min_ps(a, b)
+#define VMAX(a, b) _mm256_max_ps(a, b)
+#define VCMPLT(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define VCMPGT(a, b) _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define VCMPEQ(a, b) _mm256_cmp_ps(a, b, _CMP_EQ_OQ)
+#define VAND(a, b) _mm256_and_ps(a, b)
+#define VOR(a, b) _mm256_or_ps(a, b)
+#define VANDNOT(a, b) _mm256_andnot_ps(a, b)
+#define VBLEND(a, b, m) _mm256_blendv_ps(a, b, m)
+#define VMOVEMASK(a) _mm256_movemask_ps(a)
+#define VILOAD(p) _mm256_load_si256((const __m256i*) (p))
+#define VISTORE(p, v) _mm256_store_si256((__m256i*) (p), v)
+#define VISET1(a) _mm256_set1_epi32(a)
+#define VISUB(a, b) _mm256_sub_epi32(a, b)
+#define VICMPEQ(a, b) _mm256_cmpeq_epi32(a, b)
+#define VIAND(a, b) _mm256_and_si256(a, b)
+#define VIOR(a, b) _mm256_or_si256(a, b)
+#define VIANDNOT(a, b) _mm256_andnot_si256(a, b)
+#define VICMPGT(a, b) _mm256_cmpgt_epi32(a, b)
+#define VICAST(a) _mm256_castsi256_ps(a)
+#define VFCAST(a) _mm256_castps_si256(a)
+#define VCVTTI(a) _mm256_cvttps_epi32(a)
+#define VCVTIF(a) _mm256_cvtepi32_ps(a)
+#define VGATHER(table, i) _mm256_i32gather_ps(table, i, 4)
+#define VDW 4
+#define VD __m256d
+#define VDLOAD(p) _mm256_loadu_pd(p)
+#define VDSET1(a) _mm256_set1_pd(a)
+#define VDADD(a, b) _mm256_add_pd(a, b)
+#define VDSUB(a, b) _mm256_sub_pd(a, b)
+#define VDCMPLT(a, b) _mm256_cmp_pd(a, b, _CMP_LT_OQ)
+#define VDCMPGT(a, b) _mm256_cmp_pd(a, b, _CMP_GT_OQ)
+#define VDMOVEMASK(a) _mm256_movemask_pd(a)
+#define VDLO(a) _mm256_cvtps_pd(_mm256_castps256_ps128(a))
+#define VDHI(a) _mm256_cvtps_pd(_mm256_extractf128_ps(a, 1))
+#define VDTOF(lo, hi) _mm256_insertf128_ps(_mm256_castps128_ps256(_mm256_cvtpd_ps(lo)), _mm256_cvtpd_ps(hi), 1)
+#include "pong_batch_kernel.h"
+#pragma GCC pop_options
+
+#endif
+
+/**
+ * allocates one lane array aligned for the widest kernel
+*/
+static void* allocLanes(int capacity, size_t size) {
+    void* p = aligned_alloc(32, capacity * size);
+    if (p) memset(p, 0, capacity * size);
+    return p;
+}
+
+bool initBatch(matchBatch* b, int count, uint64_t seed) {
+    memset(b, 0, sizeof(*b));
+    b->count = count;
+    b->capacity = (count + BATCH_LANE_ALIGN - 1) / BATCH_LANE_ALIGN * BATCH_LANE_ALIGN;
+    b->ballX = allocLanes(b->capacity, sizeof(float));
+    b->ballY = allocLanes(b->capacity, sizeof(float));
+    b->leftPaddleY = allocLanes(b->capacity, sizeof(float));
+    b->rightPaddleY = allocLanes(b->capacity, sizeof(float));
+    b->ballVelocityX = allocLanes(b->capacity, sizeof(float));
+    b->ballVelocityY = allocLanes(b->capacity, sizeof(float));
+    b->ballSpeed = allocLanes(b->capacity, sizeof(float));
+    b->leftScore = allocLanes(b->capacity, sizeof(int32_t));
+    b->rightScore = allocLanes(b->capacity, sizeof(int32_t));
+    b->inPlay = allocLanes(b->capacity, sizeof(int32_t));
+    b->leftStart = allocLanes(b->capacity, sizeof(bool));
+    b->leftComputerShot = allocLanes(b->capacity, sizeof(computerShot));
+    b->rightComputerShot = allocLanes(b->capacity, sizeof(computerShot));
+    b->leftConfig = allocLanes(b->capacity, sizeof(computerConfig));
+    b->rightConfig = allocLanes(b->capacity, sizeof(computerConfig));
+    b->leftIntercept = allocLanes(b->capacity, sizeof(float));
+    b->rightIntercept = allocLanes(b->capacity, sizeof(float));
+    b->leftPredicted = allocLanes(b->capacity, sizeof(bool));
+    b->rightPredicted = allocLanes(b->capacity, sizeof(bool));
+    b->rng = allocLanes(b->capacity, sizeof(rngStream));
+    b->leftInput = allocLanes(b->capacity, sizeof(direction));
+    b->rightInput = allocLanes(b->capacity, sizeof(direction));
+    b->events = allocLanes(b->capacity, sizeof(matchEvent));
+    if (!b->ballX || !b->ballY || !b->leftPaddleY || !b->rightPaddleY || !b->ballVelocityX || !b->ballVelocityY
+            || !b->ballSpeed || !b->leftScore || !b->rightScore || !b->inPlay || !b->leftStart || !b->leftComputerShot
+            || !b->rightComputerShot || !b->leftConfig || !b->rightConfig
+            || !b->leftIntercept || !b->rightIntercept || !b->leftPredicted || !b->rightPredicted || !b->rng || !b->leftInput || !b->rightInput || !b->events) {
+        freeBatch(b);
+        return false;
+    }
+    for (int i = 0; i < b->capacity; i++) {
+        matchState m;
+        initMatch(&m, seed + i);
+        storeLane(b, i, &m);
+        b->leftInput[i] = b->rightInput[i] = STATIC;
+    }
+    return true;
+}
+
+void freeBatch(matchBatch* b) {
+    free(b->ballX);
+    free(b->ballY);
+    free(b->leftPaddleY);
+    free(b->rightPaddleY);
+    free(b->ballVelocityX);
+    free(b->ballVelocityY);
+    free(b->ballSpeed);
+    free(b->leftScore);
+    free(b->rightScore);
+    free(b->inPlay);
+    free(b->leftStart);
+    free(b->leftComputerShot);
+    free(b->rightComputerShot);
+    free(b->leftConfig);
+    free(b->rightConfig);
+    free(b->leftIntercept);
+    free(b->rightIntercept);
+    free(b->leftPredicted);
+    free(b->rightPredicted);
+    free(b->rng);
+    free(b->leftInput);
+    free(b->rightInput);
+    free(b->events);
+    memset(b, 0, sizeof(*b));
+}
+
+void loadLane(const matchBatch* b, int i, matchState* m) {
+    m->ballX = b->ballX[i];
+    m->ballY = b->ballY[i];
+    m->leftPaddleY = b->leftPaddleY[i];
+    m->rightPaddleY = b->rightPaddleY[i];
+    m->ballVelocityX = b->ballVelocityX[i];
+    m->ballVelocityY = b->ballVelocityY[i];
+    m->ballSpeed = b->ballSpeed[i];
+    m->leftScore = b->leftScore[i];
+    m->rightScore = b->rightScore[i];
+    m->leftStart = b->leftStart[i];
+    m->inPlay = b->inPlay[i] != 0;
+    m->leftComputerShot = b->leftComputerShot[i];
+    m->rightComputerShot = b->rightComputerShot[i];
+    m->leftConfig = b->leftConfig[i];
+    m->rightConfig = b->rightConfig[i];
+    m->leftIntercept = b->leftIntercept[i];
+    m->rightIntercept = b->rightIntercept[i];
+    m->leftPredicted = b->leftPredicted[i];
+    m->rightPredicted = b->rightPredicted[i];
+    m->rng = b->rng[i];
+    m->sweptCollisions = false;
+}
+
+void storeLane(matchBatch* b, int i, const matchState* m) {
+    b->ballX[i] = m->ballX;
+    b->ballY[i] = m->ballY;
+    b->leftPaddleY[i] = m->leftPaddleY;
+    b->rightPaddleY[i] = m->rightPaddleY;
+    b->ballVelocityX[i] = m->ballVelocityX;
+    b->ballVelocityY[i] = m->ballVelocityY;
+    b->ballSpeed[i] = m->ballSpeed;
+    b->leftScore[i] = m->leftScore;
+    b->rightScore[i] = m->rightScore;
+    b->leftStart[i] = m->leftStart;
+    b->inPlay[i] = m->inPlay ? ~0 : 0;
+    b->leftComputerShot[i] = m->leftComputerShot;
+    b->rightComputerShot[i] = m->rightComputerShot;
+    b->leftConfig[i] = m->leftConfig;
+    b->rightConfig[i] = m->rightConfig;
+    b->leftIntercept[i] = m->leftIntercept;
+    b->rightIntercept[i] = m->rightIntercept;
+    b->leftPredicted[i] = m->leftPredicted;
+    b->rightPredicted[i] = m->rightPredicted;
+    b->rng[i] = m->rng;
+}
+
+void serveLane(matchBatch* b, int i) {
+    matchState m;
+    loadLane(b, i, &m);
+    serveBall(&m);
+    storeLane(b, i, &m);
+}
+
+/**
+ * one side's computer controllers for every lane, through the widest kernel the cpu has
+*/
+static void sideControllers(matchBatch* b, bool left) {
+#ifdef BATCH_X86
+    if (__builtin_cpu_supports("avx2")) sideControllersAvx2(b, left);
+    else sideControllersSse2(b, left);
+#else
+    for (int i = 0; i < b->count; i++) (left ? b->leftInput : b->rightInput)[i] = laneComputerDirection(b, i, left);
+#endif
+}
+
+void batchComputerControllers(matchBatch* b) {
+    sideControllers(b, true);
+    sideControllers(b, false);
+}
+
+void batchRightComputerController(matchBatch* b) {
+    sideControllers(b, false);
+}
+
+void stepBatch(matchBatch* b) {
+#ifdef BATCH_X86
+    if (__builtin_cpu_supports("avx2")) stepBatchAvx2(b);
+    else stepBatchSse2(b);
+#else
+    for (int i = 0; i < b->capacity; i++) {
+        matchState m;
+        loadLane(b, i, &m);
+        b->events[i] = stepMatch(&m, b->leftInput[i], b->rightInput[i]);
+        storeLane(b, i, &m);
+    }
+#endif
+}
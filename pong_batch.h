@@ -0,0 +1,79 @@
+#ifndef PONG_BATCH_H
+#define PONG_BATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pong_core.h"
+
+// lane count is padded to a multiple of this so every kernel runs on full vectors
+#define BATCH_LANE_ALIGN (8)
+
+/**
+ * many matches stored as structure of arrays
+ * every array has capacity entries, lanes at or past count are padding and never served
+ * inPlay holds 0 or ~0 so it can be used directly as a lane mask
+*/
+typedef struct {
+    int count, capacity;
+    float *ballX, *ballY, *leftPaddleY, *rightPaddleY;
+    float *ballVelocityX, *ballVelocityY;
+    float *ballSpeed;
+    int32_t *leftScore, *rightScore;
+    int32_t *inPlay;
+    bool *leftStart;
+    computerShot *leftComputerShot, *rightComputerShot;
+    computerConfig *leftConfig, *rightConfig;
+    float *leftIntercept, *rightIntercept;
+    bool *leftPredicted, *rightPredicted;
+    rngStream *rng;
+    // paddle directions consumed by the next stepBatch (filled by the caller)
+    direction *leftInput, *rightInput;
+    // outcome of each lane from the last stepBatch
+    matchEvent *events;
+} matchBatch;
+
+/**
+ * allocates a batch of count fresh matches, lane i seeded with seed + i
+ * returns false if allocation fails
+*/
+bool initBatch(matchBatch* b, int count, uint64_t seed);
+
+/**
+ * releases the lane arrays
+*/
+void freeBatch(matchBatch* b);
+
+/**
+ * copies lane i out to a scalar match
+ * batches only run the legacy collision tests, so the match comes back without sweptCollisions
+*/
+void loadLane(const matchBatch* b, int i, matchState* m);
+
+/**
+ * copies a scalar match into lane i
+*/
+void storeLane(matchBatch* b, int i, const matchState* m);
+
+/**
+ * starts a new round on lane i
+*/
+void serveLane(matchBatch* b, int i);
+
+/**
+ * fills leftInput and rightInput from the computer controllers of every lane
+*/
+void batchComputerControllers(matchBatch* b);
+
+/**
+ * fills rightInput from the right computer controller of every lane, leaving leftInput to the caller
+*/
+void batchRightComputerController(matchBatch* b);
+
+/**
+ * advances every lane by one tick with the same rules as stepMatch
+ * lanes between rounds only move their paddles and ball
+*/
+void stepBatch(matchBatch* b);
+
+#endif
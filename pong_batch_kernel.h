@@ -0,0 +1,222 @@
+/**
+ * vector bodies of stepBatch and the batch computer controllers
+ * included by pong_batch.c once per instruction set with these defined:
+ * KERNEL_SUFFIX (appended to every function name), VW (lanes per vector), VDW (lanes per double vector),
+ * VF/VI/VD (float/int/double vector types) and the V* operation macros
+ * not a standalone header
+*/
+
+#define KERNEL_CAT2(a, b) a##b
+#define KERNEL_CAT(a, b) KERNEL_CAT2(a, b)
+#define KFN(name) KERNEL_CAT(name, KERNEL_SUFFIX)
+
+/**
+ * applies a paddle hit to the masked lanes through the scalar hitPaddle, so the batch engine bounces
+ * bit for bit like the tick by tick one, hits are rare enough that the round trip through the lane arrays doesn't show
+*/
+static inline void KFN(bounceLanes)(matchBatch* b, int i, int hits, float sign, VF* x, VF* y, VF* vx, VF* vy, VF* speed) {
+    VSTORE(b->ballX + i, *x);
+    VSTORE(b->ballY + i, *y);
+    VSTORE(b->ballVelocityX + i, *vx);
+    VSTORE(b->ballVelocityY + i, *vy);
+    VSTORE(b->ballSpeed + i, *speed);
+    for (int j = 0; hits >> j; j++) {
+        if (!(hits & (1 << j))) continue;
+        matchState m;
+        loadLane(b, i + j, &m);
+        hitPaddle(&m, sign > 0 ? m.leftPaddleY : m.rightPaddleY, sign);
+        storeLane(b, i + j, &m);
+    }
+    *x = VLOAD(b->ballX + i);
+    *y = VLOAD(b->ballY + i);
+    *vx = VLOAD(b->ballVelocityX + i);
+    *vy = VLOAD(b->ballVelocityY + i);
+    *speed = VLOAD(b->ballSpeed + i);
+}
+
+/**
+ * moves the paddles of one side by their directions
+*/
+static inline VF KFN(paddleVec)(VF paddleY, const direction* input) {
+    VI d = VILOAD((const void*) input);
+    VF down = VICAST(VICMPEQ(d, VISET1(DOWN)));
+    VF up = VICAST(VICMPEQ(d, VISET1(UP)));
+    VF step = VSET1(WINDOW_HEIGHTF / 512. * PADDLE_SPEED);
+    paddleY = VBLEND(paddleY, VMAX(VSUB(paddleY, step), VSET1(MIN_PADDLE_Y)), down);
+    return VBLEND(paddleY, VMIN(VADD(paddleY, step), VSET1(MAX_PADDLE_Y)), up);
+}
+
+/**
+ * sets lane events and scores for the masked lanes that scored
+*/
+static inline void KFN(scoreVec)(VF scored, int32_t* score, matchEvent pointEvent, matchEvent winEvent, VI* event) {
+    VI s = VILOAD(score);
+    VI mask = VFCAST(scored);
+    // mask is -1 in scoring lanes
+    s = VISUB(s, mask);
+    VISTORE(score, s);
+    VI win = VICMPEQ(s, VISET1((int) TARGET_SCORE));
+    VI e = VIOR(VIAND(win, VISET1(winEvent)), VIANDNOT(win, VISET1(pointEvent)));
+    *event = VIOR(VIAND(mask, e), VIANDNOT(mask, *event));
+}
+
+/**
+ * one side's computer controllers for every lane, the same decisions computerDirection makes
+ * targets and steering are worked out a vector at a time, with aiming shifts read from aimOffsets instead of
+ * calling atan2f and the double arithmetic of viewTarget and steerPaddle kept in double vectors
+ * intercepts are predicted lane by lane once per bounce, and aiming lanes the table can't answer exactly
+ * (paddles off the 1/32 grid) go through the scalar controller
+ * the last vector may run into padding lanes, which sit out of play at the middle and so stay STATIC
+*/
+static void KFN(sideControllers)(matchBatch* b, bool left) {
+    const float* paddles = left ? b->leftPaddleY : b->rightPaddleY;
+    const float* others = left ? b->rightPaddleY : b->leftPaddleY;
+    const computerShot* shots = left ? b->leftComputerShot : b->rightComputerShot;
+    const computerConfig* configs = left ? b->leftConfig : b->rightConfig;
+    float* intercepts = left ? b->leftIntercept : b->rightIntercept;
+    bool* predicted = left ? b->leftPredicted : b->rightPredicted;
+    direction* input = left ? b->leftInput : b->rightInput;
+    double lastSetting = NAN, lastTolerance = 0;
+    for (int i = 0; i < b->count; i += VW) {
+        VF paddleY = VLOAD(paddles + i);
+        VF vx = VLOAD(b->ballVelocityX + i);
+        VF inPlay = VICAST(VILOAD(b->inPlay + i));
+        VF coming = VANDNOT(left ? VCMPGT(vx, VSET1(0)) : VCMPLT(vx, VSET1(0)), inPlay);
+        // lanes nearly always share a setting, and fixed point builds round it, so only round a new one
+        double tolerances[VW];
+        for (int j = 0; j < VW; j++) {
+            if (configs[i + j].aimingTolerance != lastSetting) {
+                lastSetting = configs[i + j].aimingTolerance;
+                lastTolerance = aimingTolerance(configs + i + j);
+            }
+            tolerances[j] = lastTolerance;
+        }
+        VD toleranceLo = VDLOAD(tolerances), toleranceHi = VDLOAD(tolerances + VDW);
+
+        VF target = VSET1(MIDDLE_PADDLE_Y);
+        int scalarLanes = 0, comingLanes = VMOVEMASK(coming);
+        if (comingLanes) {
+            // a ball flying level is its own intercept
+            VF level = VCMPEQ(VLOAD(b->ballVelocityY + i), VSET1(0));
+            int predictLanes = comingLanes & ~VMOVEMASK(level);
+            for (int j = 0; predictLanes >> j; j++) {
+                if (!(predictLanes & (1 << j)) || predicted[i + j]) continue;
+                intercepts[i + j] = ballIntersectY(b->ballX[i + j] + BALL_RADIUS, b->ballY[i + j] + BALL_RADIUS,
+                        b->ballVelocityX[i + j], b->ballVelocityY[i + j]);
+                predicted[i + j] = true;
+            }
+            VF base = VSUB(VBLEND(VLOAD(intercepts + i), VLOAD(b->ballY + i), level), VSET1(PADDLE_HEIGHT / 2));
+
+            // the paddle height difference each aiming shot passes to targetAimingShift
+            VI shot = VILOAD((const void*) (shots + i));
+            VF otherY = VLOAD(others + i);
+            VF top = VSUB(VSET1(MAX_PADDLE_Y - PADDLE_HEIGHT / 2), paddleY);
+            VF bottom = VSUB(VSET1(PADDLE_HEIGHT / 2), paddleY);
+            VF isBottom = VICAST(VICMPEQ(shot, VISET1(BOTTOM)));
+            VF isAggressive = VICAST(VICMPEQ(shot, VISET1(AGGRESSIVE)));
+            VF isEasy = VICAST(VICMPEQ(shot, VISET1(EASY)));
+            VF yChange = VBLEND(VBLEND(top, bottom, isBottom), VSUB(otherY, paddleY), isEasy);
+            yChange = VBLEND(yChange, VBLEND(top, bottom, VCMPGT(otherY, VSET1(MIDDLE_PADDLE_Y))), isAggressive);
+            VF aiming = VAND(VOR(VOR(VICAST(VICMPEQ(shot, VISET1(TOP))), isBottom), VOR(isAggressive, isEasy)), coming);
+
+            // the table is exact for rises on the grid, which they are whenever the paddle is
+            VF signBit = VSET1(-0.f);
+            VF scaled = VMUL(VANDNOT(signBit, yChange), VSET1(AIM_STEPS_PER_UNIT));
+            VF paddleScaled = VMUL(paddleY, VSET1(AIM_STEPS_PER_UNIT));
+            VI step = VCVTTI(scaled);
+            VI inTable = VIAND(VICMPGT(step, VISET1(-1)), VICMPGT(VISET1(AIM_TABLE_SIZE), step));
+            VF exact = VAND(VAND(VCMPEQ(VCVTIF(step), scaled), VCMPEQ(VCVTIF(VCVTTI(paddleScaled)), paddleScaled)), VICAST(inTable));
+            scalarLanes = VMOVEMASK(VANDNOT(exact, aiming));
+
+            // targetAimingShift: the offset clamped to PADDLE_HEIGHT / 2 - tolerance, against the rise's sign
+            VD reachLo = VDSUB(VDSET1(PADDLE_HEIGHT / 2), toleranceLo), reachHi = VDSUB(VDSET1(PADDLE_HEIGHT / 2), toleranceHi);
+            VF offset = VMIN(VGATHER(aimOffsets, VIAND(step, VFCAST(exact))), VDTOF(reachLo, reachHi));
+            VF shift = VOR(VANDNOT(signBit, offset), VANDNOT(yChange, signBit));
+            target = VBLEND(base, VADD(base, shift), aiming);
+
+            // erratic shots move by the reach in double, as viewTarget does
+            VD baseLo = VDLO(base), baseHi = VDHI(base);
+            target = VBLEND(target, VDTOF(VDSUB(baseLo, reachLo), VDSUB(baseHi, reachHi)), VICAST(VICMPEQ(shot, VISET1(ERRATIC_UP))));
+            target = VBLEND(target, VDTOF(VDADD(baseLo, reachLo), VDADD(baseHi, reachHi)), VICAST(VICMPEQ(shot, VISET1(ERRATIC_DOWN))));
+            target = VBLEND(VSET1(MIDDLE_PADDLE_Y), target, coming);
+        }
+
+        // steerPaddle, comparing in double
+        VD paddleLo = VDLO(paddleY), paddleHi = VDHI(paddleY), targetLo = VDLO(target), targetHi = VDHI(target);
+        int up = VDMOVEMASK(VDCMPLT(paddleLo, VDSUB(targetLo, toleranceLo)))
+                | VDMOVEMASK(VDCMPLT(paddleHi, VDSUB(targetHi, toleranceHi))) << VDW;
+        int down = VDMOVEMASK(VDCMPGT(paddleLo, VDADD(targetLo, toleranceLo)))
+                | VDMOVEMASK(VDCMPGT(paddleHi, VDADD(targetHi, toleranceHi))) << VDW;
+        for (int j = 0; j < VW; j++) input[i + j] = up >> j & 1 ? UP : down >> j & 1 ? DOWN : STATIC;
+        for (int j = 0; scalarLanes >> j; j++) {
+            if (scalarLanes & (1 << j)) input[i + j] = laneComputerDirection(b, i + j, left);
+        }
+    }
+}
+
+static void KFN(stepBatch)(matchBatch* b) {
+    for (int i = 0; i < b->capacity; i += VW) {
+        VF leftPaddleY = KFN(paddleVec)(VLOAD(b->leftPaddleY + i), b->leftInput + i);
+        VF rightPaddleY = KFN(paddleVec)(VLOAD(b->rightPaddleY + i), b->rightInput + i);
+        VSTORE(b->leftPaddleY + i, leftPaddleY);
+        VSTORE(b->rightPaddleY + i, rightPaddleY);
+
+        VF vx = VLOAD(b->ballVelocityX + i);
+        VF vy = VLOAD(b->ballVelocityY + i);
+        VF x = VADD(VLOAD(b->ballX + i), vx);
+        VF y = VADD(VLOAD(b->ballY + i), vy);
+        VF inPlay = VICAST(VILOAD(b->inPlay + i));
+        VI event = VISET1(NO_EVENT);
+
+        if (VMOVEMASK(inPlay)) {
+            VF speed = VLOAD(b->ballSpeed + i);
+
+            // top and bottom
+            VF wall = VAND(VOR(VCMPGT(VADD(y, VSET1(BALL_DIM)), VSET1(WINDOW_HEIGHTF)), VCMPLT(y, VSET1(0))), inPlay);
+            vy = VBLEND(vy, VSUB(VSET1(0), vy), wall);
+            y = VBLEND(y, VADD(y, vy), wall);
+
+            // paddles
+            VF yOverlapsLeft = VAND(VCMPGT(VADD(y, VSET1(BALL_DIM)), leftPaddleY), VCMPLT(y, VADD(leftPaddleY, VSET1(PADDLE_HEIGHT))));
+            VF leftHit = VAND(VAND(VCMPLT(x, VSET1(LEFT_PADDLE_X)), VCMPGT(x, VSET1(LEFT_PADDLE_X - PADDLE_INVISIBLE_COLLIDER_WIDTH - PADDLE_WIDTH))), VAND(yOverlapsLeft, inPlay));
+            VF xRight = VADD(x, VSET1(BALL_DIM));
+            VF yOverlapsRight = VAND(VCMPGT(VADD(y, VSET1(BALL_DIM)), rightPaddleY), VCMPLT(y, VADD(rightPaddleY, VSET1(PADDLE_HEIGHT))));
+            VF rightHit = VAND(VAND(VCMPGT(xRight, VSET1(RIGHT_PADDLE_X)), VCMPLT(xRight, VSET1(RIGHT_PADDLE_X + PADDLE_WIDTH + PADDLE_INVISIBLE_COLLIDER_WIDTH))), VANDNOT(leftHit, VAND(yOverlapsRight, inPlay)));
+            int leftHits = VMOVEMASK(leftHit), rightHits = VMOVEMASK(rightHit);
+            if (leftHits) KFN(bounceLanes)(b, i, leftHits, 1.f, &x, &y, &vx, &vy, &speed);
+            if (rightHits) KFN(bounceLanes)(b, i, rightHits, -1.f, &x, &y, &vx, &vy, &speed);
+            // any change of direction invalidates the lane's cached intercepts
+            int bounces = VMOVEMASK(wall) | leftHits | rightHits;
+            for (int j = 0; bounces >> j; j++) {
+                if (bounces & (1 << j)) b->leftPredicted[i + j] = b->rightPredicted[i + j] = false;
+            }
+            // shot choice draws from each lane's own random state, so stays scalar
+            for (int j = 0; (leftHits | rightHits) >> j; j++) {
+                if (leftHits & (1 << j)) {
+                    b->leftComputerShot[i + j] = getRandomShot(b->leftConfig + i + j, b->rng + i + j);
+                } else if (rightHits & (1 << j)) {
+                    b->rightComputerShot[i + j] = getRandomShot(b->rightConfig + i + j, b->rng + i + j);
+                }
+            }
+            VSTORE(b->ballSpeed + i, speed);
+
+            // score colliders
+            VF rightScored = VAND(VCMPLT(x, VSET1(0)), inPlay);
+            VF leftScored = VANDNOT(rightScored, VAND(VCMPGT(VADD(x, VSET1(BALL_DIM)), VSET1(WINDOW_WIDTHF)), inPlay));
+            KFN(scoreVec)(rightScored, b->rightScore + i, RIGHT_POINT, RIGHT_WIN, &event);
+            KFN(scoreVec)(leftScored, b->leftScore + i, LEFT_POINT, LEFT_WIN, &event);
+            inPlay = VANDNOT(VOR(rightScored, leftScored), inPlay);
+            VISTORE(b->inPlay + i, VFCAST(inPlay));
+        }
+
+        VSTORE(b->ballX + i, x);
+        VSTORE(b->ballY + i, y);
+        VSTORE(b->ballVelocityX + i, vx);
+        VSTORE(b->ballVelocityY + i, vy);
+        VISTORE((void*) (b->events + i), event);
+    }
+}
+
+#undef KFN
+#undef KERNEL_CAT
+#undef KERNEL_CAT2
@@ -0,0 +1,436 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "pong_core.h"
+#include "pong_env.h"
+#include "pong_raster.h"
+#include "pong_render.h"
+#include "pong_rollback.h"
+
+// timed samples per case, reported as median and median absolute deviation
+#define SAMPLES (31)
+// each sample runs enough iterations to take at least this long
+#define MIN_SAMPLE_SEC (.005)
+// untimed run before calibration so caches, branch predictors and clocks settle
+#define WARMUP_SEC (.05)
+// distinct inputs cycled through by the pure function cases
+#define INPUTS (1024)
+// default slowdown against the baseline, in percent, that counts as a regression
+#define DEFAULT_TOLERANCE (10.)
+#define MAX_CASES (16)
+// ticks resimulated by each call of the rollback case, half a second of play
+#define ROLLBACK_DEPTH (30)
+// matches stepped together by the env case
+#define ENV_BATCH (1024)
+// matches drawn together by the raster case, and the pixel observation size it draws them at
+#define RASTER_BATCH (256)
+#define RASTER_SIZE (84)
+
+// offscreen frame size, the game window's
+#define FRAME_WIDTH ((int) WINDOW_WIDTHF)
+#define FRAME_HEIGHT ((int) WINDOW_HEIGHTF)
+
+// results written here so the compiler can't drop the calls
+volatile float sink;
+
+/**
+ * seconds on the monotonic clock
+*/
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * one ball position and velocity
+*/
+typedef struct {
+    float x, y, vx, vy;
+} ballInput;
+
+ballInput balls[INPUTS];
+float yChanges[INPUTS];
+double tolerances[INPUTS];
+
+/**
+ * fills the input tables with in-court balls at every serve and rally speed and angle
+*/
+void buildInputs() {
+    rngStream rng;
+    seedRandom(&rng, 1);
+    for (int i = 0; i < INPUTS; i++) {
+        float speed = INITIAL_BALL_SPEED + randomFloat(&rng) * (MAX_BALL_SPEED - INITIAL_BALL_SPEED);
+        float angle = (2 * randomFloat(&rng) - 1) * MAX_BOUNCE_ANGLE_RAD;
+        float vx = speed * cosf(angle);
+        balls[i] = (ballInput) {
+            LEFT_PADDLE_X + randomFloat(&rng) * (RIGHT_PADDLE_X - LEFT_PADDLE_X),
+            randomFloat(&rng) * WINDOW_HEIGHTF,
+            i % 2 ? vx : -vx,
+            speed * sinf(angle)
+        };
+        yChanges[i] = (2 * randomFloat(&rng) - 1) * MAX_PADDLE_Y;
+        tolerances[i] = randomFloat(&rng) * PADDLE_HEIGHT / 2;
+    }
+}
+
+void benchBallIntersectY(unsigned long iterations) {
+    float s = 0;
+    for (unsigned long i = 0; i < iterations; i++) {
+        const ballInput* b = &balls[i % INPUTS];
+        s += ballIntersectY(b->x, b->y, b->vx, b->vy);
+    }
+    sink = s;
+}
+
+void benchTargetAimingShift(unsigned long iterations) {
+    float s = 0;
+    for (unsigned long i = 0; i < iterations; i++) {
+        s += targetAimingShift(yChanges[i % INPUTS], tolerances[i % INPUTS]);
+    }
+    sink = s;
+}
+
+void benchGetRandomShot(unsigned long iterations) {
+    rngStream rng;
+    seedRandom(&rng, 2);
+    int s = 0;
+    for (unsigned long i = 0; i < iterations; i++) {
+        s += getRandomShot(&defaultComputerConfig, &rng);
+    }
+    sink = s;
+}
+
+void benchAccelerateBall(unsigned long iterations) {
+    matchState m;
+    initMatch(&m, 3);
+    float s = 0;
+    for (unsigned long i = 0; i < iterations; i++) {
+        const ballInput* b = &balls[i % INPUTS];
+        m.ballVelocityX = b->vx;
+        m.ballVelocityY = b->vy;
+        m.ballSpeed = INITIAL_BALL_SPEED;
+        accelerateBall(&m);
+        s += m.ballVelocityY;
+    }
+    sink = s;
+}
+
+/**
+ * what fixedUpdate does in a zero player game: both computer controllers, the physics step,
+ * and a serve or a new match when a round ends
+*/
+void benchTick(unsigned long iterations) {
+    static matchState m;
+    static bool started = false;
+    if (!started) {
+        initMatch(&m, 4);
+        serveBall(&m);
+        started = true;
+    }
+    for (unsigned long i = 0; i < iterations; i++) {
+        direction left = leftComputerController(&m);
+        direction right = rightComputerController(&m);
+        switch (stepMatch(&m, left, right)) {
+            case LEFT_WIN:
+            case RIGHT_WIN:
+                initMatch(&m, i);
+                serveBall(&m);
+                break;
+            case LEFT_POINT:
+            case RIGHT_POINT:
+                serveBall(&m);
+                break;
+            case NO_EVENT:
+                break;
+        }
+    }
+    sink = m.ballY;
+}
+
+/**
+ * a misprediction correction: rolls back ROLLBACK_DEPTH ticks of a rally between two computers
+ * and resimulates them to the present
+*/
+void benchRollback(unsigned long iterations) {
+    static rollbackRing history;
+    static tickState s;
+    static bool started = false;
+    if (!started) {
+        initMatch(&s.match, 5);
+        s.serveDelay = 1;
+        initRollback(&history, 0);
+        for (int i = 0; i < ROLLBACK_TICKS; i++) {
+            tickState before = s;
+            tickInput in = {STATIC, STATIC};
+            bool serve;
+            if (beginTick(&s, &serve)) {
+                in.left = leftComputerController(&s.match);
+                in.right = rightComputerController(&s.match);
+                endTick(&s, in);
+            }
+            saveTick(&history, &before, in);
+        }
+        started = true;
+    }
+    matchEvent won;
+    int ticks = 0;
+    for (unsigned long i = 0; i < iterations; i++) {
+        ticks += rollbackTo(&history, history.present - ROLLBACK_DEPTH, leftComputerController, rightComputerController, &s, &won);
+    }
+    sink = s.match.ballY + ticks;
+}
+
+/**
+ * one environment step as a training loop takes it: a batch of ENV_BATCH against the computer with auto reset,
+ * timed per match stepped
+*/
+void benchEnv(unsigned long iterations) {
+    static pongEnv* e;
+    static int32_t actions[ENV_BATCH];
+    static float observations[ENV_BATCH * ENV_OBSERVATION_SIZE], rewards[ENV_BATCH];
+    static uint8_t dones[ENV_BATCH];
+    if (!e) {
+        e = createEnv(ENV_BATCH, 6, ENV_AUTO_RESET | ENV_COMPUTER_OPPONENT);
+        for (int i = 0; i < ENV_BATCH; i++) actions[i] = i % 3;
+    }
+    for (unsigned long i = 0; i < iterations; i += ENV_BATCH) {
+        stepEnv(e, actions, observations, rewards, dones);
+        // vary the actions a little without a random number generator in the loop
+        actions[i / ENV_BATCH % ENV_BATCH] = (actions[i / ENV_BATCH % ENV_BATCH] + 1) % 3;
+    }
+    sink = observations[0] + rewards[0];
+}
+
+/**
+ * pixel observations for a training batch: RASTER_BATCH matches in mid rally drawn by the software rasterizer
+ * at RASTER_SIZE by RASTER_SIZE, timed per frame
+*/
+void benchRaster(unsigned long iterations) {
+    static sceneRenderer r;
+    static matchBatch b;
+    static uint8_t* pixels;
+    if (!pixels) {
+        initSceneRenderer(&r, RASTER_SIZE, RASTER_SIZE);
+        initBatch(&b, RASTER_BATCH, 7);
+        for (int i = 0; i < RASTER_BATCH; i++) {
+            b.ballX[i] = balls[i].x;
+            b.ballY[i] = balls[i].y;
+            b.leftPaddleY[i] = fabsf(yChanges[i]);
+            b.rightPaddleY[i] = MAX_PADDLE_Y - fabsf(yChanges[i]);
+            b.leftScore[i] = i % 10;
+            b.rightScore[i] = i / 16 % 10;
+        }
+        pixels = malloc(RASTER_BATCH * RASTER_SIZE * RASTER_SIZE);
+    }
+    for (unsigned long i = 0; i < iterations; i += RASTER_BATCH) drawBatchFrames(&r, &b, pixels);
+    sink = pixels[(iterations / RASTER_BATCH % RASTER_BATCH) * RASTER_SIZE * RASTER_SIZE + RASTER_SIZE / 2];
+}
+
+vertexBatch centerLine, frameGeometry;
+
+/**
+ * one game screen as display draws it: the cached centerline, then paddles, scores and ball
+ * streamed into a fresh batch, waiting for the rasterizer to finish so the fill is counted
+*/
+void benchFrame(unsigned long iterations) {
+    for (unsigned long i = 0; i < iterations; i++) {
+        const ballInput* b = &balls[i % INPUTS];
+        glClearColor(0., 0., 0., 1.);
+        glClear(GL_COLOR_BUFFER_BIT);
+        clearVertexBatch(&frameGeometry);
+        float leftY = b->x / WINDOW_WIDTHF * MAX_PADDLE_Y, rightY = b->y / WINDOW_HEIGHTF * MAX_PADDLE_Y;
+        pushGamePieces(&frameGeometry, leftY, rightY, b->x, b->y, 10, 8);
+        drawVertexBatch(&centerLine);
+        drawVertexBatch(&frameGeometry);
+        glFinish();
+    }
+}
+
+/**
+ * makes an offscreen Mesa context current through EGL's surfaceless platform
+ * and builds the cached geometry for benchFrame
+ * returns false if no context could be created
+*/
+bool initOffscreen() {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (!getPlatformDisplay) return false;
+    EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL) || !eglBindAPI(EGL_OPENGL_API)) return false;
+    const EGLint configAttributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, FRAME_WIDTH, EGL_HEIGHT, FRAME_HEIGHT, EGL_NONE};
+    EGLConfig config;
+    EGLint configs;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configs) || configs < 1) return false;
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT) return false;
+    if (!eglMakeCurrent(display, surface, surface, context)) return false;
+
+    glViewport(0, 0, FRAME_WIDTH, FRAME_HEIGHT);
+    setWindowProjection(WINDOW_WIDTHF, WINDOW_HEIGHTF);
+    initVertexBatch(&centerLine, GL_STATIC_DRAW);
+    initVertexBatch(&frameGeometry, GL_STREAM_DRAW);
+    pushCenterLine(&centerLine);
+    return true;
+}
+
+/**
+ * one benchmarked function
+ * body runs the function the given number of times
+*/
+typedef struct {
+    const char* name;
+    void (*body)(unsigned long iterations);
+} benchCase;
+
+/**
+ * timing of one case, nanoseconds per call
+*/
+typedef struct {
+    const char* name;
+    double median, deviation, fastest;
+    unsigned long iterations;
+} benchResult;
+
+int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * median of n values, reorders them
+*/
+double median(double* values, int n) {
+    qsort(values, n, sizeof(double), compareDoubles);
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+/**
+ * warms a case up, picks an iteration count that makes each sample at least MIN_SAMPLE_SEC,
+ * then times SAMPLES samples
+*/
+benchResult runCase(const benchCase* c) {
+    double start = now();
+    while (now() - start < WARMUP_SEC) c->body(1000);
+
+    unsigned long iterations = 1;
+    for (;;) {
+        double t = now();
+        c->body(iterations);
+        if (now() - t >= MIN_SAMPLE_SEC) break;
+        iterations *= 2;
+    }
+
+    double samples[SAMPLES], deviations[SAMPLES];
+    for (int i = 0; i < SAMPLES; i++) {
+        double t = now();
+        c->body(iterations);
+        samples[i] = (now() - t) * 1e9 / iterations;
+    }
+    benchResult r = {c->name, 0, 0, 0, iterations};
+    r.median = median(samples, SAMPLES);
+    r.fastest = samples[0];
+    for (int i = 0; i < SAMPLES; i++) deviations[i] = fabs(samples[i] - r.median);
+    r.deviation = median(deviations, SAMPLES);
+    return r;
+}
+
+/**
+ * looks up a case's median in a baseline file of "name nanoseconds" lines
+ * returns 0 if the file doesn't have it
+*/
+double baselineFor(FILE* f, const char* name) {
+    char line[128], caseName[64];
+    double ns;
+    rewind(f);
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "%63s %lf", caseName, &ns) == 2 && strcmp(caseName, name) == 0) return ns;
+    }
+    return 0;
+}
+
+/**
+ * microbenchmarks for the simulation and rendering hot paths
+ * usage: pong-bench [-b baseline] [-w file] [-t percent]
+ * -b compares each median with the baseline file and exits with 1 if any is more than percent slower
+ * -w writes the medians in the baseline format
+ * -t sets that percentage, default 10
+*/
+int main(int argc, char** argv) {
+    const char* baselinePath = NULL;
+    const char* outputPath = NULL;
+    double tolerance = DEFAULT_TOLERANCE;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:w:t:")) != -1) {
+        if (opt == 'b') {
+            baselinePath = optarg;
+        } else if (opt == 'w') {
+            outputPath = optarg;
+        } else if (opt == 't') {
+            tolerance = atof(optarg);
+        } else {
+            fprintf(stderr, "usage: %s [-b baseline] [-w file] [-t percent]\n", argv[0]);
+            return 1;
+        }
+    }
+    FILE* baseline = NULL;
+    if (baselinePath && !(baseline = fopen(baselinePath, "r"))) {
+        perror(baselinePath);
+        return 1;
+    }
+
+    buildInputs();
+    benchCase cases[MAX_CASES] = {
+        {"ballIntersectY", benchBallIntersectY},
+        {"targetAimingShift", benchTargetAimingShift},
+        {"getRandomShot", benchGetRandomShot},
+        {"accelerateBall", benchAccelerateBall},
+        {"tick", benchTick},
+        {"rollback", benchRollback},
+        {"env", benchEnv},
+        {"raster", benchRaster},
+    };
+    int caseCount = 8;
+    if (initOffscreen()) {
+        cases[caseCount++] = (benchCase) {"frame", benchFrame};
+    } else {
+        fprintf(stderr, "no offscreen GL context, skipping frame\n");
+    }
+
+    benchResult results[MAX_CASES];
+    int regressions = 0;
+    printf("%-18s %12s %10s %12s %10s\n", "case", "median ns", "mad ns", "fastest ns", "baseline");
+    for (int i = 0; i < caseCount; i++) {
+        benchResult r = results[i] = runCase(&cases[i]);
+        printf("%-18s %12.2f %10.2f %12.2f", r.name, r.median, r.deviation, r.fastest);
+        double base = baseline ? baselineFor(baseline, r.name) : 0;
+        if (base > 0) {
+            double change = (r.median / base - 1) * 100;
+            // a difference inside the run's own noise is not a regression
+            bool regressed = change > tolerance && r.median - r.deviation > base;
+            regressions += regressed;
+            printf(" %+9.1f%%%s", change, regressed ? "  regressed" : "");
+        }
+        printf("\n");
+    }
+    if (baseline) fclose(baseline);
+
+    if (outputPath) {
+        FILE* f = fopen(outputPath, "w");
+        if (!f) {
+            perror(outputPath);
+            return 1;
+        }
+        for (int i = 0; i < caseCount; i++) fprintf(f, "%s %.2f\n", results[i].name, results[i].median);
+        fclose(f);
+    }
+    return regressions > 0;
+}
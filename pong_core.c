@@ -0,0 +1,752 @@
+#include "pong_core.h"
+
+#include <math.h>
+#include <string.h>
+
+const computerConfig defaultComputerConfig = {
+    .shotWeights = {
+        [FLAT] = PROB_FLAT,
+        [TOP] = PROB_TOP,
+        [BOTTOM] = PROB_BOTTOM,
+        [AGGRESSIVE] = PROB_AGGRESSIVE,
+        [EASY] = PROB_EASY,
+        [ERRATIC_UP] = PROB_ERRATIC_UP,
+        [ERRATIC_DOWN] = PROB_ERRATIC_DOWN
+    },
+    .aimingTolerance = COMPUTER_AIMING_TOLERANCE
+};
+
+#ifdef PONG_FIXED_POINT
+
+// a value in units of 1 / FIXED_ONE
+typedef int32_t fixed;
+
+// fixed point constants, exact since the court is laid out on the grid
+#define FX(x) ((fixed) ((x) * FIXED_ONE))
+// FIXED_ONE * BALL_SPEED_ACCELERATION, rounded
+#define FIXED_ACCELERATION ((int64_t) (BALL_SPEED_ACCELERATION * FIXED_ONE + .5))
+// table entries are scaled by 1 << TABLE_SHIFT, lookups interpolate over 1 << TABLE_SHIFT steps
+#define TABLE_SHIFT (15)
+#define STEP_SHIFT (8)
+// sinTable steps per MAX_BOUNCE_ANGLE and over a quarter turn
+#define ANGLE_STEPS (256)
+#define QUARTER_STEPS (384)
+// atanTable covers slopes 0 to 1 in ATAN_STEPS steps
+#define ATAN_STEPS (256)
+
+// sin(k * MAX_BOUNCE_ANGLE / ANGLE_STEPS) for a quarter turn, cos(a) is read as sin(QUARTER_STEPS - a)
+static const int32_t sinTable[QUARTER_STEPS + 1] = {
+    0, 134, 268, 402, 536, 670, 804, 938, 1072, 1206, 1340, 1474, 1608, 1742, 1876, 2009,
+    2143, 2277, 2411, 2544, 2678, 2811, 2945, 3078, 3212, 3345, 3479, 3612, 3745, 3878, 4011, 4144,
+    4277, 4410, 4543, 4675, 4808, 4941, 5073, 5205, 5338, 5470, 5602, 5734, 5866, 5998, 6130, 6261,
+    6393, 6524, 6655, 6787, 6918, 7049, 7180, 7310, 7441, 7571, 7702, 7832, 7962, 8092, 8222, 8351,
+    8481, 8610, 8740, 8869, 8998, 9127, 9255, 9384, 9512, 9640, 9768, 9896, 10024, 10151, 10279, 10406,
+    10533, 10660, 10786, 10913, 11039, 11165, 11291, 11417, 11543, 11668, 11793, 11918, 12043, 12167, 12292, 12416,
+    12540, 12664, 12787, 12910, 13033, 13156, 13279, 13401, 13524, 13646, 13767, 13889, 14010, 14131, 14252, 14373,
+    14493, 14613, 14733, 14852, 14972, 15091, 15210, 15328, 15447, 15565, 15683, 15800, 15917, 16035, 16151, 16268,
+    16384, 16500, 16616, 16731, 16846, 16961, 17075, 17190, 17304, 17417, 17531, 17644, 17757, 17869, 17981, 18093,
+    18205, 18316, 18427, 18538, 18648, 18758, 18868, 18978, 19087, 19195, 19304, 19412, 19520, 19627, 19735, 19841,
+    19948, 20054, 20160, 20265, 20371, 20475, 20580, 20684, 20788, 20891, 20994, 21097, 21199, 21301, 21403, 21504,
+    21605, 21706, 21806, 21906, 22006, 22105, 22204, 22302, 22400, 22498, 22595, 22692, 22788, 22884, 22980, 23075,
+    23170, 23265, 23359, 23453, 23546, 23640, 23732, 23824, 23916, 24008, 24099, 24189, 24279, 24369, 24459, 24548,
+    24636, 24724, 24812, 24900, 24986, 25073, 25159, 25245, 25330, 25415, 25499, 25583, 25667, 25750, 25833, 25915,
+    25997, 26078, 26159, 26239, 26320, 26399, 26478, 26557, 26635, 26713, 26791, 26868, 26944, 27020, 27096, 27171,
+    27246, 27320, 27394, 27467, 27540, 27612, 27684, 27756, 27827, 27897, 27967, 28037, 28106, 28175, 28243, 28311,
+    28378, 28445, 28511, 28577, 28642, 28707, 28771, 28835, 28899, 28962, 29024, 29086, 29148, 29209, 29269, 29329,
+    29389, 29448, 29506, 29564, 29622, 29679, 29736, 29792, 29847, 29902, 29957, 30011, 30064, 30118, 30170, 30222,
+    30274, 30325, 30375, 30425, 30475, 30524, 30572, 30620, 30668, 30715, 30761, 30807, 30853, 30897, 30942, 30986,
+    31029, 31072, 31114, 31156, 31197, 31238, 31278, 31318, 31357, 31396, 31434, 31471, 31508, 31545, 31581, 31617,
+    31651, 31686, 31720, 31753, 31786, 31818, 31850, 31881, 31912, 31942, 31972, 32001, 32029, 32058, 32085, 32112,
+    32138, 32164, 32190, 32214, 32239, 32262, 32286, 32308, 32330, 32352, 32373, 32393, 32413, 32433, 32452, 32470,
+    32488, 32505, 32522, 32538, 32553, 32568, 32583, 32597, 32610, 32623, 32635, 32647, 32658, 32669, 32679, 32689,
+    32698, 32706, 32714, 32722, 32729, 32735, 32741, 32746, 32750, 32755, 32758, 32761, 32764, 32766, 32767, 32768,
+    32768
+};
+
+// atan(k / ATAN_STEPS) as a fraction of MAX_BOUNCE_ANGLE_RAD
+static const int32_t atanTable[ATAN_STEPS + 1] = {
+    0, 122, 244, 367, 489, 611, 733, 855, 978, 1100, 1222, 1344, 1466, 1588, 1710, 1831,
+    1953, 2075, 2197, 2318, 2440, 2561, 2682, 2804, 2925, 3046, 3167, 3288, 3409, 3530, 3650, 3771,
+    3891, 4012, 4132, 4252, 4372, 4491, 4611, 4731, 4850, 4969, 5088, 5207, 5326, 5445, 5563, 5682,
+    5800, 5918, 6036, 6153, 6271, 6388, 6505, 6622, 6739, 6855, 6972, 7088, 7204, 7320, 7435, 7551,
+    7666, 7781, 7895, 8010, 8124, 8238, 8352, 8466, 8579, 8692, 8805, 8918, 9030, 9142, 9254, 9366,
+    9478, 9589, 9700, 9811, 9921, 10031, 10141, 10251, 10360, 10470, 10578, 10687, 10796, 10904, 11011, 11119,
+    11226, 11333, 11440, 11547, 11653, 11759, 11864, 11970, 12075, 12179, 12284, 12388, 12492, 12596, 12699, 12802,
+    12905, 13007, 13109, 13211, 13313, 13414, 13515, 13616, 13716, 13816, 13916, 14015, 14114, 14213, 14312, 14410,
+    14508, 14606, 14703, 14800, 14897, 14993, 15089, 15185, 15281, 15376, 15471, 15565, 15659, 15753, 15847, 15940,
+    16033, 16126, 16218, 16310, 16402, 16494, 16585, 16676, 16766, 16856, 16946, 17036, 17125, 17214, 17303, 17391,
+    17479, 17567, 17654, 17742, 17828, 17915, 18001, 18087, 18173, 18258, 18343, 18427, 18512, 18596, 18680, 18763,
+    18846, 18929, 19012, 19094, 19176, 19257, 19339, 19420, 19501, 19581, 19661, 19741, 19821, 19900, 19979, 20058,
+    20136, 20214, 20292, 20369, 20446, 20523, 20600, 20676, 20752, 20828, 20904, 20979, 21054, 21128, 21203, 21277,
+    21350, 21424, 21497, 21570, 21643, 21715, 21787, 21859, 21931, 22002, 22073, 22143, 22214, 22284, 22354, 22424,
+    22493, 22562, 22631, 22699, 22768, 22836, 22904, 22971, 23038, 23105, 23172, 23238, 23305, 23371, 23436, 23502,
+    23567, 23632, 23697, 23761, 23825, 23889, 23953, 24016, 24079, 24142, 24205, 24267, 24330, 24392, 24453, 24515,
+    24576
+};
+
+/**
+ * exact for values on the grid, floats hold up to 24 bits so coordinates of up to 2048 fit
+*/
+static inline fixed toFixed(float x) {
+    return (fixed) (x * FIXED_ONE);
+}
+
+static inline float fromFixed(fixed x) {
+    return (float) x / FIXED_ONE;
+}
+
+/**
+ * looks up a table at position pos, in 1 << STEP_SHIFT steps per entry, interpolating linearly
+*/
+static int64_t lookup(const int32_t* table, int64_t pos) {
+    int64_t k = pos >> STEP_SHIFT, frac = pos & ((1 << STEP_SHIFT) - 1);
+    if (frac == 0) return table[k];
+    return table[k] + (((table[k + 1] - table[k]) * frac) >> STEP_SHIFT);
+}
+
+/**
+ * floor of the square root
+*/
+static uint64_t isqrt(uint64_t v) {
+    uint64_t r = 0, bit = 1ull << 62;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= r + bit) {
+            v -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+/**
+ * a * b / c rounded toward zero, in 64 bits
+*/
+static inline fixed mulDiv(int64_t a, int64_t b, int64_t c) {
+    return (fixed) (a * b / c);
+}
+
+/**
+ * scales the ball's velocity to its speed, a vertical velocity of 0 stays exactly 0
+*/
+static void normalizeVelocity(matchState* m) {
+    int64_t vx = toFixed(m->ballVelocityX), vy = toFixed(m->ballVelocityY), speed = toFixed(m->ballSpeed);
+    int64_t length = isqrt(vx * vx + vy * vy);
+    m->ballVelocityX = fromFixed(mulDiv(vx, speed, length));
+    m->ballVelocityY = fromFixed(mulDiv(vy, speed, length));
+}
+
+#endif
+
+void initMatch(matchState* m, uint64_t seed) {
+    m->leftScore = m->rightScore = 0;
+    m->ballSpeed = 0;
+    m->leftStart = true;
+    m->inPlay = false;
+    m->leftComputerShot = m->rightComputerShot = FLAT;
+    m->leftConfig = m->rightConfig = defaultComputerConfig;
+    m->leftIntercept = m->rightIntercept = 0;
+    m->sweptCollisions = false;
+    seedRandom(&m->rng, seed);
+    hideBall(m);
+    m->leftPaddleY = m->rightPaddleY = INIT_PADDLE_Y;
+}
+
+void hideBall(matchState* m) {
+    m->ballX = -BALL_DIM;
+    m->ballY = -BALL_DIM;
+    m->ballVelocityX = 0;
+    m->ballVelocityY = 0;
+    invalidatePrediction(m);
+}
+
+void resetMatch(matchState* m) {
+    m->leftScore = m->rightScore = 0;
+    m->leftPaddleY = m->rightPaddleY = INIT_PADDLE_Y;
+}
+
+/**
+ * true if two computers play alike
+*/
+static bool sameConfig(const computerConfig* a, const computerConfig* b) {
+    return memcmp(a->shotWeights, b->shotWeights, sizeof(a->shotWeights)) == 0 && a->aimingTolerance == b->aimingTolerance;
+}
+
+bool sameMatch(const matchState* a, const matchState* b) {
+    return a->ballX == b->ballX && a->ballY == b->ballY
+            && a->leftPaddleY == b->leftPaddleY && a->rightPaddleY == b->rightPaddleY
+            && a->ballVelocityX == b->ballVelocityX && a->ballVelocityY == b->ballVelocityY
+            && a->ballSpeed == b->ballSpeed && a->leftScore == b->leftScore && a->rightScore == b->rightScore
+            && a->leftStart == b->leftStart && a->inPlay == b->inPlay
+            && a->leftComputerShot == b->leftComputerShot && a->rightComputerShot == b->rightComputerShot
+            && a->rng.key == b->rng.key && a->rng.counter == b->rng.counter
+            && sameConfig(&a->leftConfig, &b->leftConfig) && sameConfig(&a->rightConfig, &b->rightConfig)
+            && a->sweptCollisions == b->sweptCollisions;
+}
+
+/**
+ * 64 bit finalizer from splitmix64
+*/
+static inline uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+void seedRandom(rngStream* r, uint64_t seed) {
+    r->key = mix64(seed);
+    r->counter = 0;
+}
+
+uint32_t nextRandom(rngStream* r) {
+    return mix64((++r->counter * 0x9e3779b97f4a7c15ull) ^ r->key) >> 32;
+}
+
+float randomFloat(rngStream* r) {
+    return (nextRandom(r) >> 8) * 0x1p-24f;
+}
+
+unsigned int randomBelow(rngStream* r, unsigned int n) {
+    return ((uint64_t) nextRandom(r) * n) >> 32;
+}
+
+computerShot getRandomShot(const computerConfig* c, rngStream* rng) {
+    int sum = 0;
+    for (int s = 0; s < SHOT_TYPES; s++) sum += c->shotWeights[s];
+    if (sum <= 0) return FLAT;
+    int r = randomBelow(rng, sum);
+    for (int s = 0; s < ERRATIC_DOWN; s++) {
+        if (r < c->shotWeights[s]) return s;
+        r -= c->shotWeights[s];
+    }
+    return ERRATIC_DOWN;
+}
+
+float ballIntersectY(float tBallX, float tBallY, float tBallVelocityX, float tBallVelocityY) {
+#ifdef PONG_FIXED_POINT
+    fixed x = toFixed(tBallX), y = toFixed(tBallY), vx = toFixed(tBallVelocityX), vy = toFixed(tBallVelocityY);
+    if (vx == 0) return tBallY;
+    // height where the straight line path crosses the paddle plane, folded back off the walls
+    fixed paddleX = vx < 0 ? FX(LEFT_PADDLE_X) : FX(RIGHT_PADDLE_X);
+    int64_t period = 2 * (int64_t) FX(WINDOW_HEIGHTF);
+    int64_t crossY = (y + (int64_t) vy * (paddleX - x) / vx) % period;
+    if (crossY < 0) crossY += period;
+    if (crossY > FX(WINDOW_HEIGHTF)) crossY = period - crossY;
+    return fromFixed(crossY);
+#else
+    float yBounceTime;
+    if (tBallVelocityY > 0) {
+        yBounceTime = (WINDOW_HEIGHTF - tBallY) / tBallVelocityY;
+    } else {
+        yBounceTime = tBallY / -tBallVelocityY;
+    }
+    float xBounceTime;
+    if (tBallVelocityX < 0) {
+        xBounceTime = (LEFT_PADDLE_X - tBallX) / tBallVelocityX;
+    } else {
+        xBounceTime = (RIGHT_PADDLE_X - tBallX) / tBallVelocityX;
+    }
+
+    float y = tBallY + tBallVelocityY * xBounceTime;
+    // if hits a paddle next, return height of collision
+    if (xBounceTime < yBounceTime) {
+        return y;
+    }
+
+    // reflections off the walls repeat every two court heights, fold the straight line path back in
+    y = fmodf(y, 2 * WINDOW_HEIGHTF);
+    if (y < 0) y += 2 * WINDOW_HEIGHTF;
+    if (y > WINDOW_HEIGHTF) y = 2 * WINDOW_HEIGHTF - y;
+    return y;
+#endif
+}
+
+int ballBounces(float tBallX, float tBallY, float tBallVelocityX, float tBallVelocityY) {
+    float xBounceTime = ((tBallVelocityX < 0 ? LEFT_PADDLE_X : RIGHT_PADDLE_X) - tBallX) / tBallVelocityX;
+    float y = tBallY + tBallVelocityY * xBounceTime;
+    if (y > WINDOW_HEIGHTF) return (int) (y / WINDOW_HEIGHTF);
+    if (y < 0) return (int) (-y / WINDOW_HEIGHTF) + 1;
+    return 0;
+}
+
+void invalidatePrediction(matchState* m) {
+    m->leftPredicted = m->rightPredicted = false;
+}
+
+double aimingTolerance(const computerConfig* c) {
+#ifdef PONG_FIXED_POINT
+    return (double) lround(c->aimingTolerance * FIXED_ONE) / FIXED_ONE;
+#else
+    return c->aimingTolerance;
+#endif
+}
+
+float targetAimingShift(float yChange, double aimingTolerance) {
+#ifdef PONG_FIXED_POINT
+    // share of MAX_BOUNCE_ANGLE the ball has to leave at to cover yChange on its way across
+    int64_t rise = toFixed(yChange);
+    rise = rise < 0 ? -rise : rise;
+    int64_t pos = min((rise * ATAN_STEPS << STEP_SHIFT) / FX(RIGHT_PADDLE_X - LEFT_PADDLE_X), (int64_t) ATAN_STEPS << STEP_SHIFT);
+    int64_t relY = lookup(atanTable, pos) * FX(PADDLE_HEIGHT / 2) >> TABLE_SHIFT;
+    relY = min(relY, FX(PADDLE_HEIGHT / 2) - lround(aimingTolerance * FIXED_ONE));
+    fixed shift = relY < 0 ? -relY : relY;
+    return fromFixed(signbit(yChange) ? shift : -shift);
+#else
+    float angle = M_PI / 2. - atan2f(RIGHT_PADDLE_X - LEFT_PADDLE_X, fabsf(yChange));
+    float relY = angle / MAX_BOUNCE_ANGLE_RAD * PADDLE_HEIGHT / 2.;
+    relY = min(relY, PADDLE_HEIGHT / 2 - aimingTolerance);
+    float shift = -copysignf(relY, yChange);
+    return shift;
+#endif
+}
+
+/**
+ * computerTarget, inlined into the scalar controllers so their view never has to be built in memory
+*/
+__attribute__((always_inline)) static inline float viewTarget(const computerView* v) {
+    float targetY;
+    if ((v->left ? v->ballVelocityX > 0 : v->ballVelocityX < 0) || !v->inPlay) targetY = MIDDLE_PADDLE_Y;
+    else {
+        if (v->ballVelocityY == 0) targetY = v->ballY;
+        else {
+            if (!*v->predicted) {
+                *v->intercept = ballIntersectY(v->ballX + BALL_RADIUS, v->ballY + BALL_RADIUS, v->ballVelocityX, v->ballVelocityY);
+                *v->predicted = true;
+            }
+            targetY = *v->intercept;
+        }
+        targetY -= PADDLE_HEIGHT / 2;
+        switch (v->shot) {
+            case TOP:
+                targetY += targetAimingShift(MAX_PADDLE_Y - v->paddleY - PADDLE_HEIGHT / 2., v->aimingTolerance);
+                break;
+            case BOTTOM:
+                targetY += targetAimingShift(-v->paddleY + PADDLE_HEIGHT / 2., v->aimingTolerance);
+                break;
+            case FLAT:
+                // dummy target
+                break;
+            case AGGRESSIVE:
+                targetY += targetAimingShift(v->otherPaddleY > MIDDLE_PADDLE_Y ? -v->paddleY + PADDLE_HEIGHT / 2. : MAX_PADDLE_Y - v->paddleY - PADDLE_HEIGHT / 2., v->aimingTolerance);
+                break;
+            case EASY:
+                targetY += targetAimingShift(v->otherPaddleY - v->paddleY, v->aimingTolerance);
+                break;
+            case ERRATIC_UP:
+                targetY -= (PADDLE_HEIGHT / 2) - v->aimingTolerance;
+                break;
+            case ERRATIC_DOWN:
+                targetY += (PADDLE_HEIGHT / 2) - v->aimingTolerance;
+                break;
+        }
+    }
+    return targetY;
+}
+
+float computerTarget(const computerView* v) {
+    return viewTarget(v);
+}
+
+direction steerPaddle(float paddleY, float targetY, double aimingTolerance) {
+    if (paddleY < targetY - aimingTolerance) {
+        return UP;
+    }
+    if (paddleY > targetY + aimingTolerance) {
+        return DOWN;
+    }
+    return STATIC;
+}
+
+direction computerDirection(const computerView* v) {
+    return steerPaddle(v->paddleY, viewTarget(v), v->aimingTolerance);
+}
+
+/**
+ * the left computer's view of a match
+*/
+static computerView leftView(matchState* m) {
+    return (computerView) {
+        true, m->ballX, m->ballY, m->ballVelocityX, m->ballVelocityY, m->inPlay, m->leftPaddleY, m->rightPaddleY,
+        m->leftComputerShot, aimingTolerance(&m->leftConfig), &m->leftIntercept, &m->leftPredicted
+    };
+}
+
+/**
+ * the right computer's view of a match
+*/
+static computerView rightView(matchState* m) {
+    return (computerView) {
+        false, m->ballX, m->ballY, m->ballVelocityX, m->ballVelocityY, m->inPlay, m->rightPaddleY, m->leftPaddleY,
+        m->rightComputerShot, aimingTolerance(&m->rightConfig), &m->rightIntercept, &m->rightPredicted
+    };
+}
+
+float leftComputerTarget(matchState* m) {
+    computerView v = leftView(m);
+    return viewTarget(&v);
+}
+
+direction leftComputerController(matchState* m) {
+    computerView v = leftView(m);
+    return steerPaddle(v.paddleY, viewTarget(&v), v.aimingTolerance);
+}
+
+float rightComputerTarget(matchState* m) {
+    computerView v = rightView(m);
+    return viewTarget(&v);
+}
+
+direction rightComputerController(matchState* m) {
+    computerView v = rightView(m);
+    return steerPaddle(v.paddleY, viewTarget(&v), v.aimingTolerance);
+}
+
+void accelerateBall(matchState* m) {
+#ifdef PONG_FIXED_POINT
+    m->ballSpeed = fromFixed(min(toFixed(m->ballSpeed) * FIXED_ACCELERATION >> FIXED_SHIFT, FX(MAX_BALL_SPEED)));
+    normalizeVelocity(m);
+#else
+    m->ballSpeed = min(m->ballSpeed * BALL_SPEED_ACCELERATION, MAX_BALL_SPEED);
+    float vel = sqrtf(m->ballVelocityX * m->ballVelocityX + m->ballVelocityY * m->ballVelocityY);
+    vel /= m->ballSpeed;
+    m->ballVelocityX /= vel;
+    if (m->ballVelocityY != 0) m->ballVelocityY /= vel;
+#endif
+}
+
+void serveBall(matchState* m) {
+    m->ballSpeed = INITIAL_BALL_SPEED;
+    m->ballX = WINDOW_WIDTHF / 2;
+    m->ballY = WINDOW_HEIGHTF / 2;
+    m->ballVelocityX = m->leftStart ? -10. : 10.;
+#ifdef PONG_FIXED_POINT
+    // the same draw as randomFloat, cut to the grid
+    m->ballVelocityY = fromFixed((fixed) (nextRandom(&m->rng) >> (31 - FIXED_SHIFT)) - FIXED_ONE);
+    normalizeVelocity(m);
+#else
+    m->ballVelocityY = 2.f * randomFloat(&m->rng) - 1.f;
+    float vel = sqrtf(m->ballVelocityX * m->ballVelocityX + m->ballVelocityY * m->ballVelocityY);
+    vel /= m->ballSpeed;
+    m->ballVelocityX /= vel;
+    if (m->ballVelocityY != 0) m->ballVelocityY /= vel;
+#endif
+    m->leftStart = !m->leftStart;
+    m->inPlay = true;
+    invalidatePrediction(m);
+}
+
+/**
+ * score colliders, ends the round once the ball is past either edge
+*/
+static matchEvent scoreBall(matchState* m) {
+    if (m->ballX < 0) {
+        m->rightScore++;
+        m->inPlay = false;
+        return m->rightScore == TARGET_SCORE ? RIGHT_WIN : RIGHT_POINT;
+    } else if (m->ballX + BALL_DIM > WINDOW_WIDTHF) {
+        m->leftScore++;
+        m->inPlay = false;
+        return m->leftScore == TARGET_SCORE ? LEFT_WIN : LEFT_POINT;
+    }
+    return NO_EVENT;
+}
+
+/**
+ * sends the ball off a paddle, the angle depends on where along the paddle it hit
+ * sign is 1 for the left paddle and -1 for the right
+*/
+static void bouncePaddle(matchState* m, float paddleY, float sign) {
+#ifdef PONG_FIXED_POINT
+    fixed relY = toFixed(m->ballY) + FX(BALL_RADIUS) - toFixed(paddleY) - FX(PADDLE_HEIGHT / 2);
+    // position in sinTable, a hit on the end of the paddle leaves at MAX_BOUNCE_ANGLE
+    int64_t pos = ((int64_t) (relY < 0 ? -relY : relY) * ANGLE_STEPS << STEP_SHIFT) / FX(PADDLE_HEIGHT / 2);
+    pos = min(pos, (int64_t) QUARTER_STEPS << STEP_SHIFT);
+    int64_t speed = toFixed(m->ballSpeed);
+    fixed vx = speed * lookup(sinTable, ((int64_t) QUARTER_STEPS << STEP_SHIFT) - pos) >> TABLE_SHIFT;
+    fixed vy = speed * lookup(sinTable, pos) >> TABLE_SHIFT;
+    m->ballVelocityX = fromFixed(sign < 0 ? -vx : vx);
+    m->ballVelocityY = fromFixed(relY < 0 ? -vy : vy);
+#else
+    float relY = m->ballY + BALL_RADIUS - paddleY - (PADDLE_HEIGHT / 2);
+    relY /= (PADDLE_HEIGHT / 2);
+    float bounceAngle = relY * MAX_BOUNCE_ANGLE_RAD;
+    m->ballVelocityX = sign * m->ballSpeed * cosf(bounceAngle);
+    m->ballVelocityY = m->ballSpeed * sinf(bounceAngle);
+#endif
+}
+
+void hitPaddle(matchState* m, float paddleY, float sign) {
+    m->ballX -= m->ballVelocityX;
+    bouncePaddle(m, paddleY, sign);
+    m->ballY += m->ballVelocityY;
+    accelerateBall(m);
+}
+
+/**
+ * moves the ball through one tick, reflecting it at the earliest time of impact with a wall,
+ * paddle face or paddle top and bottom edge and carrying on from there with the rest of the tick
+ * paddles move linearly from their heights at the start of the tick, fromY, to their current ones
+ * an edge sends vy back, at least as fast as the paddle moves away from the ball so it can't catch it again
+*/
+static void sweepBall(matchState* m, float leftFromY, float rightFromY) {
+    enum {NO_CONTACT, WALL_CONTACT, EDGE_CONTACT, LEFT_CONTACT, RIGHT_CONTACT};
+    // only the paddle on the ball's half of the court can be reached within a tick
+    bool nearLeft = m->ballX + BALL_RADIUS < WINDOW_WIDTHF / 2;
+    float edgeBackX = nearLeft ? LEFT_PADDLE_X - PADDLE_WIDTH : RIGHT_PADDLE_X;
+#ifdef PONG_FIXED_POINT
+    // times are in 1 / TICK_ONE of a tick
+    const int64_t TICK_ONE = 1 << 16;
+    int64_t x = toFixed(m->ballX), y = toFixed(m->ballY), vx = toFixed(m->ballVelocityX), vy = toFixed(m->ballVelocityY);
+    int64_t toX = x + vx, toY = y + vy;
+    // a ball staying between the paddle faces can only touch the walls
+    bool betweenFaces = min(x, toX) >= FX(LEFT_PADDLE_X) && max(x, toX) + FX(BALL_DIM) <= FX(RIGHT_PADDLE_X);
+    if (toY >= 0 && toY <= FX(WINDOW_HEIGHTF - BALL_DIM) && betweenFaces) {
+        m->ballX = fromFixed(toX);
+        m->ballY = fromFixed(toY);
+        return;
+    }
+
+    int64_t remaining = TICK_ONE;
+    for (int i = 0; i < SWEPT_MAX_CONTACTS; i++) {
+        int contact = NO_CONTACT;
+        int64_t t = remaining;
+        int64_t paddleY = 0;
+
+        // top and bottom
+        if (vy != 0) {
+            int64_t wallT = max((vy > 0 ? FX(WINDOW_HEIGHTF - BALL_DIM) - y : y) * TICK_ONE / (vy > 0 ? vy : -vy), 0);
+            if (wallT < t) {
+                t = wallT;
+                contact = WALL_CONTACT;
+            }
+        }
+
+        // paddle top and bottom edges, only reachable from beside the paddle
+        int64_t edgeFromY = toFixed(nearLeft ? leftFromY : rightFromY);
+        int64_t paddleVy = toFixed(nearLeft ? m->leftPaddleY : m->rightPaddleY) - edgeFromY;
+        int64_t paddleNow = edgeFromY + paddleVy * (TICK_ONE - remaining) / TICK_ONE;
+        int64_t closing = vy - paddleVy, edgeT = t;
+        if (closing < 0 && y >= paddleNow + FX(PADDLE_HEIGHT)) {
+            edgeT = (paddleNow + FX(PADDLE_HEIGHT) - y) * TICK_ONE / closing;
+        } else if (closing > 0 && y + FX(BALL_DIM) <= paddleNow) {
+            edgeT = (paddleNow - FX(BALL_DIM) - y) * TICK_ONE / closing;
+        }
+        if (edgeT < t) {
+            int64_t edgeX = x + vx * edgeT / TICK_ONE;
+            if (edgeX + FX(BALL_DIM) > toFixed(edgeBackX) && edgeX < toFixed(edgeBackX) + FX(PADDLE_WIDTH)) {
+                t = edgeT;
+                contact = EDGE_CONTACT;
+                paddleY = paddleNow + paddleVy * edgeT / TICK_ONE;
+            }
+        }
+
+        // paddle faces, only reachable from in front
+        int64_t faceT = t;
+        if (vx < 0 && x >= FX(LEFT_PADDLE_X)) {
+            faceT = (FX(LEFT_PADDLE_X) - x) * TICK_ONE / vx;
+        } else if (vx > 0 && x + FX(BALL_DIM) <= FX(RIGHT_PADDLE_X)) {
+            faceT = (FX(RIGHT_PADDLE_X - BALL_DIM) - x) * TICK_ONE / vx;
+        }
+        if (faceT < t) {
+            bool left = vx < 0;
+            int64_t fromY = toFixed(left ? leftFromY : rightFromY);
+            int64_t toY = toFixed(left ? m->leftPaddleY : m->rightPaddleY);
+            int64_t hitY = fromY + (toY - fromY) * (TICK_ONE - remaining + faceT) / TICK_ONE;
+            int64_t ballY = y + vy * faceT / TICK_ONE;
+            if (ballY + FX(BALL_DIM) > hitY && ballY < hitY + FX(PADDLE_HEIGHT)) {
+                t = faceT;
+                contact = left ? LEFT_CONTACT : RIGHT_CONTACT;
+                paddleY = hitY;
+            }
+        }
+
+        x += vx * t / TICK_ONE;
+        y += vy * t / TICK_ONE;
+        remaining -= t;
+        if (contact == WALL_CONTACT) {
+            y = vy > 0 ? FX(WINDOW_HEIGHTF - BALL_DIM) : 0;
+            vy = -vy;
+        } else if (contact == EDGE_CONTACT) {
+            y = closing < 0 ? paddleY + FX(PADDLE_HEIGHT) : paddleY - FX(BALL_DIM);
+            vy = closing < 0 ? max(-vy, paddleVy) : min(-vy, paddleVy);
+        } else if (contact != NO_CONTACT) {
+            x = contact == LEFT_CONTACT ? FX(LEFT_PADDLE_X) : FX(RIGHT_PADDLE_X - BALL_DIM);
+        }
+        m->ballX = fromFixed(x);
+        m->ballY = fromFixed(y);
+        m->ballVelocityY = fromFixed(vy);
+        switch (contact) {
+            case NO_CONTACT:
+                return;
+            case WALL_CONTACT:
+            case EDGE_CONTACT:
+                break;
+            case LEFT_CONTACT:
+                bouncePaddle(m, fromFixed(paddleY), 1);
+                m->leftComputerShot = getRandomShot(&m->leftConfig, &m->rng);
+                accelerateBall(m);
+                break;
+            case RIGHT_CONTACT:
+                bouncePaddle(m, fromFixed(paddleY), -1);
+                m->rightComputerShot = getRandomShot(&m->rightConfig, &m->rng);
+                accelerateBall(m);
+                break;
+        }
+        vx = toFixed(m->ballVelocityX);
+        vy = toFixed(m->ballVelocityY);
+        invalidatePrediction(m);
+    }
+#else
+    // most ticks touch nothing, skip the time of impact divisions for them
+    float toX = m->ballX + m->ballVelocityX, toY = m->ballY + m->ballVelocityY;
+    bool betweenFaces = min(m->ballX, toX) >= LEFT_PADDLE_X && max(m->ballX, toX) + BALL_DIM <= RIGHT_PADDLE_X;
+    if (toY >= 0 && toY <= WINDOW_HEIGHTF - BALL_DIM && betweenFaces) {
+        m->ballX = toX;
+        m->ballY = toY;
+        return;
+    }
+
+    float remaining = 1;
+    for (int i = 0; i < SWEPT_MAX_CONTACTS; i++) {
+        int contact = NO_CONTACT;
+        float t = remaining;
+        float paddleY = 0;
+
+        // top and bottom
+        if (m->ballVelocityY > 0) {
+            float wallT = max((WINDOW_HEIGHTF - BALL_DIM - m->ballY) / m->ballVelocityY, 0);
+            if (wallT < t) {
+                t = wallT;
+                contact = WALL_CONTACT;
+            }
+        } else if (m->ballVelocityY < 0) {
+            float wallT = max(m->ballY / -m->ballVelocityY, 0);
+            if (wallT < t) {
+                t = wallT;
+                contact = WALL_CONTACT;
+            }
+        }
+
+        // paddle top and bottom edges, only reachable from beside the paddle
+        float edgeFromY = nearLeft ? leftFromY : rightFromY;
+        float paddleVy = (nearLeft ? m->leftPaddleY : m->rightPaddleY) - edgeFromY;
+        float paddleNow = edgeFromY + paddleVy * (1 - remaining);
+        float closing = m->ballVelocityY - paddleVy, edgeT = t;
+        if (closing < 0 && m->ballY >= paddleNow + PADDLE_HEIGHT) {
+            edgeT = (paddleNow + PADDLE_HEIGHT - m->ballY) / closing;
+        } else if (closing > 0 && m->ballY + BALL_DIM <= paddleNow) {
+            edgeT = (paddleNow - BALL_DIM - m->ballY) / closing;
+        }
+        if (edgeT < t) {
+            float edgeX = m->ballX + m->ballVelocityX * edgeT;
+            if (edgeX + BALL_DIM > edgeBackX && edgeX < edgeBackX + PADDLE_WIDTH) {
+                t = edgeT;
+                contact = EDGE_CONTACT;
+                paddleY = paddleNow + paddleVy * edgeT;
+            }
+        }
+
+        // paddle faces, only reachable from in front
+        float faceT = t;
+        if (m->ballVelocityX < 0 && m->ballX >= LEFT_PADDLE_X) {
+            faceT = (LEFT_PADDLE_X - m->ballX) / m->ballVelocityX;
+        } else if (m->ballVelocityX > 0 && m->ballX + BALL_DIM <= RIGHT_PADDLE_X) {
+            faceT = (RIGHT_PADDLE_X - BALL_DIM - m->ballX) / m->ballVelocityX;
+        }
+        if (faceT < t) {
+            bool left = m->ballVelocityX < 0;
+            float fromY = left ? leftFromY : rightFromY;
+            float toY = left ? m->leftPaddleY : m->rightPaddleY;
+            float hitY = fromY + (toY - fromY) * (1 - remaining + faceT);
+            float ballY = m->ballY + m->ballVelocityY * faceT;
+            if (ballY + BALL_DIM > hitY && ballY < hitY + PADDLE_HEIGHT) {
+                t = faceT;
+                contact = left ? LEFT_CONTACT : RIGHT_CONTACT;
+                paddleY = hitY;
+            }
+        }
+
+        m->ballX += m->ballVelocityX * t;
+        m->ballY += m->ballVelocityY * t;
+        remaining -= t;
+        switch (contact) {
+            case NO_CONTACT:
+                return;
+            case WALL_CONTACT:
+                m->ballY = m->ballVelocityY > 0 ? WINDOW_HEIGHTF - BALL_DIM : 0;
+                m->ballVelocityY = -m->ballVelocityY;
+                break;
+            case EDGE_CONTACT:
+                m->ballY = closing < 0 ? paddleY + PADDLE_HEIGHT : paddleY - BALL_DIM;
+                m->ballVelocityY = closing < 0 ? max(-m->ballVelocityY, paddleVy) : min(-m->ballVelocityY, paddleVy);
+                break;
+            case LEFT_CONTACT:
+                m->ballX = LEFT_PADDLE_X;
+                bouncePaddle(m, paddleY, 1);
+                m->leftComputerShot = getRandomShot(&m->leftConfig, &m->rng);
+                accelerateBall(m);
+                break;
+            case RIGHT_CONTACT:
+                m->ballX = RIGHT_PADDLE_X - BALL_DIM;
+                bouncePaddle(m, paddleY, -1);
+                m->rightComputerShot = getRandomShot(&m->rightConfig, &m->rng);
+                accelerateBall(m);
+                break;
+        }
+        invalidatePrediction(m);
+    }
+#endif
+}
+
+matchEvent stepMatch(matchState* m, direction left, direction right) {
+    float leftFromY = m->leftPaddleY, rightFromY = m->rightPaddleY;
+    if (left == DOWN) {
+        m->leftPaddleY = max(m->leftPaddleY - WINDOW_HEIGHTF / 512. * PADDLE_SPEED, MIN_PADDLE_Y);
+    } else if (left == UP) {
+        m->leftPaddleY = min(m->leftPaddleY + WINDOW_HEIGHTF / 512. * PADDLE_SPEED, MAX_PADDLE_Y);
+    }
+    if (right == DOWN) {
+        m->rightPaddleY = max(m->rightPaddleY - WINDOW_HEIGHTF / 512. * PADDLE_SPEED, MIN_PADDLE_Y);
+    } else if (right == UP) {
+        m->rightPaddleY = min(m->rightPaddleY + WINDOW_HEIGHTF / 512. * PADDLE_SPEED, MAX_PADDLE_Y);
+    }
+
+    if (m->inPlay && m->sweptCollisions) {
+        sweepBall(m, leftFromY, rightFromY);
+        return scoreBall(m);
+    }
+
+    m->ballX += m->ballVelocityX;
+    m->ballY += m->ballVelocityY;
+
+    // only calculate collisions if ball is in play
+    if (!m->inPlay) return NO_EVENT;
+
+    // Simple collision resolvers that rely on low speed and small BALL_DIM to be accurate
+    // top and bottom
+    if (m->ballY + BALL_DIM > WINDOW_HEIGHTF) {
+        m->ballVelocityY = -m->ballVelocityY;
+        m->ballY += m->ballVelocityY;
+        invalidatePrediction(m);
+    } else if (m->ballY < 0) {
+        m->ballVelocityY = -m->ballVelocityY;
+        m->ballY += m->ballVelocityY;
+        invalidatePrediction(m);
+    }
+
+    // paddles
+    if (m->ballX < LEFT_PADDLE_X && m->ballX > LEFT_PADDLE_X - PADDLE_INVISIBLE_COLLIDER_WIDTH - PADDLE_WIDTH && m->ballY + BALL_DIM > m->leftPaddleY && m->ballY < m->leftPaddleY + PADDLE_HEIGHT) {
+        hitPaddle(m, m->leftPaddleY, 1);
+        m->leftComputerShot = getRandomShot(&m->leftConfig, &m->rng);
+        invalidatePrediction(m);
+    } else if (m->ballX + BALL_DIM > RIGHT_PADDLE_X && m->ballX + BALL_DIM < RIGHT_PADDLE_X + PADDLE_WIDTH + PADDLE_INVISIBLE_COLLIDER_WIDTH && m->ballY + BALL_DIM > m->rightPaddleY && m->ballY < m->rightPaddleY + PADDLE_HEIGHT) {
+        hitPaddle(m, m->rightPaddleY, -1);
+        m->rightComputerShot = getRandomShot(&m->rightConfig, &m->rng);
+        invalidatePrediction(m);
+    }
+
+    return scoreBall(m);
+}
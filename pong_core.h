@@ -0,0 +1,298 @@
+#ifndef PONG_CORE_H
+#define PONG_CORE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// court dimensions (the game is played in window coordinates)
+#define WINDOW_WIDTHF (1200.)
+#define WINDOW_HEIGHTF (900.)
+
+// timing constants
+#define FRAME_RATE (60.)
+#define SCORE_DELAY (1.)
+#define RESUME_DELAY (1.)
+#define SCORE_DELAY_TICKS ((int) (SCORE_DELAY * FRAME_RATE))
+#define RESUME_DELAY_TICKS ((int) (RESUME_DELAY * FRAME_RATE))
+
+// fixed point physics, built with make FIXED=1
+// every coordinate, velocity and speed stays on a grid of 1 / FIXED_ONE, where float addition, subtraction
+// and comparison are exact, and everything that would round (division, square roots, trig) is done in integers,
+// so a match plays out bit for bit the same under any compiler, optimization flags or floating point unit
+#ifdef PONG_FIXED_POINT
+#define FIXED_SHIFT (12)
+#define FIXED_ONE (1 << FIXED_SHIFT)
+// rounds a positive constant to the grid
+#define GRID(x) ((double) (int64_t) ((x) * FIXED_ONE + .5) / FIXED_ONE)
+#else
+#define GRID(x) (x)
+#endif
+
+// game constants
+#define PADDLE_SPEED (4.)
+#define INITIAL_BALL_SPEED (10)
+#define MAX_BALL_SPEED (24.)
+#define BALL_SPEED_ACCELERATION (1.03)
+#define MAX_BOUNCE_ANGLE (60.)
+#define TARGET_SCORE (10.)
+#define PADDLE_HEIGHT (WINDOW_HEIGHTF / 8.)
+#define PADDLE_WIDTH (GRID(WINDOW_WIDTHF / 90.))
+#define BALL_RADIUS (WINDOW_WIDTHF / 240.)
+
+// contacts resolved per tick by swept collisions, any time left after that is dropped
+#define SWEPT_MAX_CONTACTS (8)
+
+// headless runners give up on a match after this many ticks, computer rallies can loop forever
+#define MAX_MATCH_TICKS (1000000)
+
+// computer aiming probabilities
+#define PROB_TOP (23)
+#define PROB_BOTTOM (23)
+#define PROB_FLAT (15)
+#define PROB_EASY (5)
+#define PROB_AGGRESSIVE (24)
+#define PROB_ERRATIC_UP (5)
+#define PROB_ERRATIC_DOWN (5)
+#define PROB_WEIGHT_SUM (PROB_TOP + PROB_BOTTOM + PROB_FLAT + PROB_EASY + PROB_AGGRESSIVE + PROB_ERRATIC_UP + PROB_ERRATIC_DOWN)
+
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min(a, b) ((a) < (b) ? (a) : (b))
+
+// derived game values
+#define MAX_BOUNCE_ANGLE_RAD (M_PI * MAX_BOUNCE_ANGLE / 180.)
+#define COMPUTER_AIMING_TOLERANCE (PADDLE_SPEED)
+#define PADDLE_INVISIBLE_COLLIDER_WIDTH (max(0, MAX_BALL_SPEED - PADDLE_WIDTH))
+#define BALL_DIM (2. * BALL_RADIUS)
+#define MAX_PADDLE_Y (WINDOW_HEIGHTF - PADDLE_HEIGHT)
+#define MIN_PADDLE_Y (0.)
+#define MIDDLE_PADDLE_Y ((MAX_PADDLE_Y - MIN_PADDLE_Y) / 2.)
+#define LEFT_PADDLE_X (50.)
+#define RIGHT_PADDLE_X (WINDOW_WIDTHF - LEFT_PADDLE_X)
+#define INIT_PADDLE_Y (MIDDLE_PADDLE_Y)
+
+// paddle movement directives
+typedef enum {
+    UP, DOWN, STATIC
+} direction;
+
+// computer controlled shot types
+typedef enum {
+    FLAT, TOP, BOTTOM, AGGRESSIVE, EASY, ERRATIC_UP, ERRATIC_DOWN
+} computerShot;
+
+#define SHOT_TYPES (ERRATIC_DOWN + 1)
+
+/**
+ * tunable computer behavior
+ * shotWeights are the relative odds of each computerShot, indexed by shot
+*/
+typedef struct {
+    int shotWeights[SHOT_TYPES];
+    double aimingTolerance;
+} computerConfig;
+
+// built from the PROB_* weights and COMPUTER_AIMING_TOLERANCE
+extern const computerConfig defaultComputerConfig;
+
+/**
+ * counter-based random stream
+ * each draw hashes the key with the draw count, so a stream is two words of plain data
+ * that can be copied, saved and rewound, and matches never share generator state
+*/
+typedef struct {
+    uint64_t key, counter;
+} rngStream;
+
+// outcome of advancing a match by one tick
+typedef enum {
+    NO_EVENT, LEFT_POINT, RIGHT_POINT, LEFT_WIN, RIGHT_WIN
+} matchEvent;
+
+/**
+ * complete state of a single match
+ * plain data, may be freely copied
+*/
+typedef struct {
+    float ballX, ballY, leftPaddleY, rightPaddleY;
+    float ballVelocityX, ballVelocityY;
+    float ballSpeed;
+    unsigned char leftScore, rightScore;
+    // ball starting direction
+    bool leftStart;
+    // false while the ball is between rounds
+    bool inPlay;
+    computerShot leftComputerShot, rightComputerShot;
+    computerConfig leftConfig, rightConfig;
+    // cached ballIntersectY results, cleared whenever the ball bounces or is served
+    float leftIntercept, rightIntercept;
+    bool leftPredicted, rightPredicted;
+    // random stream for shot selection and serves
+    rngStream rng;
+    // resolve collisions by time of impact instead of the legacy overlap tests
+    bool sweptCollisions;
+} matchState;
+
+// paddle controller functions (called to determine direction to move)
+// may fill the match's prediction cache
+typedef direction (*paddleController)(matchState*);
+
+/**
+ * sets up a fresh match with the ball hidden and paddles centered
+ * both computers start with defaultComputerConfig, collisions start in the legacy mode
+*/
+void initMatch(matchState* m, uint64_t seed);
+
+/**
+ * moves the ball off screen and stops it
+*/
+void hideBall(matchState* m);
+
+/**
+ * centers the paddles and zeroes the scores
+*/
+void resetMatch(matchState* m);
+
+/**
+ * true if two matches agree on everything stepMatch and the computer controllers decide from: positions,
+ * velocities, scores, serve side, shots, configs, collision mode and the random stream
+ * the controllers' ballIntersectY caches are left out, a replay never runs the controllers so it never fills them,
+ * compare them separately where both matches were played by computers
+*/
+bool sameMatch(const matchState* a, const matchState* b);
+
+/**
+ * resets the ball position for a new round and puts it in play
+*/
+void serveBall(matchState* m);
+
+/**
+ * advances the match by one tick using the given paddle directions
+ * both directions are decided before either paddle moves, so a right computer sees the left paddle where it
+ * was at the start of the tick (the original game moved the left paddle before asking the right controller);
+ * the tick is then a function of the state and both inputs, which replays, rollback and netplay rely on
+ * with sweptCollisions the ball is swept against the walls and the paddles' faces and edges and the tick is split
+ * at every time of impact, so it cannot tunnel whatever its speed
+ * after a *_WIN event the final score is left in place for the caller
+*/
+matchEvent stepMatch(matchState* m, direction left, direction right);
+
+/**
+ * starts a random stream, different seeds give unrelated streams
+*/
+void seedRandom(rngStream* r, uint64_t seed);
+
+/**
+ * next 32 random bits from the stream
+*/
+uint32_t nextRandom(rngStream* r);
+
+/**
+ * uniform float in [0, 1)
+*/
+float randomFloat(rngStream* r);
+
+/**
+ * uniform integer in [0, n)
+*/
+unsigned int randomBelow(rngStream* r, unsigned int n);
+
+/**
+ * Generates a random shot type for the computer to aim for
+*/
+computerShot getRandomShot(const computerConfig* c, rngStream* rng);
+
+/**
+ * tolerance the computer aims with, on the fixed point grid in fixed point builds
+*/
+double aimingTolerance(const computerConfig* c);
+
+/**
+ * Returns the y value of the next time the ball will intersect a paddle
+ * pass the current ball position and velocity
+ * wall bounces are folded in closed form rather than followed one at a time
+*/
+float ballIntersectY(float tBallX, float tBallY, float tBallVelocityX, float tBallVelocityY);
+
+/**
+ * number of wall bounces ballIntersectY folds in for the same arguments
+*/
+int ballBounces(float tBallX, float tBallY, float tBallVelocityX, float tBallVelocityY);
+
+/**
+ * drops both sides' cached intercepts, call whenever the ball changes direction
+*/
+void invalidatePrediction(matchState* m);
+
+/**
+ * returns the amount to shift the paddle in order to send the ball a specified distance (y value)
+ * up or down on the other side
+*/
+float targetAimingShift(float yChange, double aimingTolerance);
+
+/**
+ * increases the speed of the ball
+*/
+void accelerateBall(matchState* m);
+
+/**
+ * answers a paddle hit found by the legacy overlap test: backs the ball out of the paddle,
+ * bounces it off at an angle set by where it hit and speeds it up
+ * sign is 1 for the left paddle and -1 for the right
+*/
+void hitPaddle(matchState* m, float paddleY, float sign);
+
+/**
+ * everything a computer controller reads of a match, seen from the side it plays
+ * engines that keep matches in another layout fill one from there instead of building a whole matchState
+*/
+typedef struct {
+    // true for the left paddle
+    bool left;
+    float ballX, ballY, ballVelocityX, ballVelocityY;
+    bool inPlay;
+    // the controlled paddle and the one across the court
+    float paddleY, otherPaddleY;
+    computerShot shot;
+    // aimingTolerance() of the side's config
+    double aimingTolerance;
+    // the side's ballIntersectY cache, filled on first use
+    float* intercept;
+    bool* predicted;
+} computerView;
+
+/**
+ * height a computer is steering its paddle towards
+*/
+float computerTarget(const computerView* v);
+
+/**
+ * which way a computer moves a paddle at paddleY to bring it within aimingTolerance of targetY
+*/
+direction steerPaddle(float paddleY, float targetY, double aimingTolerance);
+
+/**
+ * computer controller for either paddle, steering towards computerTarget
+*/
+direction computerDirection(const computerView* v);
+
+/**
+ * height the left computer is steering its paddle towards
+*/
+float leftComputerTarget(matchState* m);
+
+/**
+ * height the right computer is steering its paddle towards
+*/
+float rightComputerTarget(matchState* m);
+
+/**
+ * computer controller for the left paddle
+*/
+direction leftComputerController(matchState* m);
+
+/**
+ * computer controller for the right paddle
+*/
+direction rightComputerController(matchState* m);
+
+#endif
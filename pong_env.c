@@ -0,0 +1,153 @@
+#include "pong_env.h"
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "pong_core.h"
+#include "pong_batch.h"
+#include "pong_raster.h"
+
+struct pongEnv {
+    matchBatch batch;
+    int flags;
+    // seed of the next episode started
+    uint64_t nextSeed;
+    uint32_t* steps;
+    // done flags of a finished episode waiting for a reset, 0 while it runs
+    uint8_t* finished;
+    // renderer of the last renderEnv size, background NULL before the first
+    sceneRenderer renderer;
+};
+
+/**
+ * a fresh match on lane i with the ball already served
+*/
+static void restartLane(pongEnv* e, int i) {
+    matchState m;
+    initMatch(&m, e->nextSeed++);
+    serveBall(&m);
+    storeLane(&e->batch, i, &m);
+    e->steps[i] = 0;
+    e->finished[i] = 0;
+}
+
+pongEnv* createEnv(int count, uint64_t seed, int flags) {
+    if (count < 1) return NULL;
+    pongEnv* e = calloc(1, sizeof(pongEnv));
+    if (!e) return NULL;
+    e->flags = flags;
+    e->nextSeed = seed;
+    e->steps = calloc(count, sizeof(uint32_t));
+    e->finished = calloc(count, sizeof(uint8_t));
+    if (!e->steps || !e->finished || !initBatch(&e->batch, count, seed)) {
+        freeEnv(e);
+        return NULL;
+    }
+    for (int i = 0; i < count; i++) restartLane(e, i);
+    return e;
+}
+
+void freeEnv(pongEnv* e) {
+    if (!e) return;
+    if (e->batch.capacity) freeBatch(&e->batch);
+    free(e->steps);
+    free(e->finished);
+    freeSceneRenderer(&e->renderer);
+    free(e);
+}
+
+int envCount(const pongEnv* e) {
+    return e->batch.count;
+}
+
+/**
+ * writes the observations of lanes first to end
+*/
+static void observe(const matchBatch* b, int first, int end, float* observations) {
+    const float paddleTravel = MAX_PADDLE_Y - MIN_PADDLE_Y;
+    for (int i = first; i < end; i++) {
+        float* o = observations + (long) i * ENV_OBSERVATION_SIZE;
+        o[0] = b->ballX[i] * (float) (1. / WINDOW_WIDTHF);
+        o[1] = b->ballY[i] * (float) (1. / WINDOW_HEIGHTF);
+        o[2] = b->ballVelocityX[i] * (float) (1. / MAX_BALL_SPEED);
+        o[3] = b->ballVelocityY[i] * (float) (1. / MAX_BALL_SPEED);
+        o[4] = (b->leftPaddleY[i] - MIN_PADDLE_Y) / paddleTravel;
+        o[5] = (b->rightPaddleY[i] - MIN_PADDLE_Y) / paddleTravel;
+        o[6] = b->leftScore[i] * (float) (1. / TARGET_SCORE);
+        o[7] = b->rightScore[i] * (float) (1. / TARGET_SCORE);
+    }
+}
+
+void resetEnv(pongEnv* e, float* observations) {
+    for (int i = 0; i < e->batch.count; i++) restartLane(e, i);
+    observe(&e->batch, 0, e->batch.count, observations);
+}
+
+void resetEnvMatch(pongEnv* e, int i, float* observations) {
+    restartLane(e, i);
+    observe(&e->batch, i, i + 1, observations);
+}
+
+static direction toDirection(int32_t action) {
+    return action >= UP && action <= STATIC ? (direction) action : STATIC;
+}
+
+void stepEnv(pongEnv* e, const int32_t* actions, float* observations, float* rewards, uint8_t* dones) {
+    matchBatch* b = &e->batch;
+    if (e->flags & ENV_COMPUTER_OPPONENT) {
+        batchRightComputerController(b);
+        for (int i = 0; i < b->count; i++) b->leftInput[i] = toDirection(actions[i]);
+    } else {
+        for (int i = 0; i < b->count; i++) {
+            b->leftInput[i] = toDirection(actions[2 * i]);
+            b->rightInput[i] = toDirection(actions[2 * i + 1]);
+        }
+    }
+    stepBatch(b);
+    for (int i = 0; i < b->count; i++) {
+        float reward = 0;
+        uint8_t done = 0;
+        if (e->finished[i]) {
+            done = e->finished[i];
+        } else {
+            switch (b->events[i]) {
+                case LEFT_POINT:
+                    reward = 1;
+                    serveLane(b, i);
+                    break;
+                case RIGHT_POINT:
+                    reward = -1;
+                    serveLane(b, i);
+                    break;
+                case LEFT_WIN:
+                    reward = 1;
+                    done = ENV_TERMINATED;
+                    break;
+                case RIGHT_WIN:
+                    reward = -1;
+                    done = ENV_TERMINATED;
+                    break;
+                case NO_EVENT:
+                    break;
+            }
+            if (!done && ++e->steps[i] >= ENV_MAX_EPISODE_STEPS) done = ENV_TRUNCATED;
+            if (done) {
+                if (e->flags & ENV_AUTO_RESET) restartLane(e, i);
+                else e->finished[i] = done;
+            }
+        }
+        rewards[i] = reward;
+        dones[i] = done;
+    }
+    observe(b, 0, b->count, observations);
+}
+
+bool renderEnv(pongEnv* e, int width, int height, uint8_t* pixels) {
+    sceneRenderer* r = &e->renderer;
+    if (!r->background || r->width != width || r->height != height) {
+        freeSceneRenderer(r);
+        if (!initSceneRenderer(r, width, height)) return false;
+    }
+    drawBatchFrames(r, &e->batch, pixels);
+    return true;
+}
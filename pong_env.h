@@ -0,0 +1,77 @@
+#ifndef PONG_ENV_H
+#define PONG_ENV_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * vectorized reinforcement learning environment, built as libpong_env.so
+ * a pongEnv steps count matches at once on the batch engine; the agent plays the left paddle
+ * actions are int32 directions (0 up, 1 down, 2 static, as in pong_core.h), anything else counts as static
+ * observations, rewards and done flags are written straight from the lanes into the caller's buffers
+ * an episode is one match, there is no delay between points: the next round is served in the step that scores
+ * every function is safe to call on different environments from different threads
+*/
+
+// exported from the shared library, everything else in it is hidden
+#define PONG_ENV_API __attribute__((visibility("default")))
+
+// floats per observation, in order: ball x, ball y (0 to 1 across the court), ball velocity x, y
+// (divided by MAX_BALL_SPEED), left paddle y, right paddle y (0 to 1 over their travel), left score,
+// right score (divided by TARGET_SCORE)
+#define ENV_OBSERVATION_SIZE (8)
+
+// episodes still running after this many steps are truncated
+#define ENV_MAX_EPISODE_STEPS (60 * 60 * 5)
+
+// createEnv flags
+// a finished episode starts over inside the step, which then returns the new episode's first observation
+#define ENV_AUTO_RESET (1)
+// the right paddle is played by rightComputerController, otherwise the caller gives both paddles' actions
+#define ENV_COMPUTER_OPPONENT (2)
+
+// done flags
+#define ENV_TERMINATED (1)
+#define ENV_TRUNCATED (2)
+
+typedef struct pongEnv pongEnv;
+
+/**
+ * an environment of count matches with their first episodes started, episode k (counting from 0 across all
+ * matches, in the order they start) is seeded with seed + k
+ * returns NULL if count is below 1 or allocation fails
+*/
+PONG_ENV_API pongEnv* createEnv(int count, uint64_t seed, int flags);
+
+PONG_ENV_API void freeEnv(pongEnv* e);
+
+PONG_ENV_API int envCount(const pongEnv* e);
+
+/**
+ * starts a new episode in every match and writes count observations
+*/
+PONG_ENV_API void resetEnv(pongEnv* e, float* observations);
+
+/**
+ * starts a new episode in match i only, writing its observation at observations + i * ENV_OBSERVATION_SIZE
+*/
+PONG_ENV_API void resetEnvMatch(pongEnv* e, int i, float* observations);
+
+/**
+ * advances every match by one tick
+ * actions holds count directions for the left paddles with ENV_COMPUTER_OPPONENT, otherwise count pairs
+ * (left, right); rewards get +1 for a point to the left and -1 for one to the right, dones the done flags
+ * without ENV_AUTO_RESET a finished match stays done, with its paddles still moving, until it is reset
+*/
+PONG_ENV_API void stepEnv(pongEnv* e, const int32_t* actions, float* observations, float* rewards, uint8_t* dones);
+
+/**
+ * draws every match as the game screen shows it, count grayscale frames of width by height bytes, row 0 at
+ * the top, frame i at pixels + i * width * height
+ * pixel observations for agents that learn from the screen, see pong_raster.h; the renderer is kept between
+ * calls until the size changes
+ * returns false if either size is below 1 or allocation fails
+*/
+PONG_ENV_API bool renderEnv(pongEnv* e, int width, int height, uint8_t* pixels);
+
+#endif
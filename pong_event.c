@@ -0,0 +1,154 @@
+#include "pong_event.h"
+
+#include <math.h>
+
+// distance a paddle moves in one tick, as in stepMatch
+#define PADDLE_STEP (WINDOW_HEIGHTF / 512. * PADDLE_SPEED)
+
+// horizon for something that will not change before the next event
+#define NO_LIMIT (~0ul)
+
+// slack for float rounding when bounding an aiming shot's target
+#define AIMING_MARGIN (1.)
+
+// steepest change of targetAimingShift per unit of paddle height
+#define AIM_SLOPE (PADDLE_HEIGHT / 2. / MAX_BOUNCE_ANGLE_RAD / (RIGHT_PADDLE_X - LEFT_PADDLE_X))
+
+/**
+ * true if the side's target height does not depend on where the paddles are
+*/
+static bool targetFixed(const matchState* m, bool left) {
+    if (!m->inPlay || (left ? m->ballVelocityX > 0 : m->ballVelocityX < 0)) return true;
+    computerShot shot = left ? m->leftComputerShot : m->rightComputerShot;
+    return shot == FLAT || shot == ERRATIC_UP || shot == ERRATIC_DOWN;
+}
+
+/**
+ * true if the paddle will actually change height when moved in direction d
+*/
+static bool paddleMoves(float paddleY, direction d) {
+    return (d == UP && paddleY < MAX_PADDLE_Y) || (d == DOWN && paddleY > MIN_PADDLE_Y);
+}
+
+/**
+ * number of ticks, starting with this one, a paddle moving in direction d stays short of bound
+ * at least 1, the current tick is already decided
+*/
+static unsigned long ticksShortOf(float paddleY, direction d, double bound) {
+    // a paddle pinned against the wall before reaching the bound never gets there
+    if (d == UP ? bound > MAX_PADDLE_Y : bound < MIN_PADDLE_Y) return NO_LIMIT;
+    double gap = d == UP ? bound - paddleY : paddleY - bound;
+    if (gap <= 0) return 1;
+    unsigned long n = (unsigned long) ceil(gap / PADDLE_STEP);
+    // paddle heights are exact multiples of 1/32, so correct any rounding of the division exactly
+    if (d == UP) {
+        while (n > 1 && paddleY + (n - 1) * PADDLE_STEP >= bound) n--;
+        while (paddleY + n * PADDLE_STEP < bound) n++;
+    } else {
+        while (n > 1 && paddleY - (n - 1) * PADDLE_STEP <= bound) n--;
+        while (paddleY - n * PADDLE_STEP > bound) n++;
+    }
+    return n;
+}
+
+/**
+ * number of ticks, starting with this one, the side's controller is certain to keep returning d
+ * 1 when only re-running the controller can tell
+*/
+static unsigned long decisionHorizon(matchState* m, bool left, direction d, bool otherMoves) {
+    float paddleY = left ? m->leftPaddleY : m->rightPaddleY;
+    bool fixed = targetFixed(m, left);
+    if (!paddleMoves(paddleY, d)) {
+        if (fixed) return NO_LIMIT;
+        // TOP and BOTTOM only look at the side's own paddle, the others also aim off the opponent
+        computerShot shot = left ? m->leftComputerShot : m->rightComputerShot;
+        if (shot == TOP || shot == BOTTOM || !otherMoves) return NO_LIMIT;
+        return 1;
+    }
+
+    double tolerance = aimingTolerance(left ? &m->leftConfig : &m->rightConfig);
+    if (fixed) {
+        // the paddle keeps going until it is inside the aiming tolerance
+        float targetY = left ? leftComputerTarget(m) : rightComputerTarget(m);
+        return ticksShortOf(paddleY, d, d == UP ? targetY - tolerance : targetY + tolerance);
+    }
+
+    // aiming shots move the target as the paddles move, but never by more than
+    // |PADDLE_HEIGHT / 2 - tolerance| from the unshifted target, so the paddle is
+    // certain to keep going until it gets that close
+    float baseY = (m->ballVelocityY == 0 ? m->ballY : left ? m->leftIntercept : m->rightIntercept) - PADDLE_HEIGHT / 2;
+    double reach = fabs(PADDLE_HEIGHT / 2 - tolerance) + tolerance + AIMING_MARGIN;
+    unsigned long n = ticksShortOf(paddleY, d, d == UP ? baseY - reach : baseY + reach);
+
+    // the shift also changes by at most AIM_SLOPE per unit either paddle moves, so the
+    // gap to the current target closes by at most PADDLE_STEP * (1 + 2 * AIM_SLOPE) per tick
+    // AGGRESSIVE flips sides when the opponent crosses the middle, so only the bound above holds for it
+    computerShot shot = left ? m->leftComputerShot : m->rightComputerShot;
+    if (shot != AGGRESSIVE || !otherMoves) {
+        float targetY = left ? leftComputerTarget(m) : rightComputerTarget(m);
+        double gap = (d == UP ? targetY - tolerance - paddleY : paddleY - targetY - tolerance) - AIMING_MARGIN;
+        if (gap > 0) n = max(n, (unsigned long) ceil(gap / (PADDLE_STEP * (1 + 2 * AIM_SLOPE))));
+    }
+    return n;
+}
+
+/**
+ * number of upcoming ticks in which no collision check in stepMatch can fire
+ * kept one tick short of the estimate so float rounding can never skip an event
+*/
+static unsigned long ballHorizon(const matchState* m) {
+    if (!m->inPlay) return NO_LIMIT;
+    double t = INFINITY;
+    if (m->ballVelocityY > 0) {
+        t = (WINDOW_HEIGHTF - BALL_DIM - m->ballY) / m->ballVelocityY;
+    } else if (m->ballVelocityY < 0) {
+        t = m->ballY / -m->ballVelocityY;
+    }
+    // past a paddle plane the ball is in the collider or about to score, so go tick by tick
+    if (m->ballVelocityX < 0) {
+        t = min(t, m->ballX < LEFT_PADDLE_X ? 0 : (m->ballX - LEFT_PADDLE_X) / -m->ballVelocityX);
+    } else if (m->ballVelocityX > 0) {
+        t = min(t, m->ballX + BALL_DIM > RIGHT_PADDLE_X ? 0 : (RIGHT_PADDLE_X - BALL_DIM - m->ballX) / m->ballVelocityX);
+    }
+    if (t == INFINITY) return NO_LIMIT;
+    return t < 2 ? 0 : (unsigned long) t - 1;
+}
+
+unsigned long advanceComputerMatch(matchState* m, unsigned long maxTicks, matchEvent* event) {
+    unsigned long ticks = 0;
+    *event = NO_EVENT;
+    while (ticks < maxTicks) {
+        direction left = leftComputerController(m);
+        direction right = rightComputerController(m);
+        unsigned long k = min(ballHorizon(m), maxTicks - ticks);
+        if (k > 1) k = min(k, decisionHorizon(m, true, left, paddleMoves(m->rightPaddleY, right)));
+        if (k > 1) k = min(k, decisionHorizon(m, false, right, paddleMoves(m->leftPaddleY, left)));
+
+        if (k <= 1) {
+            ticks++;
+            *event = stepMatch(m, left, right);
+            if (*event != NO_EVENT) return ticks;
+            continue;
+        }
+
+#ifdef PONG_FIXED_POINT
+        // on the grid every addition stepMatch makes is exact, so k of them are one multiply
+        m->ballX += k * m->ballVelocityX;
+        m->ballY += k * m->ballVelocityY;
+#else
+        // the ball is stepped with the same float additions as stepMatch so positions stay bit for bit identical
+        // (taking the steps a binade at a time in closed form came out slower than these two add chains)
+        for (unsigned long i = 0; i < k; i++) {
+            m->ballX += m->ballVelocityX;
+            m->ballY += m->ballVelocityY;
+        }
+#endif
+        // paddle heights stay exact, so the whole move can be taken at once
+        if (left == DOWN) m->leftPaddleY = max(m->leftPaddleY - k * PADDLE_STEP, MIN_PADDLE_Y);
+        else if (left == UP) m->leftPaddleY = min(m->leftPaddleY + k * PADDLE_STEP, MAX_PADDLE_Y);
+        if (right == DOWN) m->rightPaddleY = max(m->rightPaddleY - k * PADDLE_STEP, MIN_PADDLE_Y);
+        else if (right == UP) m->rightPaddleY = min(m->rightPaddleY + k * PADDLE_STEP, MAX_PADDLE_Y);
+        ticks += k;
+    }
+    return ticks;
+}
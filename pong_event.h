@@ -0,0 +1,16 @@
+#ifndef PONG_EVENT_H
+#define PONG_EVENT_H
+
+#include "pong_core.h"
+
+/**
+ * advances a computer vs computer match from event to event instead of tick by tick
+ * stretches where the ball flies straight and both computers' decisions are known in advance
+ * are crossed in one jump, the ticks where a bounce, paddle hit or score can happen run through stepMatch
+ * produces the same match, tick for tick, as calling the computer controllers and stepMatch every tick
+ * stops after maxTicks or on the first tick that returns an event, which is stored in event
+ * returns the number of ticks advanced
+*/
+unsigned long advanceComputerMatch(matchState* m, unsigned long maxTicks, matchEvent* event);
+
+#endif
@@ -0,0 +1,114 @@
+#include "pong_font.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// block font layout, glyphs are indexed by ascii code
+#define GLYPH_COUNT (128)
+#define GLYPH_COLUMNS (5)
+#define GLYPH_ROWS (7)
+#define GLYPH_RECT_CAPACITY (1024)
+
+// rows of each glyph, top row first, the leftmost column is bit 4
+static const unsigned char glyphBitmaps[GLYPH_COUNT][GLYPH_ROWS] = {
+    ['A'] = {0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11},
+    ['B'] = {0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e},
+    ['C'] = {0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e},
+    ['D'] = {0x1e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1e},
+    ['E'] = {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f},
+    ['F'] = {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10},
+    ['G'] = {0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f},
+    ['H'] = {0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11},
+    ['I'] = {0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e},
+    ['J'] = {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c},
+    ['K'] = {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11},
+    ['L'] = {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f},
+    ['M'] = {0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11},
+    ['N'] = {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11},
+    ['O'] = {0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e},
+    ['P'] = {0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10},
+    ['Q'] = {0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d},
+    ['R'] = {0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11},
+    ['S'] = {0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e},
+    ['T'] = {0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04},
+    ['U'] = {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e},
+    ['V'] = {0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04},
+    ['W'] = {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a},
+    ['X'] = {0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11},
+    ['Y'] = {0x11, 0x11, 0x0a, 0x04, 0x04, 0x04, 0x04},
+    ['Z'] = {0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f},
+    ['0'] = {0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e},
+    ['1'] = {0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e},
+    ['2'] = {0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f},
+    ['3'] = {0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e},
+    ['4'] = {0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02},
+    ['5'] = {0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e},
+    ['6'] = {0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e},
+    ['7'] = {0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08},
+    ['8'] = {0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e},
+    ['9'] = {0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c},
+    ['-'] = {0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00},
+    ['.'] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c},
+    [':'] = {0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00},
+    ['/'] = {0x01, 0x01, 0x02, 0x04, 0x08, 0x10, 0x10},
+    ['!'] = {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04},
+    ['?'] = {0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04},
+    ['_'] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f},
+};
+
+// every glyph merged into as few blocks as possible, built once from glyphBitmaps
+static glyphRect glyphRects[GLYPH_RECT_CAPACITY];
+static unsigned short glyphStart[GLYPH_COUNT], glyphLength[GLYPH_COUNT];
+
+/**
+ * fills the glyph table, once when the program or library loads so drawing never has to check
+ * each horizontal run of set bits becomes a block, stretched down over the rows below that repeat it
+*/
+__attribute__((constructor)) static void buildGlyphs() {
+    int n = 0;
+    for (int c = 0; c < GLYPH_COUNT; c++) {
+        glyphStart[c] = n;
+        unsigned char covered[GLYPH_ROWS] = {0};
+        for (int row = 0; row < GLYPH_ROWS; row++) {
+            unsigned char bits = glyphBitmaps[c][row] & ~covered[row];
+            int col = 0;
+            while (col < GLYPH_COLUMNS) {
+                if (!(bits >> (GLYPH_COLUMNS - 1 - col) & 1)) {
+                    col++;
+                    continue;
+                }
+                int end = col;
+                while (end < GLYPH_COLUMNS && bits >> (GLYPH_COLUMNS - 1 - end) & 1) end++;
+                unsigned char run = ((1 << (end - col)) - 1) << (GLYPH_COLUMNS - end);
+                int last = row;
+                while (last + 1 < GLYPH_ROWS && (glyphBitmaps[c][last + 1] & ~covered[last + 1] & run) == run) {
+                    covered[++last] |= run;
+                }
+                if (n == GLYPH_RECT_CAPACITY) {
+                    fprintf(stderr, "glyph table full\n");
+                    exit(1);
+                }
+                glyphRects[n++] = (glyphRect) {
+                    (float) col / GLYPH_COLUMNS, 1 - (float) (last + 1) / GLYPH_ROWS,
+                    (float) end / GLYPH_COLUMNS, 1 - (float) row / GLYPH_ROWS
+                };
+                col = end;
+            }
+        }
+        glyphLength[c] = n - glyphStart[c];
+    }
+}
+
+int glyphBlocks(int c, const glyphRect** blocks) {
+    c = toupper((unsigned char) c);
+    if (c >= GLYPH_COUNT) return 0;
+    *blocks = &glyphRects[glyphStart[c]];
+    return glyphLength[c];
+}
+
+float textWidth(const char* text, float width, float spacing) {
+    size_t l = strlen(text);
+    return l == 0 ? 0 : l * width + (l - 1) * spacing;
+}
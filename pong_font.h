@@ -0,0 +1,27 @@
+#ifndef PONG_FONT_H
+#define PONG_FONT_H
+
+/*
+ * the block font shared by the GL renderer and the software rasterizer
+ * glyphs are 5 by 7 bitmaps merged into as few solid blocks as possible
+*/
+
+/**
+ * one solid block of a glyph, as fractions of the character cell with y up
+*/
+typedef struct {
+    float x1, y1, x2, y2;
+} glyphRect;
+
+/**
+ * the blocks of a character's glyph, letters are drawn in capitals whatever their case
+ * returns the block count, 0 for characters without a glyph
+*/
+int glyphBlocks(int c, const glyphRect** blocks);
+
+/**
+ * width a line of text takes up, every character gets a cell of the given width with spacing between cells
+*/
+float textWidth(const char* text, float width, float spacing);
+
+#endif
@@ -0,0 +1,459 @@
+#include <errno.h>
+#include <math.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "pong_core.h"
+#include "pong_stats.h"
+#include "pong_stream.h"
+#include "pong_wire.h"
+
+#define DEFAULT_MATCHES (1000)
+#define DEFAULT_CONNECTIONS (4)
+#define DEFAULT_SECONDS (10.)
+// how long a connection waits for all of its seats
+#define JOIN_TIMEOUT (2.)
+// state arrival gaps kept for the percentiles of each report
+#define GAP_WINDOW (1 << 20)
+#define LOCAL_MATCH(id) ((id) & ((1u << WIRE_WORKER_SHIFT) - 1))
+
+/**
+ * seconds on the monotonic clock
+*/
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * a match as a client sees it, rebuilt from the server's states for the computer controllers to read
+*/
+typedef struct {
+    uint32_t id;
+    matchState view;
+    // sides this connection plays, bit 0 is left
+    int sides;
+    uint32_t tick;
+    double lastArrival;
+} seenMatch;
+
+/**
+ * one UDP socket standing in for a crowd of players behind the same address
+*/
+typedef struct {
+    int socket;
+    // indexed by the match id without its worker, all of a connection's matches are on one worker
+    seenMatch* matches;
+    uint32_t matchCapacity;
+    int seats;
+} connection;
+
+/**
+ * a spectator's copy of one match, rebuilt from the stream
+*/
+typedef struct {
+    uint32_t id;
+    streamReceiver receiver;
+    // the player's view of the same match, to check the stream against
+    const seenMatch* played;
+    // frames decoded over the whole run
+    unsigned long frames;
+} watchedMatch;
+
+/**
+ * one spectator with its own socket
+*/
+typedef struct {
+    int socket;
+    watchedMatch* matches;
+    int count;
+} viewer;
+
+// totals since the last report
+unsigned long statesReceived, inputsSent, matchesOver, staleStates;
+unsigned long framesReceived, frameBytes, keyframes, undecodable, framesChecked;
+// largest difference between a position streamed to a spectator and the player's state of the same tick, pixels
+double worstError;
+double gaps[GAP_WINDOW], sortedGaps[GAP_WINDOW];
+int gapCount;
+
+/**
+ * the entry for a match id, growing the table if needed
+*/
+seenMatch* seen(connection* c, uint32_t id) {
+    uint32_t match = LOCAL_MATCH(id);
+    if (match >= c->matchCapacity) {
+        uint32_t capacity = max(match + 1, c->matchCapacity * 2);
+        seenMatch* grown = realloc(c->matches, capacity * sizeof(seenMatch));
+        if (!grown) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        memset(grown + c->matchCapacity, 0, (capacity - c->matchCapacity) * sizeof(seenMatch));
+        c->matches = grown;
+        c->matchCapacity = capacity;
+    }
+    c->matches[match].id = id;
+    return &c->matches[match];
+}
+
+/**
+ * opens a socket to the server and asks for seats, returns false if none came back in time
+*/
+bool joinServer(connection* c, const struct addrinfo* server, int seats) {
+    c->socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (c->socket < 0 || connect(c->socket, server->ai_addr, server->ai_addrlen) != 0) {
+        perror("socket");
+        return false;
+    }
+    int buffer = 4 << 20;
+    setsockopt(c->socket, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    unsigned char packet[WIRE_MAX_PACKET];
+    send(c->socket, packet, putWireHeader(packet, JOIN_MESSAGE, seats) - packet, 0);
+
+    double deadline = now() + JOIN_TIMEOUT;
+    while (c->seats < seats && now() < deadline) {
+        int size = recv(c->socket, packet, sizeof(packet), MSG_DONTWAIT);
+        if (size < 0) {
+            usleep(1000);
+            continue;
+        }
+        wireMessage type;
+        int count;
+        if (!getWireHeader(packet, size, &type, &count) || type != SEATS_MESSAGE) continue;
+        const unsigned char* p = packet + WIRE_HEADER_SIZE;
+        for (int i = 0; i < count; i++) {
+            wireSeat s;
+            p = getWireSeat(p, &s);
+            seenMatch* m = seen(c, s.match);
+            if (m->sides == 0) {
+                initMatch(&m->view, 0);
+                m->tick = 0;
+                m->lastArrival = 0;
+            }
+            m->sides |= 1 << s.side;
+            c->seats++;
+        }
+    }
+    return c->seats > 0;
+}
+
+/**
+ * folds a server state into the local view of its match
+*/
+void applyState(seenMatch* m, const wireState* s) {
+    matchState* v = &m->view;
+    // the controllers' cached intercepts hold until the ball changes course
+    if (s->ballVelocityX != v->ballVelocityX || s->ballVelocityY != v->ballVelocityY || !(s->flags & WIRE_IN_PLAY)) {
+        v->leftPredicted = v->rightPredicted = false;
+    }
+    v->ballX = s->ballX;
+    v->ballY = s->ballY;
+    v->ballVelocityX = s->ballVelocityX;
+    v->ballVelocityY = s->ballVelocityY;
+    v->ballSpeed = hypotf(s->ballVelocityX, s->ballVelocityY);
+    v->leftPaddleY = s->leftPaddleY;
+    v->rightPaddleY = s->rightPaddleY;
+    v->leftScore = s->leftScore;
+    v->rightScore = s->rightScore;
+    v->inPlay = s->flags & WIRE_IN_PLAY;
+}
+
+/**
+ * takes in every state waiting on a connection
+*/
+void receiveStates(connection* c) {
+    unsigned char packet[WIRE_MAX_PACKET];
+    int size;
+    while ((size = recv(c->socket, packet, sizeof(packet), MSG_DONTWAIT)) >= 0) {
+        wireMessage type;
+        int count;
+        if (!getWireHeader(packet, size, &type, &count) || type != STATES_MESSAGE) continue;
+        double t = now();
+        const unsigned char* p = packet + WIRE_HEADER_SIZE;
+        for (int i = 0; i < count; i++) {
+            wireState s;
+            p = getWireState(p, &s);
+            uint32_t match = LOCAL_MATCH(s.match);
+            if (match >= c->matchCapacity || c->matches[match].sides == 0) continue;
+            seenMatch* m = &c->matches[match];
+            statesReceived++;
+            if (s.tick <= m->tick) {
+                staleStates++;
+                continue;
+            }
+            if (m->lastArrival > 0 && gapCount < GAP_WINDOW) gaps[gapCount++] = t - m->lastArrival;
+            m->lastArrival = t;
+            m->tick = s.tick;
+            applyState(m, &s);
+            if (s.flags & WIRE_OVER) {
+                m->sides = 0;
+                c->seats -= 2;
+                matchesOver++;
+            }
+        }
+    }
+}
+
+/**
+ * runs the computer controllers for every seat and sends their directions
+*/
+void sendInputs(connection* c) {
+    unsigned char packet[WIRE_MAX_PACKET];
+    unsigned char* p = putWireHeader(packet, INPUTS_MESSAGE, 0);
+    int count = 0;
+    for (uint32_t i = 0; i < c->matchCapacity; i++) {
+        seenMatch* m = &c->matches[i];
+        for (int side = 0; side < 2; side++) {
+            if (!(m->sides & 1 << side)) continue;
+            direction d = side == 0 ? leftComputerController(&m->view) : rightComputerController(&m->view);
+            p = putWireInput(p, (wireInput) {{m->id, side}, d});
+            if (++count == WIRE_ENTRIES(WIRE_INPUT_SIZE)) {
+                setWireCount(packet, count);
+                send(c->socket, packet, p - packet, MSG_DONTWAIT);
+                p = putWireHeader(packet, INPUTS_MESSAGE, 0);
+                count = 0;
+            }
+            inputsSent++;
+        }
+    }
+    if (count > 0) {
+        setWireCount(packet, count);
+        send(c->socket, packet, p - packet, MSG_DONTWAIT);
+    }
+}
+
+/**
+ * opens a spectator's socket and asks to watch its matches
+*/
+bool startViewer(viewer* v, const struct addrinfo* server) {
+    v->socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (v->socket < 0 || connect(v->socket, server->ai_addr, server->ai_addrlen) != 0) {
+        perror("socket");
+        return false;
+    }
+    unsigned char packet[WIRE_MAX_PACKET];
+    unsigned char* p = putWireHeader(packet, WATCH_MESSAGE, 0);
+    for (int i = 0; i < v->count; i++) {
+        initStreamReceiver(&v->matches[i].receiver);
+        p = putWireMatch(p, v->matches[i].id);
+        if ((i + 1) % WIRE_ENTRIES(WIRE_WATCH_SIZE) == 0 || i == v->count - 1) {
+            setWireCount(packet, (i % WIRE_ENTRIES(WIRE_WATCH_SIZE)) + 1);
+            send(v->socket, packet, p - packet, 0);
+            p = putWireHeader(packet, WATCH_MESSAGE, 0);
+        }
+    }
+    return true;
+}
+
+/**
+ * decodes every frame waiting for a spectator, checking them against the players' states and acknowledging keyframes
+*/
+void receiveFrames(viewer* v) {
+    unsigned char packet[WIRE_MAX_PACKET], acks[WIRE_MAX_PACKET];
+    unsigned char* a = putWireHeader(acks, ACKS_MESSAGE, 0);
+    int ackCount = 0;
+    int size;
+    while ((size = recv(v->socket, packet, sizeof(packet), MSG_DONTWAIT)) >= 0) {
+        wireMessage type;
+        int count;
+        if (!getWireHeader(packet, size, &type, &count) || type != FRAMES_MESSAGE) continue;
+        const unsigned char* p = packet + WIRE_HEADER_SIZE;
+        for (int i = 0; i < count && p; i++) {
+            uint32_t id;
+            const unsigned char* data;
+            int length;
+            if (!(p = getWireFrame(p, packet + size, &id, &data, &length))) break;
+            watchedMatch* w = NULL;
+            for (int j = 0; j < v->count && !w; j++) {
+                if (v->matches[j].id == id) w = &v->matches[j];
+            }
+            if (!w) continue;
+            streamFrame f;
+            int key;
+            if (!decodeStreamFrame(&w->receiver, data, length, &f, &key)) {
+                undecodable++;
+                continue;
+            }
+            framesReceived++;
+            frameBytes += length;
+            w->frames++;
+            if (key >= 0) {
+                keyframes++;
+                a = putWireAck(a, (wireAck) {id, key});
+                if (++ackCount == WIRE_ENTRIES(WIRE_ACK_SIZE)) {
+                    setWireCount(acks, ackCount);
+                    send(v->socket, acks, a - acks, MSG_DONTWAIT);
+                    a = putWireHeader(acks, ACKS_MESSAGE, 0);
+                    ackCount = 0;
+                }
+            }
+            if (w->played && w->played->tick == f.tick) {
+                matchState streamed;
+                restoreFrame(&streamed, &f);
+                const matchState* truth = &w->played->view;
+                double error = fmax(fmax(fabs(streamed.ballX - truth->ballX), fabs(streamed.ballY - truth->ballY)),
+                        fmax(fabs(streamed.leftPaddleY - truth->leftPaddleY), fabs(streamed.rightPaddleY - truth->rightPaddleY)));
+                worstError = fmax(worstError, error);
+                framesChecked++;
+            }
+        }
+    }
+    if (ackCount > 0) {
+        setWireCount(acks, ackCount);
+        send(v->socket, acks, a - acks, MSG_DONTWAIT);
+    }
+}
+
+/**
+ * load generator for pong-server: computer controllers play both sides of every match through a few sockets
+ * usage: pong-load [-a host:port] [-m matches] [-c connections] [-w viewers [-v matches each]] [-t seconds]
+ * matches are spread evenly across the connections, each asks the server for both seats of its matches
+ * reports the states received each second and the gaps between a match's consecutive states, which sit at
+ * 1 / FRAME_RATE when the server keeps time; matches that finish aren't replaced
+ * -w adds spectators, each on its own socket watching -v of the matches (1 by default), taken in turn; their
+ * frames are decoded, checked against the players' states and their sizes reported; the run fails if any
+ * watched match got no frames at all
+*/
+int main(int argc, char** argv) {
+    const char* address = "127.0.0.1";
+    char portText[8];
+    snprintf(portText, sizeof(portText), "%d", WIRE_PORT);
+    const char* port = portText;
+    int matchCount = DEFAULT_MATCHES, connectionCount = DEFAULT_CONNECTIONS, viewerCount = 0, watchedEach = 1;
+    double seconds = DEFAULT_SECONDS;
+    char* separator;
+    int opt;
+    while ((opt = getopt(argc, argv, "a:m:c:w:v:t:")) != -1) {
+        switch (opt) {
+            case 'a':
+                address = optarg;
+                if ((separator = strrchr(optarg, ':'))) {
+                    *separator = '\0';
+                    port = separator + 1;
+                }
+                break;
+            case 'm':
+                matchCount = atoi(optarg);
+                break;
+            case 'c':
+                connectionCount = atoi(optarg);
+                break;
+            case 'w':
+                viewerCount = atoi(optarg);
+                break;
+            case 'v':
+                watchedEach = atoi(optarg);
+                break;
+            case 't':
+                seconds = atof(optarg);
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (argc != optind || matchCount < 1 || connectionCount < 1 || connectionCount > matchCount || viewerCount < 0
+            || watchedEach < 1) {
+        fprintf(stderr, "usage: %s [-a host:port] [-m matches] [-c connections] [-w viewers [-v matches each]] [-t seconds]\n", argv[0]);
+        return 1;
+    }
+    struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_DGRAM}, *server;
+    if (getaddrinfo(address, port, &hints, &server) != 0) {
+        fprintf(stderr, "can't resolve %s:%s\n", address, port);
+        return 1;
+    }
+
+    connection* connections = calloc(connectionCount, sizeof(connection));
+    int joined = 0;
+    for (int i = 0; i < connectionCount; i++) {
+        int matches = matchCount / connectionCount + (i < matchCount % connectionCount);
+        if (!joinServer(&connections[i], server, 2 * matches)) {
+            fprintf(stderr, "connection %d got no seats\n", i);
+            return 1;
+        }
+        joined += connections[i].seats / 2;
+    }
+
+    // spectators take the matches being played in turn
+    const seenMatch** played = malloc(joined * sizeof(seenMatch*));
+    int playedCount = 0;
+    for (int i = 0; i < connectionCount; i++) {
+        for (uint32_t j = 0; j < connections[i].matchCapacity; j++) {
+            if (connections[i].matches[j].sides && playedCount < joined) played[playedCount++] = &connections[i].matches[j];
+        }
+    }
+    viewer* viewers = calloc(viewerCount, sizeof(viewer));
+    for (int i = 0; i < viewerCount; i++) {
+        viewer* v = &viewers[i];
+        v->count = min(watchedEach, playedCount);
+        v->matches = calloc(v->count, sizeof(watchedMatch));
+        for (int j = 0; j < v->count; j++) {
+            const seenMatch* m = played[((long) i * watchedEach + j) % playedCount];
+            v->matches[j] = (watchedMatch) {.id = m->id, .played = m};
+        }
+        if (!startViewer(v, server)) return 1;
+    }
+    freeaddrinfo(server);
+    printf("playing %d matches over %d connections for %.0f s", joined, connectionCount, seconds);
+    if (viewerCount > 0) printf(", %d spectators watching %d each", viewerCount, min(watchedEach, playedCount));
+    printf("\n");
+
+    double start = now(), next = start, lastReport = start;
+    while (now() - start < seconds) {
+        for (int i = 0; i < connectionCount; i++) receiveStates(&connections[i]);
+        for (int i = 0; i < viewerCount; i++) receiveFrames(&viewers[i]);
+        for (int i = 0; i < connectionCount; i++) sendInputs(&connections[i]);
+
+        double t = now();
+        if (t - lastReport >= 1) {
+            phaseSummary g = summarizeSamples(gaps, gapCount, sortedGaps);
+            int seats = 0;
+            for (int i = 0; i < connectionCount; i++) seats += connections[i].seats;
+            printf("%4.0f s: %d matches, %.0f states/s, %.0f inputs/s, state gap p50 %.2f ms, p99 %.2f ms, max %.2f ms; "
+                    "%lu stale, %lu over\n",
+                    t - start, seats / 2, statesReceived / (t - lastReport), inputsSent / (t - lastReport),
+                    g.p50 * 1e3, g.p99 * 1e3, g.max * 1e3, staleStates, matchesOver);
+            if (viewerCount > 0) {
+                printf("      %.0f frames/s, %.1f bytes each, %.1f%% keyframes, %lu undecodable, "
+                        "largest error %.3f px over %lu frames checked\n",
+                        framesReceived / (t - lastReport), framesReceived ? (double) frameBytes / framesReceived : 0.,
+                        framesReceived ? 100. * keyframes / framesReceived : 0., undecodable, worstError, framesChecked);
+            }
+            fflush(stdout);
+            statesReceived = inputsSent = staleStates = 0;
+            framesReceived = frameBytes = keyframes = undecodable = framesChecked = 0;
+            worstError = 0;
+            gapCount = 0;
+            lastReport = t;
+        }
+
+        next += 1. / FRAME_RATE;
+        if (next > t) {
+            struct timespec deadline = {(time_t) next, (long) ((next - (time_t) next) * 1e9)};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR);
+        } else {
+            next = t;
+        }
+    }
+
+    int watched = 0, unseen = 0;
+    for (int i = 0; i < viewerCount; i++) {
+        for (int j = 0; j < viewers[i].count; j++) {
+            watched++;
+            if (viewers[i].matches[j].frames == 0) unseen++;
+        }
+    }
+    if (unseen > 0) {
+        fprintf(stderr, "%d of %d watched matches got no frames\n", unseen, watched);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pong_core.h"
+#include "pong_net.h"
+
+#define DEFAULT_SECONDS (10.)
+// share of wall clock ticks a peer has to play for the run to count as holding the tick rate
+#define MIN_TICK_SHARE (.99)
+
+/**
+ * seconds on the monotonic clock
+*/
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * one simulated network condition, both directions get the same
+*/
+typedef struct {
+    double rtt, jitter, loss;
+} scenario;
+
+// conditions run when none is given on the command line
+const scenario defaultScenarios[] = {
+    {.050, .005, .02},
+    {.100, .010, .05},
+    {.100, .020, .10}
+};
+
+/**
+ * one side of the match, played by a computer controller through its own netplay session
+*/
+typedef struct {
+    netSession session;
+    bool host;
+    netLink link;
+    unsigned long wallTicks, played;
+    double elapsed, slowestTick;
+    bool connected;
+} peer;
+
+// settings shared by both peers
+uint64_t seed;
+bool swept = false;
+int inputDelay = NET_DEFAULT_INPUT_DELAY;
+double seconds = DEFAULT_SECONDS;
+// port the host ended up on, 0 until it is listening
+atomic_ushort hostPort;
+
+void announcePort(netSession* n) {
+    atomic_store(&hostPort, netPort(n));
+}
+
+/**
+ * connects, then plays at FRAME_RATE on absolute deadlines for the configured time
+*/
+void* playPeer(void* arg) {
+    peer* p = arg;
+    if (p->host) {
+        p->connected = netHost(&p->session, 0, seed, swept, inputDelay, p->link, announcePort);
+    } else {
+        unsigned short port;
+        while ((port = atomic_load(&hostPort)) == 0) usleep(1000);
+        p->connected = netConnect(&p->session, "127.0.0.1", port, p->link);
+    }
+    if (!p->connected) return NULL;
+
+    double start = now(), next = start;
+    unsigned long ticks = seconds * FRAME_RATE;
+    for (p->wallTicks = 0; p->wallTicks < ticks; p->wallTicks++) {
+        // the computer decides on a copy so its prediction cache stays out of the shared simulation
+        matchState view = p->session.state.match;
+        direction local = p->host ? leftComputerController(&view) : rightComputerController(&view);
+        double tickStart = now();
+        p->played += netTick(&p->session, local);
+        p->slowestTick = max(p->slowestTick, now() - tickStart);
+
+        next += 1. / FRAME_RATE;
+        double t = now();
+        if (next > t) {
+            struct timespec deadline = {(time_t) next, (long) ((next - (time_t) next) * 1e9)};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) != 0);
+        }
+    }
+    p->elapsed = now() - start;
+    return NULL;
+}
+
+/**
+ * prints one peer's counters, returns true if it held the tick rate without desyncing
+*/
+bool report(const peer* p) {
+    const netStats* s = &p->session.stats;
+    double share = (double) p->played / p->wallTicks;
+    printf("  %-6s %6.2f Hz, %lu of %lu ticks played (%lu stalled, %lu sync waits), slowest tick %.2f ms\n",
+            p->host ? "host" : "client", p->played / p->elapsed, p->played, p->wallTicks, s->stalls, s->syncWaits, p->slowestTick * 1e3);
+    printf("         %lu rollbacks, %.1f ticks on average, deepest %d; packets %lu sent, %lu dropped, %lu received\n",
+            s->rollbacks, s->rollbacks ? (double) s->resimulated / s->rollbacks : 0., s->deepestRollback,
+            s->packetsSent, s->packetsDropped, s->packetsReceived);
+    if (s->desynced) printf("         desync at tick %lu\n", s->desyncTick);
+    else printf("         %lu state hashes matched, score %d-%d\n", s->hashesChecked,
+            p->session.state.match.leftScore, p->session.state.match.rightScore);
+    return share >= MIN_TICK_SHARE && !s->desynced && s->hashesChecked > 0;
+}
+
+/**
+ * plays both peers over loopback UDP with the scenario's impairment, returns true if both passed
+*/
+bool runScenario(scenario c) {
+    printf("rtt %.0f ms, jitter %.0f ms, loss %.0f%%, input delay %d\n", c.rtt * 1e3, c.jitter * 1e3, c.loss * 100, inputDelay);
+    netLink link = {c.rtt / 2, c.jitter, c.loss};
+    static peer peers[2];
+    pthread_t threads[2];
+    atomic_store(&hostPort, 0);
+    for (int i = 0; i < 2; i++) {
+        peers[i] = (peer) {.host = i == 0, .link = link};
+        if (pthread_create(&threads[i], NULL, playPeer, &peers[i]) != 0) {
+            fprintf(stderr, "failed to start peer thread\n");
+            exit(1);
+        }
+    }
+    for (int i = 0; i < 2; i++) pthread_join(threads[i], NULL);
+    if (!peers[0].connected || !peers[1].connected) {
+        printf("  peers failed to connect\n");
+        return false;
+    }
+    bool passed = true;
+    for (int i = 0; i < 2; i++) {
+        passed &= report(&peers[i]);
+        closeNet(&peers[i].session);
+    }
+    printf("  %s\n", passed ? "ok" : "FAILED");
+    return passed;
+}
+
+/**
+ * loopback harness for netplay: two computer players in one process, each with its own session and UDP socket,
+ * play in real time over a simulated link and are checked for holding the tick rate and staying in sync
+ * usage: pong-loopback [-t seconds] [-d input delay] [-c] [-r rtt ms -l loss percent [-j jitter ms]] [seed]
+ * without -r the default scenarios run: 50 ms with 2% loss, then 100 ms with 5% and 10% loss
+ * exits non zero if any peer plays under 99% of its ticks or the peers' state hashes ever differ
+*/
+int main(int argc, char** argv) {
+    scenario custom = {-1, 0, 0};
+    int opt;
+    while ((opt = getopt(argc, argv, "t:d:cr:j:l:")) != -1) {
+        switch (opt) {
+            case 't':
+                seconds = atof(optarg);
+                break;
+            case 'd':
+                inputDelay = atoi(optarg);
+                break;
+            case 'c':
+                swept = true;
+                break;
+            case 'r':
+                custom.rtt = atof(optarg) / 1e3;
+                break;
+            case 'j':
+                custom.jitter = atof(optarg) / 1e3;
+                break;
+            case 'l':
+                custom.loss = atof(optarg) / 100;
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (argc - optind > 1 || argc < optind || inputDelay < 0 || inputDelay > NET_MAX_INPUT_DELAY) {
+        fprintf(stderr, "usage: %s [-t seconds] [-d input delay] [-c] [-r rtt ms -l loss percent [-j jitter ms]] [seed]\n", argv[0]);
+        return 1;
+    }
+    seed = argc - optind > 0 ? strtoull(argv[optind], NULL, 10) : (uint64_t) time(NULL);
+    printf("seed %llu, %.0f s per run\n", (unsigned long long) seed, seconds);
+
+    bool passed = true;
+    if (custom.rtt >= 0) {
+        passed = runScenario(custom);
+    } else {
+        for (int i = 0; i < (int) (sizeof(defaultScenarios) / sizeof(defaultScenarios[0])); i++) {
+            passed &= runScenario(defaultScenarios[i]);
+        }
+    }
+    return !passed;
+}
@@ -0,0 +1,440 @@
+#include "pong_net.h"
+
+#include <arpa/inet.h>
+#include <limits.h>
+#include <math.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * packets start with "PN" and a type byte, integers are little endian
+ *   hello     sent by the connecting peer until it is welcomed
+ *   welcome   seed (8 bytes), collision mode, input delay
+ *   inputs    sender's present tick (4), its advantage (1, signed), ack: remote inputs it has below this tick (4),
+ *             first tick carried (4), count (1), the directions packed four to a byte,
+ *             then the newest hashed tick (4) and its hash (8), both 0xff.. until the first hash
+*/
+
+#define PACKET_MAGIC "PN"
+#define HELLO_PACKET (1)
+#define WELCOME_PACKET (2)
+#define INPUTS_PACKET (3)
+#define NO_HASH (0xffffffffu)
+// ticks between waits for a peer that has fallen behind
+#define SYNC_SPACING (10)
+// weight of each packet in the smoothed advantages
+#define ADVANTAGE_SMOOTHING (1. / 16)
+// resend interval for hello during the handshake, seconds
+#define HELLO_INTERVAL (.1)
+
+static double netNow() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// low level encoding
+
+static unsigned char* putInt(unsigned char* p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) *p++ = v >> (8 * i) & 0xff;
+    return p;
+}
+
+static uint64_t getInt(const unsigned char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint64_t) p[i] << (8 * i);
+    return v;
+}
+
+static unsigned char* putHeader(unsigned char* p, int type) {
+    memcpy(p, PACKET_MAGIC, 2);
+    p[2] = type;
+    return p + 3;
+}
+
+/**
+ * FNV-1a step over the bytes of a value
+*/
+static uint64_t hashBytes(uint64_t h, const void* data, size_t size) {
+    const unsigned char* p = data;
+    for (size_t i = 0; i < size; i++) h = (h ^ p[i]) * 0x100000001b3ull;
+    return h;
+}
+
+uint64_t hashTickState(const tickState* s) {
+    const matchState* m = &s->match;
+    uint64_t h = 0xcbf29ce484222325ull;
+    const float floats[] = {m->ballX, m->ballY, m->leftPaddleY, m->rightPaddleY, m->ballVelocityX, m->ballVelocityY, m->ballSpeed};
+    h = hashBytes(h, floats, sizeof(floats));
+    const int ints[] = {m->leftScore, m->rightScore, m->leftStart, m->inPlay, m->leftComputerShot, m->rightComputerShot,
+            s->serveDelay, s->resumeDelay};
+    h = hashBytes(h, ints, sizeof(ints));
+    const uint64_t rng[] = {m->rng.key, m->rng.counter};
+    return hashBytes(h, rng, sizeof(rng));
+}
+
+// simulated link
+
+/**
+ * sends a packet to the peer through the simulated link
+*/
+static void sendPacket(netSession* n, const unsigned char* data, int size) {
+    n->stats.packetsSent++;
+    if (n->link.loss > 0 && randomFloat(&n->linkRng) < n->link.loss) {
+        n->stats.packetsDropped++;
+        return;
+    }
+    if ((n->link.delay > 0 || n->link.jitter > 0) && n->delayedCount < NET_LINK_QUEUE) {
+        delayedPacket* d = &n->delayed[n->delayedCount++];
+        d->release = netNow() + n->link.delay + n->link.jitter * randomFloat(&n->linkRng);
+        d->size = size;
+        memcpy(d->data, data, size);
+        return;
+    }
+    sendto(n->socket, data, size, 0, (const struct sockaddr*) &n->peer, sizeof(n->peer));
+}
+
+/**
+ * sends every delayed packet that is due, jitter can reorder them
+*/
+static void flushLink(netSession* n) {
+    double t = netNow();
+    for (int i = 0; i < n->delayedCount;) {
+        delayedPacket* d = &n->delayed[i];
+        if (d->release > t) {
+            i++;
+            continue;
+        }
+        sendto(n->socket, d->data, d->size, 0, (const struct sockaddr*) &n->peer, sizeof(n->peer));
+        *d = n->delayed[--n->delayedCount];
+    }
+}
+
+// session setup
+
+/**
+ * starts the match both peers will play, from the same state as a game started from the menu
+*/
+static void startSession(netSession* n) {
+    initMatch(&n->state.match, n->seed);
+    n->state.match.sweptCollisions = n->swept;
+    n->state.serveDelay = RESUME_DELAY_TICKS;
+    n->state.resumeDelay = 0;
+    initRollback(&n->history, 0);
+    // both sides stand still for the ticks before the first input can land
+    for (int i = 0; i < NET_INPUT_WINDOW; i++) n->localInputs[i] = n->remoteInputs[i] = STATIC;
+    n->localKnown = n->remoteKnown = n->remoteAcked = n->inputDelay;
+    n->mispredicted = ULONG_MAX;
+    n->localAdvantage = n->remoteAdvantage = 0;
+    n->lastSyncWait = 0;
+    for (int i = 0; i < NET_HASH_SLOTS; i++) n->localHashTicks[i] = n->remoteHashTicks[i] = ULONG_MAX;
+    n->nextHash = 0;
+    n->result = NO_EVENT;
+    n->lastHeard = netNow();
+    n->disconnected = false;
+    memset(&n->stats, 0, sizeof(n->stats));
+    seedRandom(&n->linkRng, n->seed ^ n->host);
+    n->delayedCount = 0;
+}
+
+/**
+ * opens a UDP socket bound to port on every interface
+*/
+static bool openSocket(netSession* n, unsigned short port, netLink link) {
+    memset(n, 0, sizeof(*n));
+    n->link = link;
+    n->delayed = malloc(NET_LINK_QUEUE * sizeof(delayedPacket));
+    n->socket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (!n->delayed || n->socket < 0) {
+        perror("socket");
+        closeNet(n);
+        return false;
+    }
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY)};
+    if (bind(n->socket, (const struct sockaddr*) &address, sizeof(address)) != 0) {
+        perror("bind");
+        closeNet(n);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * waits up to timeout seconds for a packet, returns its size, 0 on timeout and -1 on errors
+*/
+static int receivePacket(netSession* n, unsigned char* data, int size, struct sockaddr_in* from, double timeout) {
+    struct pollfd p = {.fd = n->socket, .events = POLLIN};
+    int ready = poll(&p, 1, (int) (timeout * 1000));
+    if (ready <= 0) return ready;
+    socklen_t length = sizeof(*from);
+    return recvfrom(n->socket, data, size, 0, (struct sockaddr*) from, &length);
+}
+
+static bool isPacket(const unsigned char* data, int size, int type) {
+    return size >= 3 && memcmp(data, PACKET_MAGIC, 2) == 0 && data[2] == type;
+}
+
+static void sendWelcome(netSession* n) {
+    unsigned char packet[16];
+    unsigned char* p = putHeader(packet, WELCOME_PACKET);
+    p = putInt(p, n->seed, 8);
+    *p++ = n->swept;
+    *p++ = n->inputDelay;
+    sendto(n->socket, packet, p - packet, 0, (const struct sockaddr*) &n->peer, sizeof(n->peer));
+}
+
+bool netHost(netSession* n, unsigned short port, uint64_t seed, bool swept, int inputDelay, netLink link,
+        void (*ready)(netSession*)) {
+    if (!openSocket(n, port, link)) return false;
+    n->host = true;
+    n->seed = seed;
+    n->swept = swept;
+    n->inputDelay = max(min(inputDelay, NET_MAX_INPUT_DELAY), 0);
+    if (ready) ready(n);
+    double deadline = netNow() + NET_CONNECT_TIMEOUT;
+    for (double t = netNow(); t < deadline; t = netNow()) {
+        unsigned char packet[64];
+        struct sockaddr_in from;
+        int size = receivePacket(n, packet, sizeof(packet), &from, deadline - t);
+        if (size < 0) break;
+        if (!isPacket(packet, size, HELLO_PACKET)) continue;
+        n->peer = from;
+        startSession(n);
+        sendWelcome(n);
+        return true;
+    }
+    closeNet(n);
+    return false;
+}
+
+bool netConnect(netSession* n, const char* host, unsigned short port, netLink link) {
+    struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_DGRAM};
+    struct addrinfo* found;
+    if (getaddrinfo(host, NULL, &hints, &found) != 0) return false;
+    struct sockaddr_in peer = *(struct sockaddr_in*) found->ai_addr;
+    freeaddrinfo(found);
+    peer.sin_port = htons(port);
+    if (!openSocket(n, 0, link)) return false;
+    n->peer = peer;
+    n->host = false;
+    double deadline = netNow() + NET_CONNECT_TIMEOUT;
+    for (double t = netNow(); t < deadline; t = netNow()) {
+        unsigned char packet[64];
+        putHeader(packet, HELLO_PACKET);
+        sendto(n->socket, packet, 3, 0, (const struct sockaddr*) &n->peer, sizeof(n->peer));
+        double resend = t + HELLO_INTERVAL;
+        for (t = netNow(); t < resend; t = netNow()) {
+            struct sockaddr_in from;
+            int size = receivePacket(n, packet, sizeof(packet), &from, resend - t);
+            if (size < 0) break;
+            if (size < 13 || !isPacket(packet, size, WELCOME_PACKET) || from.sin_addr.s_addr != peer.sin_addr.s_addr
+                    || from.sin_port != peer.sin_port) continue;
+            // netHost never offers more, and a longer delay would overrun the input rings
+            if (packet[12] > NET_MAX_INPUT_DELAY) continue;
+            n->seed = getInt(packet + 3, 8);
+            n->swept = packet[11];
+            n->inputDelay = packet[12];
+            startSession(n);
+            return true;
+        }
+    }
+    closeNet(n);
+    return false;
+}
+
+unsigned short netPort(const netSession* n) {
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    if (getsockname(n->socket, (struct sockaddr*) &address, &length) != 0) return 0;
+    return ntohs(address.sin_port);
+}
+
+void closeNet(netSession* n) {
+    if (n->socket >= 0) close(n->socket);
+    n->socket = -1;
+    free(n->delayed);
+    n->delayed = NULL;
+}
+
+// play
+
+/**
+ * the inputs a tick is played with, the remote one predicted as the last known if it hasn't arrived
+*/
+static tickInput inputFor(const netSession* n, unsigned long tick) {
+    direction remote = n->remoteInputs[(tick < n->remoteKnown ? tick : n->remoteKnown - 1) % NET_INPUT_WINDOW];
+    direction local = n->localInputs[tick % NET_INPUT_WINDOW];
+    return n->host ? (tickInput) {local, remote} : (tickInput) {remote, local};
+}
+
+/**
+ * checks a pair of hashes for the same tick, if both sides have one
+*/
+static void compareHashes(netSession* n, int slot) {
+    if (n->localHashTicks[slot] == ULONG_MAX || n->localHashTicks[slot] != n->remoteHashTicks[slot]) return;
+    n->stats.hashesChecked++;
+    if (n->localHashes[slot] != n->remoteHashes[slot] && !n->stats.desynced) {
+        n->stats.desynced = true;
+        n->stats.desyncTick = n->localHashTicks[slot];
+    }
+}
+
+/**
+ * takes in a packet of remote inputs, noting the earliest tick that was played on a wrong prediction
+*/
+static void receiveInputs(netSession* n, const unsigned char* data, int size) {
+    if (size < 17) return;
+    unsigned long present = getInt(data + 3, 4);
+    int advantage = (signed char) data[7];
+    unsigned long ack = getInt(data + 8, 4);
+    unsigned long first = getInt(data + 12, 4);
+    int count = data[16];
+    int packed = (count + 3) / 4;
+    if (size < 17 + packed + 12) return;
+    n->stats.packetsReceived++;
+    n->lastHeard = netNow();
+
+    n->remoteAdvantage += (advantage - n->remoteAdvantage) * ADVANTAGE_SMOOTHING;
+    n->localAdvantage += ((double) n->history.present - present - n->localAdvantage) * ADVANTAGE_SMOOTHING;
+    if (ack > n->remoteAcked && ack <= n->localKnown) n->remoteAcked = ack;
+
+    if (first <= n->remoteKnown && first + count > n->remoteKnown) {
+        for (unsigned long tick = n->remoteKnown; tick < first + count; tick++) {
+            int i = tick - first;
+            n->remoteInputs[tick % NET_INPUT_WINDOW] = data[17 + i / 4] >> (2 * (i % 4)) & 3;
+        }
+        n->remoteKnown = first + count;
+        // ticks already played were played on a prediction, those beyond the new inputs get a fresh one
+        for (unsigned long tick = max(first, n->history.oldest); tick < n->history.present; tick++) {
+            if (correctInput(&n->history, tick, inputFor(n, tick)) && tick < n->mispredicted) n->mispredicted = tick;
+        }
+    }
+
+    const unsigned char* hash = data + 17 + packed;
+    unsigned long hashTick = getInt(hash, 4);
+    // every packet repeats the newest hash, compare it once
+    if (hashTick != NO_HASH && hashTick != n->remoteHashTicks[hashTick / NET_HASH_INTERVAL % NET_HASH_SLOTS]) {
+        int slot = hashTick / NET_HASH_INTERVAL % NET_HASH_SLOTS;
+        n->remoteHashTicks[slot] = hashTick;
+        n->remoteHashes[slot] = getInt(hash + 4, 8);
+        compareHashes(n, slot);
+    }
+}
+
+/**
+ * reads every packet waiting on the socket
+*/
+static void receiveAll(netSession* n) {
+    unsigned char packet[256];
+    struct sockaddr_in from;
+    socklen_t length = sizeof(from);
+    int size;
+    while ((size = recvfrom(n->socket, packet, sizeof(packet), MSG_DONTWAIT, (struct sockaddr*) &from, &length)) >= 0) {
+        length = sizeof(from);
+        if (from.sin_addr.s_addr != n->peer.sin_addr.s_addr || from.sin_port != n->peer.sin_port) continue;
+        // the welcome was lost, the peer is still saying hello
+        if (n->host && isPacket(packet, size, HELLO_PACKET)) sendWelcome(n);
+        else if (isPacket(packet, size, INPUTS_PACKET)) receiveInputs(n, packet, size);
+    }
+}
+
+/**
+ * state at the start of a held or present tick
+*/
+static const tickState* stateAt(const netSession* n, unsigned long tick) {
+    return tick == n->history.present ? &n->state : &n->history.states[tick % ROLLBACK_TICKS];
+}
+
+unsigned long netConfirmed(const netSession* n) {
+    return min(n->remoteKnown, n->history.present);
+}
+
+/**
+ * hashes every due tick whose state is final and checks for a confirmed win
+*/
+static void confirmTicks(netSession* n) {
+    unsigned long confirmed = netConfirmed(n);
+    for (; n->nextHash <= confirmed; n->nextHash += NET_HASH_INTERVAL) {
+        int slot = n->nextHash / NET_HASH_INTERVAL % NET_HASH_SLOTS;
+        n->localHashTicks[slot] = n->nextHash;
+        n->localHashes[slot] = hashTickState(stateAt(n, n->nextHash));
+        compareHashes(n, slot);
+    }
+    const matchState* m = &stateAt(n, confirmed)->match;
+    if (m->leftScore == TARGET_SCORE) n->result = LEFT_WIN;
+    else if (m->rightScore == TARGET_SCORE) n->result = RIGHT_WIN;
+}
+
+/**
+ * sends the peer every local input it hasn't acked, the newest hash and where this side stands
+*/
+static void sendInputs(netSession* n) {
+    unsigned char packet[sizeof(((delayedPacket*) 0)->data)];
+    unsigned long first = n->remoteAcked;
+    int count = min(n->localKnown - first, NET_MAX_INPUTS);
+    unsigned char* p = putHeader(packet, INPUTS_PACKET);
+    p = putInt(p, n->history.present, 4);
+    *p++ = (signed char) lround(max(min(n->localAdvantage, SCHAR_MAX), SCHAR_MIN));
+    p = putInt(p, n->remoteKnown, 4);
+    p = putInt(p, first, 4);
+    *p++ = count;
+    memset(p, 0, (count + 3) / 4);
+    for (int i = 0; i < count; i++) p[i / 4] |= n->localInputs[(first + i) % NET_INPUT_WINDOW] << (2 * (i % 4));
+    p += (count + 3) / 4;
+    if (n->nextHash > 0) {
+        unsigned long hashTick = n->nextHash - NET_HASH_INTERVAL;
+        p = putInt(p, hashTick, 4);
+        p = putInt(p, n->localHashes[hashTick / NET_HASH_INTERVAL % NET_HASH_SLOTS], 8);
+    } else {
+        p = putInt(p, NO_HASH, 4);
+        p = putInt(p, 0, 8);
+    }
+    sendPacket(n, packet, p - packet);
+}
+
+bool netTick(netSession* n, direction local) {
+    receiveAll(n);
+    flushLink(n);
+    if (netNow() - n->lastHeard > NET_PEER_TIMEOUT) n->disconnected = true;
+
+    if (n->mispredicted < n->history.present) {
+        matchEvent won;
+        int depth = rollbackTo(&n->history, n->mispredicted, NULL, NULL, &n->state, &won);
+        n->stats.rollbacks++;
+        n->stats.resimulated += depth;
+        n->stats.deepestRollback = max(n->stats.deepestRollback, depth);
+    }
+    n->mispredicted = ULONG_MAX;
+
+    unsigned long present = n->history.present;
+    bool advance = true;
+    if (present >= n->remoteKnown + NET_MAX_PREDICTION) {
+        n->stats.stalls++;
+        advance = false;
+    } else if (n->localAdvantage - n->remoteAdvantage >= 2 && present - n->lastSyncWait >= SYNC_SPACING) {
+        // a tick or more ahead of the peer, let it catch up before mispredictions pile up on this side
+        n->lastSyncWait = present;
+        n->stats.syncWaits++;
+        advance = false;
+    }
+
+    if (advance) {
+        n->localInputs[(present + n->inputDelay) % NET_INPUT_WINDOW] = local;
+        n->localKnown = present + n->inputDelay + 1;
+        tickState before = n->state;
+        tickInput in = inputFor(n, present);
+        bool serve;
+        if (beginTick(&n->state, &serve)) endTick(&n->state, in);
+        saveTick(&n->history, &before, in);
+    }
+    confirmTicks(n);
+    sendInputs(n);
+    flushLink(n);
+    return advance;
+}
@@ -0,0 +1,154 @@
+#ifndef PONG_NET_H
+#define PONG_NET_H
+
+#include <netinet/in.h>
+
+#include "pong_core.h"
+#include "pong_rollback.h"
+
+// a peer runs at most this many ticks past the last remote input it has, then waits for the other side
+// well inside ROLLBACK_TICKS so every misprediction can still be rolled back
+#define NET_MAX_PREDICTION (48)
+// local inputs carried by one packet, so every input goes out in several packets until the peer acks it
+#define NET_MAX_INPUTS (64)
+// inputs remembered per side, must be a power of two above NET_MAX_PREDICTION + the input delay
+#define NET_INPUT_WINDOW (256)
+// ticks between state hashes compared for desync detection
+#define NET_HASH_INTERVAL (60)
+// hashes remembered per side
+#define NET_HASH_SLOTS (16)
+// delayed packets the simulated link holds
+#define NET_LINK_QUEUE (512)
+// input delay unless configured otherwise and its upper limit, in ticks
+#define NET_DEFAULT_INPUT_DELAY (2)
+#define NET_MAX_INPUT_DELAY (15)
+// the handshake gives up after this long
+#define NET_CONNECT_TIMEOUT (10.)
+// a peer silent for this long has left the game, seconds
+#define NET_PEER_TIMEOUT (5.)
+
+/**
+ * impairment applied to every outgoing packet, for testing over loopback or a fast network
+*/
+typedef struct {
+    // one way delay and uniform extra jitter, seconds
+    double delay, jitter;
+    // chance of dropping a packet, 0 to 1
+    double loss;
+} netLink;
+
+/**
+ * counters for the loopback harness and the game's exit report
+*/
+typedef struct {
+    unsigned long packetsSent, packetsDropped, packetsReceived;
+    // ticks not played because the remote inputs were too far behind, or to let a lagging peer catch up
+    unsigned long stalls, syncWaits;
+    unsigned long rollbacks, resimulated;
+    int deepestRollback;
+    // hashes compared with the peer's, and the first tick whose hashes differed
+    unsigned long hashesChecked;
+    bool desynced;
+    unsigned long desyncTick;
+} netStats;
+
+/**
+ * a packet held back by the simulated link
+*/
+typedef struct {
+    double release;
+    int size;
+    unsigned char data[NET_MAX_INPUTS + 64];
+} delayedPacket;
+
+/**
+ * one side of a two player game over UDP
+ * both peers play the same deterministic match: each sends its own paddle directions for every tick,
+ * plays ahead on a prediction of the other's (its last known direction) and rolls back when the real ones differ
+*/
+typedef struct {
+    int socket;
+    struct sockaddr_in peer;
+    // the host plays the left paddle
+    bool host;
+    uint64_t seed;
+    bool swept;
+    int inputDelay;
+    netLink link;
+    rngStream linkRng;
+    delayedPacket* delayed;
+    int delayedCount;
+
+    // present state and the history behind it
+    tickState state;
+    rollbackRing history;
+
+    // directions by tick, slot tick % NET_INPUT_WINDOW
+    direction localInputs[NET_INPUT_WINDOW], remoteInputs[NET_INPUT_WINDOW];
+    // local inputs are known below localKnown, remote ones below remoteKnown
+    unsigned long localKnown, remoteKnown;
+    // the peer has every local input below remoteAcked
+    unsigned long remoteAcked;
+    // earliest tick played on a wrong prediction, ULONG_MAX if none
+    unsigned long mispredicted;
+
+    // how many ticks each side reckons it is ahead of the other, smoothed over recent packets,
+    // for keeping the two in step
+    double localAdvantage, remoteAdvantage;
+    unsigned long lastSyncWait;
+
+    // hashes of the state at the start of every NET_HASH_INTERVAL-th tick, once all its inputs are final
+    uint64_t localHashes[NET_HASH_SLOTS], remoteHashes[NET_HASH_SLOTS];
+    unsigned long localHashTicks[NET_HASH_SLOTS], remoteHashTicks[NET_HASH_SLOTS];
+    // next tick to hash
+    unsigned long nextHash;
+
+    // win confirmed by both sides' inputs, NO_EVENT until then
+    matchEvent result;
+    // when the peer was last heard from, it is gone after NET_PEER_TIMEOUT
+    double lastHeard;
+    bool disconnected;
+    netStats stats;
+} netSession;
+
+/**
+ * waits for a peer to connect on port (0 picks a free one, see netPort) and starts a match with it
+ * the host decides the seed, collision mode and input delay and plays the left paddle
+ * ready, if not NULL, is called once the socket is listening
+ * returns false on socket errors or after NET_CONNECT_TIMEOUT without a peer
+*/
+bool netHost(netSession* n, unsigned short port, uint64_t seed, bool swept, int inputDelay, netLink link,
+        void (*ready)(netSession*));
+
+/**
+ * connects to a host, given as name or address and port, and starts the match it sends
+ * returns false if the name doesn't resolve or the host doesn't answer within NET_CONNECT_TIMEOUT
+*/
+bool netConnect(netSession* n, const char* host, unsigned short port, netLink link);
+
+/**
+ * port the session's socket is bound to
+*/
+unsigned short netPort(const netSession* n);
+
+/**
+ * plays one tick: takes in the peer's packets, rolls back any mispredicted ticks, queues the local
+ * direction for input delay ticks from now, advances the present and sends the peer the inputs it lacks
+ * returns false if the tick was held back, waiting on the peer, in which case the present didn't move
+ * sets disconnected once the peer has been silent for NET_PEER_TIMEOUT
+*/
+bool netTick(netSession* n, direction local);
+
+/**
+ * ticks whose inputs from both sides have arrived, the state at the start of the first of the rest is final
+*/
+unsigned long netConfirmed(const netSession* n);
+
+/**
+ * hash of everything the simulation reads, independent of struct layout
+*/
+uint64_t hashTickState(const tickState* s);
+
+void closeNet(netSession* n);
+
+#endif
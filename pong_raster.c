@@ -0,0 +1,134 @@
+#include "pong_raster.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "pong_font.h"
+#include "pong_scene.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RASTER_X86
+#endif
+
+/**
+ * adds light to a pixel, saturating at white
+ * pieces are light on black, so adding lets neighbouring blocks of a glyph share an edge pixel without a seam
+*/
+static inline uint8_t addLight(uint8_t pixel, int level) {
+    int sum = pixel + level;
+    return sum > 255 ? 255 : sum;
+}
+
+/**
+ * adds the same level to n pixels, 16 at a time with saturating SSE2 adds, baseline on every x86-64 cpu
+*/
+static inline void addSpan(uint8_t* p, int n, int level) {
+#ifdef RASTER_X86
+    const __m128i v = _mm_set1_epi8((char) level);
+    for (; n >= 16; n -= 16, p += 16) {
+        _mm_storeu_si128((__m128i*) p, _mm_adds_epu8(_mm_loadu_si128((const __m128i*) p), v));
+    }
+#endif
+    for (; n > 0; n--, p++) *p = addLight(*p, level);
+}
+
+/**
+ * draws a rectangle between two opposite corners in window coordinates, like pushRect, clipped to the frame
+ * edge pixels get the shade in proportion to how much of them the rectangle covers
+*/
+static void fillRect(const sceneRenderer* r, uint8_t* pixels, float x1, float y1, float x2, float y2, float shade) {
+    // frame coordinates, y flipped to run down from the top row
+    float left = max(min(x1, x2) * r->scaleX, 0.f);
+    float right = min(max(x1, x2) * r->scaleX, (float) r->width);
+    float top = max((WINDOW_HEIGHTF - max(y1, y2)) * r->scaleY, 0.f);
+    float bottom = min((WINDOW_HEIGHTF - min(y1, y2)) * r->scaleY, (float) r->height);
+    if (left >= right || top >= bottom) return;
+
+    // columns first to end and rows top to bottom are touched, the outer columns only partly
+    int first = (int) left, end = (int) ceilf(right);
+    float firstCover = end - first == 1 ? right - left : first + 1 - left;
+    float lastCover = right - (end - 1);
+    for (int row = (int) top; row < bottom; row++) {
+        float rowCover = min(bottom, row + 1.f) - max(top, (float) row);
+        float level = shade * 255 * rowCover;
+        uint8_t* p = pixels + (long) row * r->width;
+        p[first] = addLight(p[first], (int) (level * firstCover + .5f));
+        if (end - first > 1) {
+            addSpan(p + first + 1, end - first - 2, (int) (level + .5f));
+            p[end - 1] = addLight(p[end - 1], (int) (level * lastCover + .5f));
+        }
+    }
+}
+
+/**
+ * draws text in the block font like pushText, (x, y) is the bottom left corner
+*/
+static void fillText(const sceneRenderer* r, uint8_t* pixels, float x, float y, float width, float height, float spacing,
+        const char* text, float shade) {
+    for (; *text; text++, x += width + spacing) {
+        const glyphRect* blocks;
+        int n = glyphBlocks(*text, &blocks);
+        for (int i = 0; i < n; i++) {
+            const glyphRect* g = &blocks[i];
+            fillRect(r, pixels, x + g->x1 * width, y + g->y1 * height, x + g->x2 * width, y + g->y2 * height, shade);
+        }
+    }
+}
+
+/**
+ * draws a score like pushGamePieces does, ending at x if alignRight is set and starting there otherwise
+*/
+static void fillScore(const sceneRenderer* r, uint8_t* pixels, float x, float y, unsigned int score, bool alignRight) {
+    char digits[16];
+    snprintf(digits, sizeof(digits), "%u", score);
+    if (alignRight) x -= textWidth(digits, DIGIT_WIDTH, DIGIT_SPACING);
+    fillText(r, pixels, x, y, DIGIT_WIDTH, DIGIT_HEIGHT, DIGIT_SPACING, digits, GAME_ENVIRONMENT_SHADE);
+}
+
+bool initSceneRenderer(sceneRenderer* r, int width, int height) {
+    if (width < 1 || height < 1) return false;
+    r->width = width;
+    r->height = height;
+    r->scaleX = width / WINDOW_WIDTHF;
+    r->scaleY = height / WINDOW_HEIGHTF;
+    r->background = calloc((size_t) width * height, 1);
+    if (!r->background) return false;
+    float x = (WINDOW_WIDTHF / 2) - DASH_OFFSET;
+    for (float y = 0; y < WINDOW_HEIGHTF; y += 2 * DASH_HEIGHT) {
+        fillRect(r, r->background, x, y, x + DASH_WIDTH, y + DASH_HEIGHT, GAME_ENVIRONMENT_SHADE);
+    }
+    return true;
+}
+
+void freeSceneRenderer(sceneRenderer* r) {
+    free(r->background);
+    r->background = NULL;
+}
+
+/**
+ * one game screen in display's order: centerline, paddles, scores, ball
+*/
+static void drawScene(const sceneRenderer* r, uint8_t* pixels, float ballX, float ballY, float leftPaddleY,
+        float rightPaddleY, unsigned int leftScore, unsigned int rightScore) {
+    memcpy(pixels, r->background, (size_t) r->width * r->height);
+    fillRect(r, pixels, LEFT_PADDLE_X - PADDLE_WIDTH, leftPaddleY, LEFT_PADDLE_X, leftPaddleY + PADDLE_HEIGHT, PADDLE_SHADE);
+    fillRect(r, pixels, RIGHT_PADDLE_X, rightPaddleY, RIGHT_PADDLE_X + PADDLE_WIDTH, rightPaddleY + PADDLE_HEIGHT, PADDLE_SHADE);
+    fillScore(r, pixels, (WINDOW_WIDTHF / 2) - DIGIT_OFFSET, WINDOW_HEIGHTF - DIGIT_HEIGHT - DIGIT_OFFSET, leftScore, true);
+    fillScore(r, pixels, (WINDOW_WIDTHF / 2) + DIGIT_OFFSET, WINDOW_HEIGHTF - DIGIT_HEIGHT - DIGIT_OFFSET, rightScore, false);
+    fillRect(r, pixels, ballX, ballY, ballX + BALL_DIM, ballY + BALL_DIM, BALL_SHADE);
+}
+
+void drawMatchFrame(const sceneRenderer* r, const matchState* m, uint8_t* pixels) {
+    drawScene(r, pixels, m->ballX, m->ballY, m->leftPaddleY, m->rightPaddleY, m->leftScore, m->rightScore);
+}
+
+void drawBatchFrames(const sceneRenderer* r, const matchBatch* b, uint8_t* pixels) {
+    size_t frameSize = (size_t) r->width * r->height;
+    for (int i = 0; i < b->count; i++) {
+        drawScene(r, pixels + i * frameSize, b->ballX[i], b->ballY[i], b->leftPaddleY[i], b->rightPaddleY[i],
+                b->leftScore[i], b->rightScore[i]);
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef PONG_RASTER_H
+#define PONG_RASTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pong_core.h"
+#include "pong_batch.h"
+
+/*
+ * software rasterizer for the game screen, draws what display() draws into memory without a GL context
+ * frames are 8 bit grayscale, one byte per pixel with row 0 at the top, at any size: the court is stretched
+ * to fill the frame, so odd sizes like 84 by 84 come out directly instead of being scaled down afterwards
+ * edges are antialiased by how much of each pixel a rectangle covers, so pieces smaller than a pixel stay visible
+*/
+
+/**
+ * what a frame size needs, plain data apart from the background
+*/
+typedef struct {
+    int width, height;
+    // pixels per window unit
+    float scaleX, scaleY;
+    // the centerline on black, copied under every frame
+    uint8_t* background;
+} sceneRenderer;
+
+/**
+ * sets up frames of width by height pixels
+ * returns false if either is below 1 or allocation fails
+*/
+bool initSceneRenderer(sceneRenderer* r, int width, int height);
+
+void freeSceneRenderer(sceneRenderer* r);
+
+/**
+ * draws a match's paddles, ball, scores and centerline into width * height bytes
+*/
+void drawMatchFrame(const sceneRenderer* r, const matchState* m, uint8_t* pixels);
+
+/**
+ * draws every match of a batch, frame i at pixels + i * width * height
+*/
+void drawBatchFrames(const sceneRenderer* r, const matchBatch* b, uint8_t* pixels);
+
+#endif
@@ -0,0 +1,404 @@
+#include "pong_record.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * file layout, integers are LEB128 varints unless noted
+ *   header    "PRPL", version byte, seed (8 bytes little endian), keyframe interval
+ *   body      a run is one symbol byte below KEYFRAME_TAG followed by its length,
+ *             a keyframe is KEYFRAME_TAG, its tick and a match state
+ *   trailer   END_TAG, tick count, final match state, keyframe count, then each keyframe's
+ *             tick and file offset as differences from the previous one
+ *   footer    offset of END_TAG (8 bytes little endian), "PIDX"
+ * match states are written field by field so they don't depend on struct layout
+*/
+
+#define REPLAY_MAGIC "PRPL"
+#define INDEX_MAGIC "PIDX"
+#define REPLAY_VERSION (1)
+#define FOOTER_SIZE (12)
+
+// symbols are replayTicks packed into 6 bits, bytes from KEYFRAME_TAG up are tags
+#define KEYFRAME_TAG (0x40)
+#define END_TAG (0x41)
+#define SERVE_BIT (0x10)
+#define IDLE_BIT (0x20)
+
+static int encodeTick(replayTick t) {
+    return t.left | t.right << 2 | (t.serve ? SERVE_BIT : 0) | (t.idle ? IDLE_BIT : 0);
+}
+
+static replayTick decodeTick(int symbol) {
+    return (replayTick) {symbol & 3, symbol >> 2 & 3, symbol & SERVE_BIT, symbol & IDLE_BIT};
+}
+
+matchEvent applyReplayTick(matchState* m, replayTick t) {
+    if (t.serve) serveBall(m);
+    if (t.idle) return NO_EVENT;
+    return stepMatch(m, t.left, t.right);
+}
+
+// low level encoding
+
+static void putVarint(FILE* f, uint64_t v) {
+    while (v >= 0x80) {
+        putc((v & 0x7f) | 0x80, f);
+        v >>= 7;
+    }
+    putc(v, f);
+}
+
+static void putFixed(FILE* f, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) putc(v >> (8 * i) & 0xff, f);
+}
+
+static void putFloat(FILE* f, float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    putFixed(f, bits, 4);
+}
+
+static void putDouble(FILE* f, double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    putFixed(f, bits, 8);
+}
+
+/**
+ * reads a varint into v
+ * returns false on end of file or a malformed value
+*/
+static bool getVarint(FILE* f, uint64_t* v) {
+    *v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = getc(f);
+        if (c == EOF) return false;
+        *v |= (uint64_t) (c & 0x7f) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+static bool getFixed(FILE* f, uint64_t* v, int bytes) {
+    *v = 0;
+    for (int i = 0; i < bytes; i++) {
+        int c = getc(f);
+        if (c == EOF) return false;
+        *v |= (uint64_t) c << (8 * i);
+    }
+    return true;
+}
+
+static bool getFloat(FILE* f, float* x) {
+    uint64_t bits;
+    if (!getFixed(f, &bits, 4)) return false;
+    uint32_t narrow = bits;
+    memcpy(x, &narrow, sizeof(*x));
+    return true;
+}
+
+static bool getDouble(FILE* f, double* x) {
+    uint64_t bits;
+    if (!getFixed(f, &bits, 8)) return false;
+    memcpy(x, &bits, sizeof(*x));
+    return true;
+}
+
+static void putConfig(FILE* f, const computerConfig* c) {
+    for (int s = 0; s < SHOT_TYPES; s++) putVarint(f, c->shotWeights[s]);
+    putDouble(f, c->aimingTolerance);
+}
+
+static bool getConfig(FILE* f, computerConfig* c) {
+    for (int s = 0; s < SHOT_TYPES; s++) {
+        uint64_t w;
+        if (!getVarint(f, &w)) return false;
+        c->shotWeights[s] = w;
+    }
+    return getDouble(f, &c->aimingTolerance);
+}
+
+static void putState(FILE* f, const matchState* m) {
+    putFloat(f, m->ballX);
+    putFloat(f, m->ballY);
+    putFloat(f, m->leftPaddleY);
+    putFloat(f, m->rightPaddleY);
+    putFloat(f, m->ballVelocityX);
+    putFloat(f, m->ballVelocityY);
+    putFloat(f, m->ballSpeed);
+    putc(m->leftScore, f);
+    putc(m->rightScore, f);
+    putc(m->leftStart | m->inPlay << 1 | m->leftPredicted << 2 | m->rightPredicted << 3 | m->sweptCollisions << 4, f);
+    putc(m->leftComputerShot, f);
+    putc(m->rightComputerShot, f);
+    putConfig(f, &m->leftConfig);
+    putConfig(f, &m->rightConfig);
+    putFloat(f, m->leftIntercept);
+    putFloat(f, m->rightIntercept);
+    putFixed(f, m->rng.key, 8);
+    putFixed(f, m->rng.counter, 8);
+}
+
+static bool getState(FILE* f, matchState* m) {
+    bool ok = getFloat(f, &m->ballX) && getFloat(f, &m->ballY)
+            && getFloat(f, &m->leftPaddleY) && getFloat(f, &m->rightPaddleY)
+            && getFloat(f, &m->ballVelocityX) && getFloat(f, &m->ballVelocityY)
+            && getFloat(f, &m->ballSpeed);
+    int leftScore = getc(f), rightScore = getc(f), flags = getc(f), leftShot = getc(f), rightShot = getc(f);
+    if (!ok || rightShot == EOF || leftShot == EOF || flags == EOF || rightScore == EOF || leftScore == EOF) return false;
+    m->leftScore = leftScore;
+    m->rightScore = rightScore;
+    m->leftStart = flags & 1;
+    m->inPlay = flags >> 1 & 1;
+    m->leftPredicted = flags >> 2 & 1;
+    m->rightPredicted = flags >> 3 & 1;
+    m->sweptCollisions = flags >> 4 & 1;
+    m->leftComputerShot = leftShot;
+    m->rightComputerShot = rightShot;
+    return getConfig(f, &m->leftConfig) && getConfig(f, &m->rightConfig)
+            && getFloat(f, &m->leftIntercept) && getFloat(f, &m->rightIntercept)
+            && getFixed(f, &m->rng.key, 8) && getFixed(f, &m->rng.counter, 8);
+}
+
+// writing
+
+/**
+ * grows the keyframe index to hold capacity entries
+ * returns false, leaving the index as it was, if allocation fails
+*/
+static bool growIndex(unsigned long** ticks, long** offsets, int capacity) {
+    unsigned long* grownTicks = realloc(*ticks, capacity * sizeof(unsigned long));
+    if (!grownTicks) return false;
+    *ticks = grownTicks;
+    long* grownOffsets = realloc(*offsets, capacity * sizeof(long));
+    if (!grownOffsets) return false;
+    *offsets = grownOffsets;
+    return true;
+}
+
+/**
+ * a keyframe the index has no room for is still written, seeks just start from the one before it
+*/
+static void writeKeyframe(replayWriter* w, const matchState* m) {
+    if (w->keyframes == w->keyframeCapacity) {
+        int capacity = w->keyframeCapacity ? 2 * w->keyframeCapacity : 64;
+        if (growIndex(&w->keyframeTicks, &w->keyframeOffsets, capacity)) {
+            w->keyframeCapacity = capacity;
+        } else {
+            fprintf(stderr, "out of memory for the replay index, keyframe at tick %lu left out\n", w->ticks);
+        }
+    }
+    if (w->keyframes < w->keyframeCapacity) {
+        w->keyframeTicks[w->keyframes] = w->ticks;
+        w->keyframeOffsets[w->keyframes++] = ftell(w->file);
+    }
+    putc(KEYFRAME_TAG, w->file);
+    putVarint(w->file, w->ticks);
+    putState(w->file, m);
+}
+
+static void writeRun(replayWriter* w) {
+    if (w->run == 0) return;
+    putc(w->symbol, w->file);
+    putVarint(w->file, w->run);
+    w->run = 0;
+}
+
+bool createReplay(replayWriter* w, const char* path, uint64_t seed, const matchState* start) {
+    w->file = fopen(path, "wb");
+    if (!w->file) {
+        perror(path);
+        return false;
+    }
+    w->ticks = 0;
+    w->run = 0;
+    w->keyframeTicks = NULL;
+    w->keyframeOffsets = NULL;
+    w->keyframes = w->keyframeCapacity = 0;
+    fputs(REPLAY_MAGIC, w->file);
+    putc(REPLAY_VERSION, w->file);
+    putFixed(w->file, seed, 8);
+    putVarint(w->file, REPLAY_KEYFRAME_TICKS);
+    writeKeyframe(w, start);
+    return true;
+}
+
+void recordReplayTick(replayWriter* w, const matchState* before, replayTick t) {
+    if (w->ticks > 0 && w->ticks % REPLAY_KEYFRAME_TICKS == 0) {
+        writeRun(w);
+        writeKeyframe(w, before);
+    }
+    int symbol = encodeTick(t);
+    if (w->run > 0 && symbol != w->symbol) writeRun(w);
+    w->symbol = symbol;
+    w->run++;
+    w->ticks++;
+}
+
+bool finishReplay(replayWriter* w, const matchState* final) {
+    writeRun(w);
+    long end = ftell(w->file);
+    putc(END_TAG, w->file);
+    putVarint(w->file, w->ticks);
+    putState(w->file, final);
+    putVarint(w->file, w->keyframes);
+    for (int i = 0; i < w->keyframes; i++) {
+        putVarint(w->file, w->keyframeTicks[i] - (i ? w->keyframeTicks[i - 1] : 0));
+        putVarint(w->file, w->keyframeOffsets[i] - (i ? w->keyframeOffsets[i - 1] : 0));
+    }
+    putFixed(w->file, end, 8);
+    fputs(INDEX_MAGIC, w->file);
+    bool ok = !ferror(w->file);
+    ok &= fclose(w->file) == 0;
+    free(w->keyframeTicks);
+    free(w->keyframeOffsets);
+    return ok;
+}
+
+// reading
+
+/**
+ * reads the trailer written by finishReplay, the body runs from bodyStart up to the end record
+ * returns false if the trailer is missing or damaged, so the index can be rebuilt by scanIndex
+*/
+static bool readIndex(replayReader* r, long bodyStart) {
+    char magic[4];
+    uint64_t end, count, tick = 0, offset = 0;
+    if (fseek(r->file, -FOOTER_SIZE, SEEK_END) != 0 || !getFixed(r->file, &end, 8)) return false;
+    if (fread(magic, 1, 4, r->file) != 4 || memcmp(magic, INDEX_MAGIC, 4) != 0) return false;
+    if (end <= (uint64_t) bodyStart || end > LONG_MAX) return false;
+    if (fseek(r->file, end, SEEK_SET) != 0 || getc(r->file) != END_TAG) return false;
+    if (!getVarint(r->file, &count)) return false;
+    r->ticks = count;
+    if (!getState(r->file, &r->final) || !getVarint(r->file, &count) || count == 0) return false;
+    // a keyframe is due every REPLAY_KEYFRAME_TICKS ticks and takes up more than a byte of the body
+    if (count > r->ticks / REPLAY_KEYFRAME_TICKS + 1 || count > end - bodyStart) return false;
+    r->keyframeTicks = malloc(count * sizeof(unsigned long));
+    r->keyframeOffsets = malloc(count * sizeof(long));
+    if (!r->keyframeTicks || !r->keyframeOffsets) return false;
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t tickDelta, offsetDelta;
+        if (!getVarint(r->file, &tickDelta) || !getVarint(r->file, &offsetDelta)) return false;
+        tick += tickDelta;
+        offset += offsetDelta;
+        if (tick > r->ticks || offset < (uint64_t) bodyStart || offset >= end) return false;
+        r->keyframeTicks[i] = tick;
+        r->keyframeOffsets[i] = offset;
+    }
+    r->keyframes = count;
+    r->complete = true;
+    return true;
+}
+
+/**
+ * rebuilds the index of a recording without a trailer by walking its body
+ * keeps everything up to the last run or keyframe that was written out whole
+*/
+static bool scanIndex(replayReader* r, long bodyStart) {
+    int capacity = 64;
+    free(r->keyframeTicks);
+    free(r->keyframeOffsets);
+    r->keyframeTicks = malloc(capacity * sizeof(unsigned long));
+    r->keyframeOffsets = malloc(capacity * sizeof(long));
+    r->keyframes = 0;
+    r->ticks = 0;
+    if (!r->keyframeTicks || !r->keyframeOffsets) return false;
+    fseek(r->file, bodyStart, SEEK_SET);
+    for (;;) {
+        long offset = ftell(r->file);
+        int c = getc(r->file);
+        uint64_t v;
+        if (c == EOF || c > KEYFRAME_TAG) break;
+        if (c < KEYFRAME_TAG) {
+            if (!getVarint(r->file, &v)) break;
+            r->ticks += v;
+            continue;
+        }
+        matchState m;
+        if (!getVarint(r->file, &v) || !getState(r->file, &m)) break;
+        if (r->keyframes == capacity) {
+            // out of memory: keep the recording up to this keyframe, like one cut short here
+            if (!growIndex(&r->keyframeTicks, &r->keyframeOffsets, 2 * capacity)) {
+                fprintf(stderr, "out of memory for the replay index, playing the first %lu ticks\n", r->ticks);
+                break;
+            }
+            capacity *= 2;
+        }
+        r->keyframeTicks[r->keyframes] = v;
+        r->keyframeOffsets[r->keyframes++] = offset;
+    }
+    r->complete = false;
+    return r->keyframes > 0;
+}
+
+bool openReplay(replayReader* r, const char* path) {
+    r->file = fopen(path, "rb");
+    if (!r->file) {
+        perror(path);
+        return false;
+    }
+    r->keyframeTicks = NULL;
+    r->keyframeOffsets = NULL;
+    r->keyframes = 0;
+    char magic[4];
+    uint64_t interval;
+    bool ok = fread(magic, 1, 4, r->file) == 4 && memcmp(magic, REPLAY_MAGIC, 4) == 0
+            && getc(r->file) == REPLAY_VERSION && getFixed(r->file, &r->seed, 8) && getVarint(r->file, &interval);
+    long bodyStart = ftell(r->file);
+    if (!ok || (!readIndex(r, bodyStart) && !scanIndex(r, bodyStart))) {
+        fprintf(stderr, "%s: not a replay file\n", path);
+        closeReplay(r);
+        return false;
+    }
+    matchState m;
+    return seekReplay(r, 0, &m);
+}
+
+bool seekReplay(replayReader* r, unsigned long tick, matchState* m) {
+    if (tick > r->ticks) return false;
+    // last keyframe at or before tick
+    int lo = 0, hi = r->keyframes - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (r->keyframeTicks[mid] <= tick) lo = mid;
+        else hi = mid - 1;
+    }
+    uint64_t keyframeTick;
+    fseek(r->file, r->keyframeOffsets[lo], SEEK_SET);
+    if (getc(r->file) != KEYFRAME_TAG || !getVarint(r->file, &keyframeTick) || !getState(r->file, m)) return false;
+    r->tick = keyframeTick;
+    r->remaining = 0;
+    replayTick t;
+    while (r->tick < tick && nextReplayTick(r, &t)) applyReplayTick(m, t);
+    return r->tick == tick;
+}
+
+bool nextReplayTick(replayReader* r, replayTick* t) {
+    while (r->remaining == 0) {
+        if (r->tick >= r->ticks) return false;
+        int c = getc(r->file);
+        uint64_t v;
+        if (c == KEYFRAME_TAG) {
+            matchState skipped;
+            if (!getVarint(r->file, &v) || !getState(r->file, &skipped)) return false;
+        } else if (c >= 0 && c < KEYFRAME_TAG) {
+            if (!getVarint(r->file, &v)) return false;
+            r->symbol = c;
+            r->remaining = v;
+        } else {
+            return false;
+        }
+    }
+    *t = decodeTick(r->symbol);
+    r->remaining--;
+    r->tick++;
+    return true;
+}
+
+void closeReplay(replayReader* r) {
+    fclose(r->file);
+    free(r->keyframeTicks);
+    free(r->keyframeOffsets);
+}
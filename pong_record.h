@@ -0,0 +1,103 @@
+#ifndef PONG_RECORD_H
+#define PONG_RECORD_H
+
+#include <stdio.h>
+
+#include "pong_core.h"
+
+// ticks between full match state keyframes, bounds the work to seek anywhere
+#define REPLAY_KEYFRAME_TICKS (600)
+
+/**
+ * what happened to a match in one recorded tick
+ * idle ticks leave it alone (round delays), otherwise the ball is served first if serve is set
+ * and the match is stepped with the two directions
+*/
+typedef struct {
+    direction left, right;
+    bool serve, idle;
+} replayTick;
+
+/**
+ * a recording being written
+ * runs of identical ticks are kept in memory until the tick changes
+*/
+typedef struct {
+    FILE* file;
+    unsigned long ticks;
+    // run being built, symbol is an encoded replayTick
+    int symbol;
+    unsigned long run;
+    // tick and file offset of every keyframe so far
+    unsigned long* keyframeTicks;
+    long* keyframeOffsets;
+    int keyframes, keyframeCapacity;
+} replayWriter;
+
+/**
+ * a recording being played back
+*/
+typedef struct {
+    FILE* file;
+    // seed of the match's random stream when it was created
+    uint64_t seed;
+    // ticks in the recording
+    unsigned long ticks;
+    unsigned long* keyframeTicks;
+    long* keyframeOffsets;
+    int keyframes;
+    // match state after the last tick, false if the recording was cut short
+    bool complete;
+    matchState final;
+    // next tick to be read and what is left of the current run
+    unsigned long tick;
+    int symbol;
+    unsigned long remaining;
+} replayReader;
+
+/**
+ * applies one recorded tick to a match
+ * returns the event stepMatch returned, NO_EVENT for idle ticks
+*/
+matchEvent applyReplayTick(matchState* m, replayTick t);
+
+/**
+ * starts a recording of a match currently in the state start, seed is only stored for reference
+ * returns false if the file can't be created
+*/
+bool createReplay(replayWriter* w, const char* path, uint64_t seed, const matchState* start);
+
+/**
+ * appends a tick, before is the match as it was before the tick (written as a keyframe when one is due)
+*/
+void recordReplayTick(replayWriter* w, const matchState* before, replayTick t);
+
+/**
+ * writes the last run, the final match state and the keyframe index, then closes the file
+ * returns false if any write failed
+*/
+bool finishReplay(replayWriter* w, const matchState* final);
+
+/**
+ * opens a recording positioned at its first tick
+ * a recording whose writer never finished (crash, quit mid game) is recovered up to its last complete run
+ * returns false if the file is missing or not a recording
+*/
+bool openReplay(replayReader* r, const char* path);
+
+/**
+ * moves playback to before tick, m receives the match state at that point
+ * restores the nearest keyframe at or before tick and replays at most REPLAY_KEYFRAME_TICKS ticks from there
+ * returns false if tick is past the end
+*/
+bool seekReplay(replayReader* r, unsigned long tick, matchState* m);
+
+/**
+ * reads the next tick
+ * returns false at the end of the recording
+*/
+bool nextReplayTick(replayReader* r, replayTick* t);
+
+void closeReplay(replayReader* r);
+
+#endif
@@ -0,0 +1,127 @@
+#include "pong_render.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "pong_core.h"
+#include "pong_scene.h"
+
+// first allocation, in vertices, doubled as needed
+#define INITIAL_BATCH_CAPACITY (256)
+
+void initVertexBatch(vertexBatch* b, GLenum usage) {
+    b->vertices = NULL;
+    b->count = b->capacity = 0;
+    b->r = b->g = b->b = 1;
+    b->usage = usage;
+    b->buffer = 0;
+    b->dirty = true;
+}
+
+void clearVertexBatch(vertexBatch* b) {
+    b->count = 0;
+    b->dirty = true;
+}
+
+void setVertexColor(vertexBatch* b, float r, float g, float bl) {
+    b->r = r;
+    b->g = g;
+    b->b = bl;
+}
+
+void pushVertex(vertexBatch* b, float x, float y) {
+    if (b->count == b->capacity) {
+        int capacity = b->capacity ? 2 * b->capacity : INITIAL_BATCH_CAPACITY;
+        vertex* vertices = realloc(b->vertices, capacity * sizeof(vertex));
+        if (!vertices) {
+            fprintf(stderr, "out of memory for vertices\n");
+            exit(1);
+        }
+        b->vertices = vertices;
+        b->capacity = capacity;
+    }
+    b->vertices[b->count++] = (vertex) {x, y, b->r, b->g, b->b};
+    b->dirty = true;
+}
+
+void pushRect(vertexBatch* b, float x1, float y1, float x2, float y2) {
+    pushVertex(b, x1, y1);
+    pushVertex(b, x2, y1);
+    pushVertex(b, x2, y2);
+    pushVertex(b, x1, y2);
+}
+
+void drawVertexBatch(vertexBatch* b) {
+    if (b->buffer == 0) glGenBuffers(1, &b->buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, b->buffer);
+    if (b->dirty) {
+        // a fresh store each time lets the driver hand out new memory instead of waiting on the last draw
+        glBufferData(GL_ARRAY_BUFFER, b->count * sizeof(vertex), b->vertices, b->usage);
+        b->dirty = false;
+    }
+    if (b->count > 0) {
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glEnableClientState(GL_COLOR_ARRAY);
+        glVertexPointer(2, GL_FLOAT, sizeof(vertex), (const void*) offsetof(vertex, x));
+        glColorPointer(3, GL_FLOAT, sizeof(vertex), (const void*) offsetof(vertex, r));
+        glDrawArrays(GL_QUADS, 0, b->count);
+        glDisableClientState(GL_COLOR_ARRAY);
+        glDisableClientState(GL_VERTEX_ARRAY);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void pushText(vertexBatch* b, float x, float y, float width, float height, float spacing, const char* text) {
+    for (; *text; text++, x += width + spacing) {
+        const glyphRect* blocks;
+        int n = glyphBlocks(*text, &blocks);
+        for (int i = 0; i < n; i++) {
+            const glyphRect* r = &blocks[i];
+            pushRect(b, x + r->x1 * width, y + r->y1 * height, x + r->x2 * width, y + r->y2 * height);
+        }
+    }
+}
+
+void pushCenterLine(vertexBatch* b) {
+    setVertexColor(b, GAME_ENVIRONMENT_SHADE, GAME_ENVIRONMENT_SHADE, GAME_ENVIRONMENT_SHADE);
+    float x = (WINDOW_WIDTHF / 2) - DASH_OFFSET;
+    for (float y = 0; y < WINDOW_HEIGHTF; y += 2 * DASH_HEIGHT) {
+        pushRect(b, x, y, x + DASH_WIDTH, y + DASH_HEIGHT);
+    }
+}
+
+/**
+ * appends a score of any number of digits with y giving the bottom of the digits
+ * the score ends at x if alignRight is set and starts at x otherwise
+*/
+static void pushScore(vertexBatch* b, float x, float y, unsigned int score, bool alignRight) {
+    char digits[16];
+    snprintf(digits, sizeof(digits), "%u", score);
+    if (alignRight) x -= textWidth(digits, DIGIT_WIDTH, DIGIT_SPACING);
+    pushText(b, x, y, DIGIT_WIDTH, DIGIT_HEIGHT, DIGIT_SPACING, digits);
+}
+
+void pushGamePieces(vertexBatch* b, float leftPaddleY, float rightPaddleY, float ballX, float ballY,
+        unsigned int leftScore, unsigned int rightScore) {
+    // paddles
+    setVertexColor(b, PADDLE_SHADE, PADDLE_SHADE, PADDLE_SHADE);
+    pushRect(b, LEFT_PADDLE_X - PADDLE_WIDTH, leftPaddleY, LEFT_PADDLE_X, leftPaddleY + PADDLE_HEIGHT);
+    pushRect(b, RIGHT_PADDLE_X, rightPaddleY, RIGHT_PADDLE_X + PADDLE_WIDTH, rightPaddleY + PADDLE_HEIGHT);
+    // scores (left, right)
+    setVertexColor(b, GAME_ENVIRONMENT_SHADE, GAME_ENVIRONMENT_SHADE, GAME_ENVIRONMENT_SHADE);
+    pushScore(b, (WINDOW_WIDTHF / 2) - DIGIT_OFFSET, WINDOW_HEIGHTF - DIGIT_HEIGHT - DIGIT_OFFSET, leftScore, true);
+    pushScore(b, (WINDOW_WIDTHF / 2) + DIGIT_OFFSET, WINDOW_HEIGHTF - DIGIT_HEIGHT - DIGIT_OFFSET, rightScore, false);
+    // ball
+    setVertexColor(b, BALL_SHADE, BALL_SHADE, BALL_SHADE);
+    pushRect(b, ballX, ballY, ballX + BALL_DIM, ballY + BALL_DIM);
+}
+
+void setWindowProjection(float width, float height) {
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(0, width, 0, height, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+}
@@ -0,0 +1,97 @@
+#ifndef PONG_RENDER_H
+#define PONG_RENDER_H
+
+#ifdef __APPLE_CC__
+#include <GLUT/gl.h>
+#else
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#endif
+
+#include <stdbool.h>
+
+#include "pong_font.h"
+
+/**
+ * one colored corner of a quad, in window coordinates
+*/
+typedef struct {
+    float x, y;
+    float r, g, b;
+} vertex;
+
+/**
+ * list of colored quads drawn with a single draw call from a vertex buffer object
+ * static batches are built once and uploaded on their first draw, stream batches are cleared
+ * and refilled every frame and re-uploaded on each draw
+*/
+typedef struct {
+    vertex* vertices;
+    int count, capacity;
+    // color given to vertices pushed from now on
+    float r, g, b;
+    // GL_STATIC_DRAW or GL_STREAM_DRAW
+    GLenum usage;
+    // 0 until the first draw
+    GLuint buffer;
+    // vertices changed since the last upload
+    bool dirty;
+} vertexBatch;
+
+/**
+ * sets up an empty batch, usage is GL_STATIC_DRAW or GL_STREAM_DRAW
+*/
+void initVertexBatch(vertexBatch* b, GLenum usage);
+
+/**
+ * drops every vertex, the allocation is kept for the next frame
+*/
+void clearVertexBatch(vertexBatch* b);
+
+/**
+ * sets the color for following vertices
+*/
+void setVertexColor(vertexBatch* b, float r, float g, float bl);
+
+/**
+ * appends one corner, every four corners make a quad
+*/
+void pushVertex(vertexBatch* b, float x, float y);
+
+/**
+ * appends an axis aligned rectangle between two opposite corners, like glRectf
+*/
+void pushRect(vertexBatch* b, float x1, float y1, float x2, float y2);
+
+/**
+ * uploads the batch if it changed and draws all of its quads in one call
+ * the projection must map window coordinates, see setWindowProjection
+*/
+void drawVertexBatch(vertexBatch* b);
+
+/**
+ * appends text in the block font as one quad per solid block of each glyph
+ * (x, y) is the bottom left corner, every character gets a width by height cell with spacing between cells
+ * letters are drawn in capitals whatever their case, characters without a glyph are left blank
+*/
+void pushText(vertexBatch* b, float x, float y, float width, float height, float spacing, const char* text);
+
+/**
+ * appends the dashed centerline of the game screen, the part of it that never moves
+*/
+void pushCenterLine(vertexBatch* b);
+
+/**
+ * appends the moving pieces of the game screen as display draws them: paddles, scores and ball
+ * the scores grow away from the centerline; the batch's color is left at the ball's
+*/
+void pushGamePieces(vertexBatch* b, float leftPaddleY, float rightPaddleY, float ballX, float ballY,
+        unsigned int leftScore, unsigned int rightScore);
+
+/**
+ * maps window coordinates (0 to width, 0 to height) onto the viewport
+*/
+void setWindowProjection(float width, float height);
+
+#endif
@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pong_core.h"
+#include "pong_raster.h"
+#include "pong_record.h"
+
+/**
+ * seconds on the monotonic clock
+*/
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * writes the game screen at the match's state as a binary PGM image
+ * returns false if the image can't be drawn or written
+*/
+bool writeThumbnail(const char* path, const matchState* m, int width, int height) {
+    sceneRenderer r;
+    if (!initSceneRenderer(&r, width, height)) return false;
+    uint8_t* pixels = malloc((size_t) width * height);
+    FILE* f = fopen(path, "wb");
+    bool written = false;
+    if (pixels && f) {
+        drawMatchFrame(&r, m, pixels);
+        fprintf(f, "P5\n%d %d\n255\n", width, height);
+        written = fwrite(pixels, 1, (size_t) width * height, f) == (size_t) width * height;
+    }
+    if (f && fclose(f) != 0) written = false;
+    if (!written) perror(path);
+    free(pixels);
+    freeSceneRenderer(&r);
+    return written;
+}
+
+/**
+ * headless replay player, plays a recording at full speed and checks it ends where the recording did
+ * usage: pong-replay [-s tick] [-n ticks] [-i image] [-g widthxheight] file
+ * -s seeks to the tick through the keyframe index before playing
+ * -n stops after that many ticks
+ * -i draws the screen where playback stopped into a grayscale PGM image, without a GPU
+ * -g sets the image size, 160x120 by default
+*/
+int main(int argc, char** argv) {
+    unsigned long start = 0, limit = ~0ul;
+    const char* imagePath = NULL;
+    int imageWidth = 160, imageHeight = 120;
+    int opt;
+    while ((opt = getopt(argc, argv, "s:n:i:g:")) != -1) {
+        if (opt == 's') {
+            start = strtoul(optarg, NULL, 10);
+        } else if (opt == 'n') {
+            limit = strtoul(optarg, NULL, 10);
+        } else if (opt == 'i') {
+            imagePath = optarg;
+        } else if (opt == 'g') {
+            if (sscanf(optarg, "%dx%d", &imageWidth, &imageHeight) != 2) imageWidth = 0;
+        } else {
+            optind = argc + 1;
+        }
+    }
+    if (argc - optind != 1 || imageWidth < 1 || imageHeight < 1) {
+        fprintf(stderr, "usage: %s [-s tick] [-n ticks] [-i image] [-g widthxheight] file\n", argv[0]);
+        return 1;
+    }
+
+    replayReader r;
+    if (!openReplay(&r, argv[optind])) return 1;
+    printf("seed %llu, %lu ticks, %d keyframes%s\n", (unsigned long long) r.seed, r.ticks, r.keyframes,
+            r.complete ? "" : " (unfinished recording, index rebuilt)");
+
+    matchState m;
+    double seekStart = now();
+    if (!seekReplay(&r, start, &m)) {
+        fprintf(stderr, "tick %lu is past the end\n", start);
+        return 1;
+    }
+    printf("seek to tick %lu in %.1f us\n", start, (now() - seekStart) * 1e6);
+
+    unsigned long ticks = 0;
+    replayTick t;
+    double playStart = now();
+    while (ticks < limit && nextReplayTick(&r, &t)) {
+        applyReplayTick(&m, t);
+        ticks++;
+    }
+    double elapsed = now() - playStart;
+    printf("played %lu ticks in %.3f s, %.0f ticks/sec\n", ticks, elapsed, ticks / elapsed);
+    printf("score %d-%d at tick %lu\n", m.leftScore, m.rightScore, r.tick);
+
+    int status = 0;
+    if (imagePath) {
+        if (writeThumbnail(imagePath, &m, imageWidth, imageHeight)) {
+            printf("%dx%d thumbnail written to %s\n", imageWidth, imageHeight, imagePath);
+        } else {
+            status = 1;
+        }
+    }
+    if (r.complete && r.tick == r.ticks) {
+        bool same = sameMatch(&m, &r.final);
+        printf("final state %s the recording\n", same ? "matches" : "differs from");
+        status |= !same;
+    }
+    closeReplay(&r);
+    return status;
+}
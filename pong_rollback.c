@@ -0,0 +1,74 @@
+#include "pong_rollback.h"
+
+bool beginTick(tickState* s, bool* serve) {
+    *serve = false;
+    if (s->resumeDelay > 0) {
+        s->resumeDelay--;
+        return false;
+    }
+    if (s->serveDelay > 0 && --s->serveDelay == 0) {
+        serveBall(&s->match);
+        *serve = true;
+    }
+    return true;
+}
+
+matchEvent endTick(tickState* s, tickInput in) {
+    matchEvent event = stepMatch(&s->match, in.left, in.right);
+    if (event == LEFT_POINT || event == RIGHT_POINT) s->serveDelay = SCORE_DELAY_TICKS;
+    return event;
+}
+
+void initRollback(rollbackRing* r, unsigned long tick) {
+    r->oldest = r->present = tick;
+}
+
+void saveTick(rollbackRing* r, const tickState* s, tickInput in) {
+    unsigned long slot = r->present % ROLLBACK_TICKS;
+    r->states[slot] = *s;
+    r->inputs[slot] = in;
+    r->present++;
+    if (r->present - r->oldest > ROLLBACK_TICKS) r->oldest++;
+}
+
+bool holdsTick(const rollbackRing* r, unsigned long tick) {
+    return tick >= r->oldest && tick < r->present;
+}
+
+tickInput savedInput(const rollbackRing* r, unsigned long tick) {
+    return r->inputs[tick % ROLLBACK_TICKS];
+}
+
+bool correctInput(rollbackRing* r, unsigned long tick, tickInput in) {
+    tickInput* saved = &r->inputs[tick % ROLLBACK_TICKS];
+    bool changed = saved->left != in.left || saved->right != in.right;
+    *saved = in;
+    return changed;
+}
+
+int rollbackTo(rollbackRing* r, unsigned long tick, paddleController left, paddleController right, tickState* s, matchEvent* won) {
+    *won = NO_EVENT;
+    if (!holdsTick(r, tick)) return -1;
+    *s = r->states[tick % ROLLBACK_TICKS];
+    unsigned long t = tick;
+    while (t < r->present) {
+        unsigned long slot = t % ROLLBACK_TICKS;
+        r->states[slot] = *s;
+        tickInput* in = &r->inputs[slot];
+        matchEvent event = NO_EVENT;
+        bool serve;
+        if (beginTick(s, &serve)) {
+            // computers fill the match's prediction cache as they decide, so they run even when nothing changed
+            if (left) in->left = left(&s->match);
+            if (right) in->right = right(&s->match);
+            event = endTick(s, *in);
+        }
+        t++;
+        if (event == LEFT_WIN || event == RIGHT_WIN) {
+            *won = event;
+            r->present = t;
+            break;
+        }
+    }
+    return t - tick;
+}
@@ -0,0 +1,88 @@
+#ifndef PONG_ROLLBACK_H
+#define PONG_ROLLBACK_H
+
+#include "pong_core.h"
+
+// ticks of history kept, a rollback can reach this far back
+// must be a power of two
+#define ROLLBACK_TICKS (128)
+
+/**
+ * everything a game tick reads besides its input: the match and the round timers around it
+ * plain data, may be freely copied
+*/
+typedef struct {
+    matchState match;
+    // ticks until the next serve (0 if none is pending) and ticks left frozen after leaving a menu
+    int serveDelay, resumeDelay;
+} tickState;
+
+/**
+ * directions both paddles were given for a tick
+*/
+typedef struct {
+    direction left, right;
+} tickInput;
+
+/**
+ * counts down the round timers at the start of a tick, serving the ball when the serve delay runs out
+ * serve is set if the ball was served
+ * returns false if the tick is idle (frozen after a menu) and the match must not be stepped
+*/
+bool beginTick(tickState* s, bool* serve);
+
+/**
+ * steps the match with the tick's input, a point starts the serve delay
+*/
+matchEvent endTick(tickState* s, tickInput in);
+
+/**
+ * the last ROLLBACK_TICKS ticks, each as the state it started from and the input it was played with
+ * tick t lives in slot t % ROLLBACK_TICKS, so saving a tick is a single copy with no allocation
+*/
+typedef struct {
+    tickState states[ROLLBACK_TICKS];
+    tickInput inputs[ROLLBACK_TICKS];
+    // oldest tick held and the tick about to be played
+    unsigned long oldest, present;
+} rollbackRing;
+
+/**
+ * empties the history, the next tick saved is tick
+*/
+void initRollback(rollbackRing* r, unsigned long tick);
+
+/**
+ * saves the present tick, s is the state it started from and in the input it was played with
+ * drops the oldest tick once the ring is full
+*/
+void saveTick(rollbackRing* r, const tickState* s, tickInput in);
+
+/**
+ * true if tick is still held and can be rolled back to
+*/
+bool holdsTick(const rollbackRing* r, unsigned long tick);
+
+/**
+ * input a held tick was played with
+*/
+tickInput savedInput(const rollbackRing* r, unsigned long tick);
+
+/**
+ * replaces the input of a held tick, nothing is resimulated until rollbackTo
+ * returns true if the input changed
+*/
+bool correctInput(rollbackRing* r, unsigned long tick, tickInput in);
+
+/**
+ * restores the state tick started from and resimulates every tick up to the present, refreshing the saved states
+ * along the way, s receives the new present state
+ * sides with a controller (computers) decide again from the resimulated state and their new decisions are saved,
+ * sides passed NULL (players) replay their saved inputs
+ * a win ends resimulation there: the ticks after it are dropped, present moves back to the tick after the win
+ * and won receives the win event (NO_EVENT if there was none)
+ * returns the number of ticks resimulated, -1 if tick is no longer held
+*/
+int rollbackTo(rollbackRing* r, unsigned long tick, paddleController left, paddleController right, tickState* s, matchEvent* won);
+
+#endif
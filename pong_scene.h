@@ -0,0 +1,29 @@
+#ifndef PONG_SCENE_H
+#define PONG_SCENE_H
+
+#include "pong_core.h"
+
+/*
+ * layout of the game screen, shared by display() and the software rasterizer so both draw the same scene
+ * in window coordinates, y up
+*/
+
+// brightness of the pieces on the black background, every piece is gray
+#define PADDLE_SHADE (1.)
+#define BALL_SHADE (1.)
+// centerline and scores
+#define GAME_ENVIRONMENT_SHADE (.8)
+
+// score counter drawing constants
+#define DIGIT_HEIGHT (WINDOW_HEIGHTF / 9.)
+#define DIGIT_STROKE_WEIGHT (WINDOW_WIDTHF / 100.)
+#define DIGIT_WIDTH ((DIGIT_HEIGHT + DIGIT_STROKE_WEIGHT) / 2.)
+#define DIGIT_OFFSET (DIGIT_WIDTH / 2.)
+#define DIGIT_SPACING (DIGIT_STROKE_WEIGHT)
+
+// centerline drawing constants
+#define DASH_HEIGHT (WINDOW_HEIGHTF / 49.)
+#define DASH_WIDTH (WINDOW_WIDTHF / 200.)
+#define DASH_OFFSET (DASH_WIDTH / 2.)
+
+#endif
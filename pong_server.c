@@ -0,0 +1,861 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+
+#include "pong_core.h"
+#include "pong_batch.h"
+#include "pong_stats.h"
+#include "pong_stream.h"
+#include "pong_wire.h"
+
+// tick slots in every 1 / FRAME_RATE, matches are spread across them so each wakeup steps an even share
+#define PHASES (4)
+#define PHASE_SEC (1. / (FRAME_RATE * PHASES))
+// matches each worker can hold unless -m says otherwise
+#define DEFAULT_MATCHES (4096)
+// clients each worker tracks, must be a power of two
+#define CLIENT_SLOTS (16384)
+// a match nobody has sent input to for this long is dropped, as is a spectator that stops acknowledging keyframes, seconds
+#define IDLE_TIMEOUT (5.)
+// datagrams moved per recvmmsg or sendmmsg call
+#define MESSAGE_BATCH (64)
+// outgoing datagrams buffered during a phase before they are flushed
+#define SEND_QUEUE (1024)
+// watch and ack messages other workers can pass on to a worker between two of its phases
+#define HANDOFF_QUEUE (256)
+// phase ticks kept for the lateness percentiles of each report
+#define TICK_WINDOW (16384)
+// a worker this far behind its schedule drops the missed ticks instead of racing through them, seconds
+#define MAX_BEHIND_SEC (.25)
+#define DEFAULT_REPORT_SEC (5.)
+#define SOCKET_BUFFER (4 << 20)
+
+/**
+ * seconds on the monotonic clock
+*/
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+enum {EMPTY_SLOT, USED_SLOT, DELETED_SLOT};
+
+/**
+ * an address holding seats or spectating, its states and frames for a phase are packed into shared datagrams
+*/
+typedef struct {
+    struct sockaddr_in address;
+    int slot;
+    // seats held plus matches spectated, the client is forgotten when it reaches 0
+    int uses;
+    // datagrams in the send queue being filled for this client, -1 if none
+    int statesPacket, framesPacket;
+} client;
+
+typedef struct {
+    int client;
+    // newest keyframe the spectator acknowledged, -1 for none
+    int acked;
+    double lastAck;
+} spectator;
+
+/**
+ * a match's spectators, all fed from one stream encoder
+*/
+typedef struct {
+    streamSender stream;
+    spectator* spectators;
+    int count, capacity;
+} watchers;
+
+/**
+ * the matches stepped together in one phase, lane arrays beside the batch hold what the server adds
+*/
+typedef struct {
+    matchBatch batch;
+    bool* active;
+    // client of each side, -1 while the seat is empty
+    int (*owner)[2];
+    int* serveDelay;
+    uint32_t* ticks;
+    double* lastInput;
+    // NULL until someone spectates the match
+    watchers** watching;
+    int* freeLanes;
+    int freeCount;
+} phaseGroup;
+
+typedef struct {
+    unsigned char data[WIRE_MAX_PACKET];
+    int size, count;
+    int client;
+} outPacket;
+
+/**
+ * the entries of a watch or ack message naming another worker's matches, passed on to that worker
+*/
+typedef struct {
+    struct sockaddr_in from;
+    wireMessage type;
+    int count;
+    unsigned char entries[WIRE_MAX_PACKET];
+} handoff;
+
+/**
+ * one thread on one core with its own socket on the shared port, the kernel sends each client address
+ * to the same worker every time so a player's matches never cross threads
+ * spectators can watch any match, whichever worker their address lands on hands their messages for other
+ * workers' matches to the worker hosting them, which sends the frames from its own socket on the same port
+*/
+typedef struct {
+    int index, socket, epoll, timer;
+    pthread_t thread;
+    // lanes per phase, match ids are the worker index above phase * lanes + lane
+    int lanes;
+    phaseGroup phases[PHASES];
+    client clients[CLIENT_SLOTS];
+    // lane index (phase * lanes + lane) of the match with only its left seat taken, -1 if none
+    long waiting;
+    uint64_t matchSeed;
+    outPacket* out;
+    int outCount;
+    double nextDue;
+    int nextPhase;
+    // handoffs from other workers, taken in before each phase
+    pthread_mutex_t inboxLock;
+    handoff* inbox;
+    int inboxCount;
+
+    // counters and the tick window, read by the report under lock
+    pthread_mutex_t lock;
+    double lateness[TICK_WINDOW], completion[TICK_WINDOW];
+    unsigned long phaseTicks, windowTicks;
+    unsigned long matches, statesSent, packetsSent, packetsReceived, sendFailures;
+    unsigned long spectators, framesSent, frameBytes, encodings, handoffsDropped;
+    unsigned long finished, abandoned, skippedTicks;
+} worker;
+
+atomic_bool stopping;
+
+// settings
+unsigned short port = WIRE_PORT;
+int lanesPerPhase;
+
+// every worker, for passing spectators' messages to the one hosting their match
+worker* workers;
+int workerCount;
+
+void stop(int signal) {
+    (void) signal;
+    atomic_store(&stopping, true);
+}
+
+// clients
+
+static unsigned int addressHash(const struct sockaddr_in* a) {
+    uint64_t key = (uint64_t) a->sin_addr.s_addr << 16 | a->sin_port;
+    return (key * 0x9e3779b97f4a7c15ull) >> 40;
+}
+
+static bool sameAddress(const struct sockaddr_in* a, const struct sockaddr_in* b) {
+    return a->sin_addr.s_addr == b->sin_addr.s_addr && a->sin_port == b->sin_port;
+}
+
+/**
+ * slot of a client address, added if create is set
+ * returns -1 if it isn't known (or the table is full)
+*/
+int findClient(worker* w, const struct sockaddr_in* address, bool create) {
+    int free = -1;
+    unsigned int h = addressHash(address);
+    for (int i = 0; i < CLIENT_SLOTS; i++) {
+        int s = (h + i) & (CLIENT_SLOTS - 1);
+        client* c = &w->clients[s];
+        if (c->slot == USED_SLOT && sameAddress(&c->address, address)) return s;
+        if (c->slot != USED_SLOT && free < 0) free = s;
+        if (c->slot == EMPTY_SLOT) break;
+    }
+    if (!create || free < 0) return -1;
+    w->clients[free] = (client) {*address, USED_SLOT, 0, -1, -1};
+    return free;
+}
+
+/**
+ * gives up a seat or spectated match, forgetting the client once it has none
+*/
+void releaseUse(worker* w, int c) {
+    if (--w->clients[c].uses == 0) w->clients[c].slot = DELETED_SLOT;
+}
+
+// matches
+
+uint32_t matchId(const worker* w, int p, int lane) {
+    return (uint32_t) w->index << WIRE_WORKER_SHIFT | (uint32_t) (p * w->lanes + lane);
+}
+
+/**
+ * phase and lane of a match this worker hosts, returns false if the id isn't one
+*/
+bool findMatch(const worker* w, uint32_t id, int* p, int* lane) {
+    if (id >> WIRE_WORKER_SHIFT != (uint32_t) w->index) return false;
+    uint32_t local = id & ((1u << WIRE_WORKER_SHIFT) - 1);
+    *p = local / w->lanes;
+    *lane = local % w->lanes;
+    return *p < PHASES && w->phases[*p].active[*lane];
+}
+
+/**
+ * starts a match in the phase with the most room, the client takes its left seat
+ * returns its lane index, -1 if the worker is full
+*/
+long openMatch(worker* w, int c) {
+    int p = 0;
+    for (int i = 1; i < PHASES; i++) {
+        if (w->phases[i].freeCount > w->phases[p].freeCount) p = i;
+    }
+    phaseGroup* g = &w->phases[p];
+    if (g->freeCount == 0) return -1;
+    int lane = g->freeLanes[--g->freeCount];
+    matchState m;
+    initMatch(&m, w->matchSeed++);
+    storeLane(&g->batch, lane, &m);
+    g->batch.leftInput[lane] = g->batch.rightInput[lane] = STATIC;
+    g->active[lane] = true;
+    g->owner[lane][0] = c;
+    g->owner[lane][1] = -1;
+    // the match starts like one from the game's menu once both seats are taken
+    g->serveDelay[lane] = RESUME_DELAY_TICKS;
+    g->ticks[lane] = 0;
+    g->lastInput[lane] = now();
+    w->matches++;
+    return (long) p * w->lanes + lane;
+}
+
+void closeMatch(worker* w, int p, int lane) {
+    phaseGroup* g = &w->phases[p];
+    for (int side = 0; side < 2; side++) {
+        if (g->owner[lane][side] >= 0) releaseUse(w, g->owner[lane][side]);
+    }
+    watchers* v = g->watching[lane];
+    if (v) {
+        for (int i = 0; i < v->count; i++) releaseUse(w, v->spectators[i].client);
+        w->spectators -= v->count;
+        free(v->spectators);
+        free(v);
+        g->watching[lane] = NULL;
+    }
+    if (w->waiting == (long) p * w->lanes + lane) w->waiting = -1;
+    matchState m;
+    initMatch(&m, 0);
+    storeLane(&g->batch, lane, &m);
+    g->active[lane] = false;
+    g->freeLanes[g->freeCount++] = lane;
+    w->matches--;
+}
+
+/**
+ * hands out count seats, filling the waiting match first, so seats asked for together pair up
+*/
+void join(worker* w, const struct sockaddr_in* from, int count) {
+    int c = findClient(w, from, true);
+    if (c < 0) return;
+    unsigned char packet[WIRE_MAX_PACKET];
+    unsigned char* p = putWireHeader(packet, SEATS_MESSAGE, 0);
+    int inPacket = 0;
+    for (int i = 0; i < count; i++) {
+        wireSeat seat;
+        if (w->waiting >= 0) {
+            int p = w->waiting / w->lanes, lane = w->waiting % w->lanes;
+            seat = (wireSeat) {matchId(w, p, lane), 1};
+            w->phases[p].owner[lane][1] = c;
+            w->waiting = -1;
+        } else {
+            long index = openMatch(w, c);
+            if (index < 0) break;
+            seat = (wireSeat) {matchId(w, index / w->lanes, index % w->lanes), 0};
+            w->waiting = index;
+        }
+        w->clients[c].uses++;
+        p = putWireSeat(p, seat);
+        if (++inPacket == WIRE_ENTRIES(WIRE_SEAT_SIZE) || i == count - 1) {
+            setWireCount(packet, inPacket);
+            sendto(w->socket, packet, p - packet, 0, (const struct sockaddr*) from, sizeof(*from));
+            p = putWireHeader(packet, SEATS_MESSAGE, 0);
+            inPacket = 0;
+        }
+    }
+    if (inPacket > 0) {
+        setWireCount(packet, inPacket);
+        sendto(w->socket, packet, p - packet, 0, (const struct sockaddr*) from, sizeof(*from));
+    }
+    if (w->clients[c].uses == 0) w->clients[c].slot = DELETED_SLOT;
+}
+
+/**
+ * takes the directions of seats the sender holds, they stay in effect until the next ones
+*/
+void applyInputs(worker* w, const struct sockaddr_in* from, const unsigned char* p, int count) {
+    int c = findClient(w, from, false);
+    if (c < 0) return;
+    double t = now();
+    for (int i = 0; i < count; i++) {
+        wireInput in;
+        p = getWireInput(p, &in);
+        int phase, lane;
+        if (!findMatch(w, in.seat.match, &phase, &lane)) continue;
+        phaseGroup* g = &w->phases[phase];
+        if (g->owner[lane][in.seat.side] != c) continue;
+        if (in.seat.side == 0) g->batch.leftInput[lane] = in.input;
+        else g->batch.rightInput[lane] = in.input;
+        g->lastInput[lane] = t;
+    }
+}
+
+/**
+ * adds the sender as a spectator of each match given, its frames start with the next tick
+*/
+void watch(worker* w, const struct sockaddr_in* from, const unsigned char* p, int count) {
+    int c = findClient(w, from, true);
+    if (c < 0) return;
+    for (int i = 0; i < count; i++) {
+        uint32_t id;
+        int phase, lane;
+        p = getWireMatch(p, &id);
+        if (!findMatch(w, id, &phase, &lane)) continue;
+        phaseGroup* g = &w->phases[phase];
+        watchers* v = g->watching[lane];
+        if (!v) {
+            v = g->watching[lane] = calloc(1, sizeof(watchers));
+            if (!v) continue;
+            initStreamSender(&v->stream);
+        }
+        bool watching = false;
+        for (int j = 0; j < v->count && !watching; j++) watching = v->spectators[j].client == c;
+        if (watching) continue;
+        if (v->count == v->capacity) {
+            int capacity = max(4, v->capacity * 2);
+            spectator* grown = realloc(v->spectators, capacity * sizeof(spectator));
+            if (!grown) continue;
+            v->spectators = grown;
+            v->capacity = capacity;
+        }
+        v->spectators[v->count++] = (spectator) {c, -1, now()};
+        w->clients[c].uses++;
+        w->spectators++;
+    }
+    if (w->clients[c].uses == 0) w->clients[c].slot = DELETED_SLOT;
+}
+
+/**
+ * notes the keyframes a spectator has, later frames for it are deltas against them
+*/
+void applyAcks(worker* w, const struct sockaddr_in* from, const unsigned char* p, int count) {
+    int c = findClient(w, from, false);
+    if (c < 0) return;
+    double t = now();
+    for (int i = 0; i < count; i++) {
+        wireAck a;
+        int phase, lane;
+        p = getWireAck(p, &a);
+        if (!findMatch(w, a.match, &phase, &lane) || !w->phases[phase].watching[lane]) continue;
+        watchers* v = w->phases[phase].watching[lane];
+        for (int j = 0; j < v->count; j++) {
+            if (v->spectators[j].client == c) {
+                v->spectators[j].acked = a.key;
+                v->spectators[j].lastAck = t;
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * passes the entries of a watch or ack message that name other workers' matches on to those workers, each gets
+ * its own entries as one handoff from the sender's address
+*/
+void handOff(worker* w, const struct sockaddr_in* from, wireMessage type, const unsigned char* p, int count) {
+    int size = type == WATCH_MESSAGE ? WIRE_WATCH_SIZE : WIRE_ACK_SIZE;
+    bool handed[1 << (32 - WIRE_WORKER_SHIFT)] = {false};
+    for (int i = 0; i < count; i++) {
+        // both entries start with the match id
+        uint32_t id;
+        getWireMatch(p + i * size, &id);
+        int target = id >> WIRE_WORKER_SHIFT;
+        if (target == w->index || target >= workerCount || handed[target]) continue;
+        handed[target] = true;
+        worker* t = &workers[target];
+        pthread_mutex_lock(&t->inboxLock);
+        if (t->inboxCount == HANDOFF_QUEUE) {
+            w->handoffsDropped++;
+        } else {
+            handoff* h = &t->inbox[t->inboxCount++];
+            h->from = *from;
+            h->type = type;
+            h->count = 0;
+            for (int j = i; j < count; j++) {
+                getWireMatch(p + j * size, &id);
+                if ((int) (id >> WIRE_WORKER_SHIFT) == target) memcpy(h->entries + h->count++ * size, p + j * size, size);
+            }
+        }
+        pthread_mutex_unlock(&t->inboxLock);
+    }
+}
+
+/**
+ * takes in the watch and ack messages other workers passed on for this worker's matches
+*/
+void receiveHandoffs(worker* w) {
+    pthread_mutex_lock(&w->inboxLock);
+    for (int i = 0; i < w->inboxCount; i++) {
+        handoff* h = &w->inbox[i];
+        if (h->type == WATCH_MESSAGE) watch(w, &h->from, h->entries, h->count);
+        else applyAcks(w, &h->from, h->entries, h->count);
+    }
+    w->inboxCount = 0;
+    pthread_mutex_unlock(&w->inboxLock);
+}
+
+void receiveAll(worker* w) {
+    static __thread unsigned char buffers[MESSAGE_BATCH][WIRE_MAX_PACKET];
+    struct sockaddr_in from[MESSAGE_BATCH];
+    struct iovec vectors[MESSAGE_BATCH];
+    struct mmsghdr messages[MESSAGE_BATCH];
+    for (;;) {
+        for (int i = 0; i < MESSAGE_BATCH; i++) {
+            vectors[i] = (struct iovec) {buffers[i], WIRE_MAX_PACKET};
+            messages[i] = (struct mmsghdr) {.msg_hdr = {.msg_name = &from[i], .msg_namelen = sizeof(from[i]), .msg_iov = &vectors[i], .msg_iovlen = 1}};
+        }
+        int n = recvmmsg(w->socket, messages, MESSAGE_BATCH, MSG_DONTWAIT, NULL);
+        if (n <= 0) return;
+        w->packetsReceived += n;
+        for (int i = 0; i < n; i++) {
+            wireMessage type;
+            int count;
+            if (!getWireHeader(buffers[i], messages[i].msg_len, &type, &count)) continue;
+            if (type == JOIN_MESSAGE) join(w, &from[i], count);
+            else if (type == INPUTS_MESSAGE) applyInputs(w, &from[i], buffers[i] + WIRE_HEADER_SIZE, count);
+            else if (type == WATCH_MESSAGE) watch(w, &from[i], buffers[i] + WIRE_HEADER_SIZE, count);
+            else if (type == ACKS_MESSAGE) applyAcks(w, &from[i], buffers[i] + WIRE_HEADER_SIZE, count);
+            if ((type == WATCH_MESSAGE || type == ACKS_MESSAGE) && workerCount > 1) {
+                handOff(w, &from[i], type, buffers[i] + WIRE_HEADER_SIZE, count);
+            }
+        }
+        if (n < MESSAGE_BATCH) return;
+    }
+}
+
+// sending
+
+/**
+ * sends every queued datagram and empties the queue
+*/
+void flushPackets(worker* w) {
+    struct iovec vectors[MESSAGE_BATCH];
+    struct mmsghdr messages[MESSAGE_BATCH];
+    for (int first = 0; first < w->outCount; first += MESSAGE_BATCH) {
+        int n = min(w->outCount - first, MESSAGE_BATCH);
+        for (int i = 0; i < n; i++) {
+            outPacket* o = &w->out[first + i];
+            setWireCount(o->data, o->count);
+            client* c = &w->clients[o->client];
+            c->statesPacket = c->framesPacket = -1;
+            vectors[i] = (struct iovec) {o->data, o->size};
+            messages[i] = (struct mmsghdr) {.msg_hdr = {.msg_name = &c->address, .msg_namelen = sizeof(c->address), .msg_iov = &vectors[i], .msg_iovlen = 1}};
+        }
+        int sent = sendmmsg(w->socket, messages, n, MSG_DONTWAIT);
+        sent = max(sent, 0);
+        w->packetsSent += sent;
+        w->sendFailures += n - sent;
+    }
+    w->outCount = 0;
+}
+
+/**
+ * room for an entry of size bytes in the client's datagram of a message type for this phase
+*/
+unsigned char* reserveEntry(worker* w, int c, wireMessage type, int size) {
+    client* cl = &w->clients[c];
+    int* packet = type == STATES_MESSAGE ? &cl->statesPacket : &cl->framesPacket;
+    if (*packet < 0 || w->out[*packet].size + size > WIRE_MAX_PACKET) {
+        if (w->outCount == SEND_QUEUE) flushPackets(w);
+        *packet = w->outCount++;
+        outPacket* o = &w->out[*packet];
+        o->size = putWireHeader(o->data, type, 0) - o->data;
+        o->count = 0;
+        o->client = c;
+    }
+    outPacket* o = &w->out[*packet];
+    unsigned char* entry = o->data + o->size;
+    o->size += size;
+    o->count++;
+    return entry;
+}
+
+/**
+ * adds a match's state to the client's datagram for this phase
+*/
+void queueState(worker* w, int c, const wireState* s) {
+    putWireState(reserveEntry(w, c, STATES_MESSAGE, WIRE_STATE_SIZE), s);
+    w->statesSent++;
+}
+
+/**
+ * encodes a match's tick for its spectators, once per keyframe they hold, and queues it for each of them
+*/
+void streamMatch(worker* w, int p, int lane, uint32_t tick, int flags, double t) {
+    phaseGroup* g = &w->phases[p];
+    watchers* v = g->watching[lane];
+    matchState m;
+    loadLane(&g->batch, lane, &m);
+    streamFrame f;
+    quantizeFrame(&f, &m, tick, flags);
+    beginStreamTick(&v->stream, &f);
+    unsigned long encodings = v->stream.encodings;
+    uint32_t id = matchId(w, p, lane);
+    for (int i = 0; i < v->count;) {
+        spectator* s = &v->spectators[i];
+        if (t - s->lastAck > IDLE_TIMEOUT) {
+            releaseUse(w, s->client);
+            *s = v->spectators[--v->count];
+            w->spectators--;
+            continue;
+        }
+        int size;
+        const unsigned char* frame = streamFrameFor(&v->stream, s->acked, &size);
+        putWireFrame(reserveEntry(w, s->client, FRAMES_MESSAGE, WIRE_FRAME_HEADER_SIZE + size), id, frame, size);
+        w->framesSent++;
+        w->frameBytes += size;
+        i++;
+    }
+    w->encodings += v->stream.encodings - encodings;
+}
+
+// scheduling
+
+/**
+ * steps every match in a phase as one batch and sends the results, due is when the tick was scheduled
+*/
+void runPhase(worker* w, int p, double due) {
+    double start = now();
+    phaseGroup* g = &w->phases[p];
+    matchBatch* b = &g->batch;
+    for (int lane = 0; lane < w->lanes; lane++) {
+        if (g->active[lane] && g->owner[lane][1] >= 0 && g->serveDelay[lane] > 0 && --g->serveDelay[lane] == 0) {
+            serveLane(b, lane);
+        }
+    }
+    stepBatch(b);
+    for (int lane = 0; lane < w->lanes; lane++) {
+        if (!g->active[lane]) continue;
+        bool idle = start - g->lastInput[lane] > IDLE_TIMEOUT;
+        if (g->owner[lane][1] < 0) {
+            if (idle) closeMatch(w, p, lane);
+            continue;
+        }
+        matchEvent event = b->events[lane];
+        if (event == LEFT_POINT || event == RIGHT_POINT) g->serveDelay[lane] = SCORE_DELAY_TICKS;
+        bool won = event == LEFT_WIN || event == RIGHT_WIN;
+        wireState s = {
+            matchId(w, p, lane), ++g->ticks[lane],
+            b->ballX[lane], b->ballY[lane], b->ballVelocityX[lane], b->ballVelocityY[lane],
+            b->leftPaddleY[lane], b->rightPaddleY[lane], b->leftScore[lane], b->rightScore[lane],
+            (b->inPlay[lane] ? WIRE_IN_PLAY : 0) | (won || idle ? WIRE_OVER : 0)
+        };
+        queueState(w, g->owner[lane][0], &s);
+        if (g->owner[lane][1] != g->owner[lane][0]) queueState(w, g->owner[lane][1], &s);
+        if (g->watching[lane]) {
+            int flags = (b->inPlay[lane] ? STREAM_IN_PLAY : 0) | (g->serveDelay[lane] > 0 ? STREAM_SERVING : 0)
+                    | (won || idle ? STREAM_OVER : 0);
+            streamMatch(w, p, lane, s.tick, flags, start);
+        }
+        if (won || idle) {
+            if (won) w->finished++;
+            else w->abandoned++;
+            closeMatch(w, p, lane);
+        }
+    }
+    flushPackets(w);
+    double end = now();
+
+    pthread_mutex_lock(&w->lock);
+    unsigned long slot = w->windowTicks++ % TICK_WINDOW;
+    w->lateness[slot] = start - due;
+    w->completion[slot] = end - due;
+    w->phaseTicks++;
+    pthread_mutex_unlock(&w->lock);
+}
+
+/**
+ * runs every phase tick that has come due, in order
+*/
+void runDue(worker* w) {
+    double t = now();
+    if (t - w->nextDue > MAX_BEHIND_SEC) {
+        unsigned long missed = (t - w->nextDue) / PHASE_SEC;
+        w->skippedTicks += missed;
+        w->nextDue += missed * PHASE_SEC;
+        w->nextPhase = (w->nextPhase + missed) % PHASES;
+    }
+    receiveHandoffs(w);
+    while (w->nextDue <= t) {
+        runPhase(w, w->nextPhase, w->nextDue);
+        w->nextDue += PHASE_SEC;
+        w->nextPhase = (w->nextPhase + 1) % PHASES;
+        // take in inputs that arrived while the phase ran before the next one
+        receiveAll(w);
+    }
+}
+
+void* runWorker(void* arg) {
+    worker* w = arg;
+    w->nextDue = now();
+    struct itimerspec period = {
+        .it_interval = {0, (long) (PHASE_SEC * 1e9)},
+        .it_value = {0, (long) (PHASE_SEC * 1e9)}
+    };
+    timerfd_settime(w->timer, 0, &period, NULL);
+    while (!atomic_load(&stopping)) {
+        struct epoll_event events[2];
+        int n = epoll_wait(w->epoll, events, 2, 100);
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == w->socket) {
+                receiveAll(w);
+            } else {
+                uint64_t expirations;
+                if (read(w->timer, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) perror("timerfd");
+                runDue(w);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * sets up a worker's socket on the shared port, its timer and its phases
+*/
+bool initWorker(worker* w, int index) {
+    memset(w, 0, sizeof(*w));
+    w->index = index;
+    w->lanes = lanesPerPhase;
+    w->waiting = -1;
+    w->matchSeed = (uint64_t) time(NULL) << 8 | index;
+    pthread_mutex_init(&w->lock, NULL);
+    pthread_mutex_init(&w->inboxLock, NULL);
+    w->out = malloc(SEND_QUEUE * sizeof(outPacket));
+    w->inbox = malloc(HANDOFF_QUEUE * sizeof(handoff));
+    for (int p = 0; p < PHASES; p++) {
+        phaseGroup* g = &w->phases[p];
+        if (!initBatch(&g->batch, w->lanes, 0)) return false;
+        g->active = calloc(w->lanes, sizeof(bool));
+        g->owner = calloc(w->lanes, sizeof(*g->owner));
+        g->serveDelay = calloc(w->lanes, sizeof(int));
+        g->ticks = calloc(w->lanes, sizeof(uint32_t));
+        g->lastInput = calloc(w->lanes, sizeof(double));
+        g->watching = calloc(w->lanes, sizeof(watchers*));
+        g->freeLanes = malloc(w->lanes * sizeof(int));
+        if (!g->active || !g->owner || !g->serveDelay || !g->ticks || !g->lastInput || !g->watching || !g->freeLanes) {
+            return false;
+        }
+        // handed out from lane 0 up
+        for (int i = 0; i < w->lanes; i++) g->freeLanes[i] = w->lanes - 1 - i;
+        g->freeCount = w->lanes;
+    }
+    if (!w->out || !w->inbox) return false;
+
+    w->socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    int on = 1, buffer = SOCKET_BUFFER;
+    setsockopt(w->socket, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+    setsockopt(w->socket, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    setsockopt(w->socket, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY)};
+    if (w->socket < 0 || bind(w->socket, (const struct sockaddr*) &address, sizeof(address)) != 0) {
+        perror("socket");
+        return false;
+    }
+    w->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    w->epoll = epoll_create1(0);
+    struct epoll_event socketEvent = {.events = EPOLLIN, .data.fd = w->socket};
+    struct epoll_event timerEvent = {.events = EPOLLIN, .data.fd = w->timer};
+    if (w->timer < 0 || w->epoll < 0 || epoll_ctl(w->epoll, EPOLL_CTL_ADD, w->socket, &socketEvent) != 0
+            || epoll_ctl(w->epoll, EPOLL_CTL_ADD, w->timer, &timerEvent) != 0) {
+        perror("epoll");
+        return false;
+    }
+    return true;
+}
+
+// reporting
+
+/**
+ * cpu seconds a worker thread has used
+*/
+double cpuTime(const worker* w) {
+    clockid_t clock;
+    struct timespec ts;
+    if (pthread_getcpuclockid(w->thread, &clock) != 0 || clock_gettime(clock, &ts) != 0) return 0;
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * totals since the previous report
+*/
+typedef struct {
+    double time, cpu;
+    unsigned long phaseTicks, statesSent, packetsSent, packetsReceived, sendFailures, finished, abandoned, skippedTicks;
+    unsigned long framesSent, frameBytes, encodings, handoffsDropped;
+} reportMark;
+
+/**
+ * prints load, lateness percentiles and throughput across workers since the previous report
+*/
+void report(worker* workers, int count, reportMark* last) {
+    static double lateness[TICK_WINDOW * 8], completion[TICK_WINDOW * 8], sorted[TICK_WINDOW * 8];
+    reportMark mark = {.time = now()};
+    unsigned long matches = 0, spectators = 0;
+    int samples = 0;
+    for (int i = 0; i < count; i++) {
+        worker* w = &workers[i];
+        pthread_mutex_lock(&w->lock);
+        int n = min(w->windowTicks, TICK_WINDOW);
+        for (int j = 0; j < n && samples < TICK_WINDOW * 8; j++, samples++) {
+            lateness[samples] = w->lateness[j];
+            completion[samples] = w->completion[j];
+        }
+        w->windowTicks = 0;
+        mark.phaseTicks += w->phaseTicks;
+        pthread_mutex_unlock(&w->lock);
+        // plain counters, a report a tick out of date doesn't matter
+        matches += w->matches;
+        spectators += w->spectators;
+        mark.framesSent += w->framesSent;
+        mark.frameBytes += w->frameBytes;
+        mark.encodings += w->encodings;
+        mark.handoffsDropped += w->handoffsDropped;
+        mark.statesSent += w->statesSent;
+        mark.packetsSent += w->packetsSent;
+        mark.packetsReceived += w->packetsReceived;
+        mark.sendFailures += w->sendFailures;
+        mark.finished += w->finished;
+        mark.abandoned += w->abandoned;
+        mark.skippedTicks += w->skippedTicks;
+        mark.cpu += cpuTime(w);
+    }
+    double elapsed = mark.time - last->time;
+    double busy = (mark.cpu - last->cpu) / elapsed;
+    phaseSummary late = summarizeSamples(lateness, samples, sorted);
+    phaseSummary done = summarizeSamples(completion, samples, sorted);
+    printf("%lu matches on %d workers, %.0f%% of a core busy", matches, count, busy * 100);
+    if (busy > .01) printf(", %.0f matches per core", matches / busy);
+    printf("\n  tick lateness p50 %.3f ms, p99 %.3f ms, max %.3f ms; states out p99 %.3f ms, max %.3f ms after the tick was due\n",
+            late.p50 * 1e3, late.p99 * 1e3, late.max * 1e3, done.p99 * 1e3, done.max * 1e3);
+    printf("  %.0f phase ticks/s, %.0f states/s in %.0f datagrams/s, %.0f received/s; %lu send failures, %lu ticks skipped, "
+            "%lu matches finished, %lu abandoned\n",
+            (mark.phaseTicks - last->phaseTicks) / elapsed, (mark.statesSent - last->statesSent) / elapsed,
+            (mark.packetsSent - last->packetsSent) / elapsed, (mark.packetsReceived - last->packetsReceived) / elapsed,
+            mark.sendFailures - last->sendFailures, mark.skippedTicks - last->skippedTicks,
+            mark.finished - last->finished, mark.abandoned - last->abandoned);
+    unsigned long frames = mark.framesSent - last->framesSent;
+    if (spectators > 0 || frames > 0) {
+        printf("  %lu spectators, %.0f frames/s of %.1f bytes on average, %.0f encodings/s, %lu handoffs dropped\n",
+                spectators, frames / elapsed, frames ? (double) (mark.frameBytes - last->frameBytes) / frames : 0.,
+                (mark.encodings - last->encodings) / elapsed, mark.handoffsDropped - last->handoffsDropped);
+    }
+    fflush(stdout);
+    *last = mark;
+}
+
+/**
+ * authoritative match server: clients take seats with join messages, send their directions and get every tick's state
+ * spectators name matches with watch messages and get each tick as a pong_stream.h frame, encoded once per
+ * keyframe they hold and copied to all of them
+ * usage: pong-server [-p port] [-j workers] [-m matches per worker] [-r report seconds] [-t seconds]
+ * one worker per core by default, each pinned to its core with its own SO_REUSEPORT socket, epoll loop and
+ * tick timer; its matches are split across PHASES staggered slots and each slot is stepped as one SIMD batch
+ * reports load, matches per core and tick lateness every -r seconds, runs until interrupted or for -t seconds
+*/
+int main(int argc, char** argv) {
+    workerCount = sysconf(_SC_NPROCESSORS_ONLN);
+    int matches = DEFAULT_MATCHES;
+    double reportInterval = DEFAULT_REPORT_SEC, duration = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:j:m:r:t:")) != -1) {
+        switch (opt) {
+            case 'p':
+                port = atoi(optarg);
+                break;
+            case 'j':
+                workerCount = atoi(optarg);
+                break;
+            case 'm':
+                matches = atoi(optarg);
+                break;
+            case 'r':
+                reportInterval = atof(optarg);
+                break;
+            case 't':
+                duration = atof(optarg);
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    // worker indices and lane indices have to fit their parts of a match id
+    if (argc != optind || workerCount < 1 || workerCount > 1 << (32 - WIRE_WORKER_SHIFT) || matches < 1
+            || matches > 1 << (WIRE_WORKER_SHIFT - 1) || reportInterval <= 0) {
+        fprintf(stderr, "usage: %s [-p port] [-j workers] [-m matches per worker] [-r report seconds] [-t seconds]\n", argv[0]);
+        return 1;
+    }
+    lanesPerPhase = (matches + PHASES - 1) / PHASES;
+    lanesPerPhase = (lanesPerPhase + BATCH_LANE_ALIGN - 1) / BATCH_LANE_ALIGN * BATCH_LANE_ALIGN;
+
+    workers = calloc(workerCount, sizeof(worker));
+    if (!workers) return 1;
+    for (int i = 0; i < workerCount; i++) {
+        if (!initWorker(&workers[i], i)) {
+            fprintf(stderr, "failed to set up worker %d\n", i);
+            return 1;
+        }
+    }
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    int cores = sysconf(_SC_NPROCESSORS_ONLN);
+    for (int i = 0; i < workerCount; i++) {
+        if (pthread_create(&workers[i].thread, NULL, runWorker, &workers[i]) != 0) {
+            fprintf(stderr, "failed to start worker %d\n", i);
+            return 1;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(i % cores, &set);
+        pthread_setaffinity_np(workers[i].thread, sizeof(set), &set);
+    }
+    printf("listening on port %u, %d workers of %d matches in %d phases\n", port, workerCount, lanesPerPhase * PHASES, PHASES);
+    fflush(stdout);
+
+    double start = now();
+    reportMark last = {.time = start};
+    while (!atomic_load(&stopping)) {
+        double next = last.time + reportInterval;
+        if (duration > 0) next = min(next, start + duration);
+        while (!atomic_load(&stopping) && now() < next) usleep(10000);
+        if (duration > 0 && now() >= start + duration) atomic_store(&stopping, true);
+        report(workers, workerCount, &last);
+    }
+    for (int i = 0; i < workerCount; i++) pthread_join(workers[i].thread, NULL);
+    return 0;
+}
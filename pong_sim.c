@@ -0,0 +1,281 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "pong_core.h"
+#include "pong_batch.h"
+#include "pong_event.h"
+#include "pong_record.h"
+#include "pong_rollback.h"
+
+#define DEFAULT_MATCHES (100)
+
+/**
+ * seconds on the monotonic clock
+*/
+double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * plays one computer vs computer match to completion with no round delays, jumping between events
+ * gives up after MAX_MATCH_TICKS
+ * returns the number of ticks simulated
+*/
+unsigned long playMatchEvents(matchState* m) {
+    unsigned long ticks = 0;
+    serveBall(m);
+    while (ticks < MAX_MATCH_TICKS) {
+        matchEvent e;
+        ticks += advanceComputerMatch(m, MAX_MATCH_TICKS - ticks, &e);
+        if (e == LEFT_WIN || e == RIGHT_WIN) break;
+        if (e != NO_EVENT) serveBall(m);
+    }
+    return ticks;
+}
+
+/**
+ * plays one computer vs computer match to completion with no round delays
+ * gives up after MAX_MATCH_TICKS
+ * every tick is appended to recording unless it is NULL
+ * returns the number of ticks simulated
+*/
+unsigned long playMatch(matchState* m, replayWriter* recording) {
+    unsigned long ticks = 0;
+    bool serve = true;
+    matchState before;
+    while (ticks < MAX_MATCH_TICKS) {
+        if (recording) before = *m;
+        if (serve) serveBall(m);
+        direction left = leftComputerController(m);
+        direction right = rightComputerController(m);
+        ticks++;
+        matchEvent event = stepMatch(m, left, right);
+        if (recording) recordReplayTick(recording, &before, (replayTick) {left, right, serve, false});
+        serve = event == LEFT_POINT || event == RIGHT_POINT;
+        if (event == LEFT_WIN || event == RIGHT_WIN) break;
+    }
+    return ticks;
+}
+
+// history for -k, one match at a time
+rollbackRing history;
+// ticks resimulated by -k and resimulations that didn't reproduce the present
+unsigned long resimulated, mismatches;
+
+/**
+ * plays one computer vs computer match to completion with the game's round delays, saving every tick
+ * and then, when depth > 0, rolling back depth ticks and resimulating to the present before the next one
+ * the resimulated state carries on the match, so results only match a depth 0 run if rollback is exact
+ * gives up after MAX_MATCH_TICKS
+ * returns the number of ticks simulated, not counting resimulation
+*/
+unsigned long playMatchRollback(matchState* m, int depth) {
+    // serve on the first tick, as playMatch does
+    tickState s = {*m, 1, 0};
+    initRollback(&history, 0);
+    unsigned long ticks = 0;
+    while (ticks < MAX_MATCH_TICKS) {
+        tickState before = s;
+        tickInput in = {STATIC, STATIC};
+        matchEvent event = NO_EVENT;
+        bool serve;
+        if (beginTick(&s, &serve)) {
+            in.left = leftComputerController(&s.match);
+            in.right = rightComputerController(&s.match);
+            event = endTick(&s, in);
+        }
+        saveTick(&history, &before, in);
+        ticks++;
+        if (event == LEFT_WIN || event == RIGHT_WIN) break;
+        if (depth > 0 && holdsTick(&history, history.present - depth)) {
+            tickState live = s;
+            matchEvent won;
+            resimulated += rollbackTo(&history, history.present - depth, leftComputerController, rightComputerController, &s, &won);
+            // both sides ran the controllers, so their prediction caches have to agree too
+            const matchState *a = &live.match, *b = &s.match;
+            bool samePredictions = a->leftPredicted == b->leftPredicted && a->rightPredicted == b->rightPredicted
+                    && (!a->leftPredicted || a->leftIntercept == b->leftIntercept)
+                    && (!a->rightPredicted || a->rightIntercept == b->rightIntercept);
+            if (!sameMatch(a, b) || !samePredictions || live.serveDelay != s.serveDelay || live.resumeDelay != s.resumeDelay) mismatches++;
+        }
+    }
+    *m = s.match;
+    return ticks;
+}
+
+/**
+ * plays matches on a batch of lanes, refilling each lane with the next match when one ends
+ * match i is seeded with seed + i as in the scalar path
+ * returns the number of ticks simulated across all lanes
+*/
+unsigned long playBatch(unsigned long matches, int lanes, unsigned int seed, void (*record)(const matchState*)) {
+    if ((unsigned long) lanes > matches) lanes = (int) matches;
+    matchBatch b;
+    if (!initBatch(&b, lanes, seed)) {
+        fprintf(stderr, "failed to allocate %d lanes\n", lanes);
+        exit(1);
+    }
+    bool* retired = calloc(lanes, sizeof(bool));
+    unsigned long* laneTicks = calloc(lanes, sizeof(unsigned long));
+    for (int i = 0; i < lanes; i++) serveLane(&b, i);
+
+    unsigned long ticks = 0, started = lanes, finished = 0;
+    int active = lanes;
+    while (finished < matches) {
+        batchComputerControllers(&b);
+        stepBatch(&b);
+        ticks += active;
+        for (int i = 0; i < lanes; i++) {
+            if (retired[i]) continue;
+            matchEvent e = b.events[i];
+            if (++laneTicks[i] == MAX_MATCH_TICKS && e != LEFT_WIN && e != RIGHT_WIN) e = LEFT_WIN;
+            switch (e) {
+                case LEFT_WIN:
+                case RIGHT_WIN: {
+                    matchState m;
+                    loadLane(&b, i, &m);
+                    record(&m);
+                    finished++;
+                    if (started < matches) {
+                        initMatch(&m, seed + started++);
+                        serveBall(&m);
+                        storeLane(&b, i, &m);
+                        laneTicks[i] = 0;
+                    } else {
+                        retired[i] = true;
+                        active--;
+                    }
+                    break;
+                }
+                case LEFT_POINT:
+                case RIGHT_POINT:
+                    serveLane(&b, i);
+                    break;
+                case NO_EVENT:
+                    break;
+            }
+        }
+    }
+    free(retired);
+    free(laneTicks);
+    freeBatch(&b);
+    return ticks;
+}
+
+// final losing score for each side's wins
+unsigned long leftWins[(int) TARGET_SCORE], rightWins[(int) TARGET_SCORE];
+// matches abandoned at MAX_MATCH_TICKS
+unsigned long unfinished;
+
+/**
+ * adds a finished match to the score distribution
+*/
+void recordResult(const matchState* m) {
+    if (m->leftScore == TARGET_SCORE) leftWins[m->rightScore]++;
+    else if (m->rightScore == TARGET_SCORE) rightWins[m->leftScore]++;
+    else unfinished++;
+}
+
+/**
+ * headless simulator for zero player matches
+ * usage: pong-sim [-b lanes | -e | -r file | -k ticks] [-c] [matches] [seed]
+ * -b runs the matches on the vectorized batch engine with the given number of lanes
+ * -e runs them event to event with advanceComputerMatch
+ * -c uses swept collisions, not available on the batch engine
+ * -r records the first match to a replay file, tick by tick engine only
+ * -k plays with round delays through the rollback ring, rolling back and resimulating that many ticks every tick
+*/
+int main(int argc, char** argv) {
+    unsigned long matches = DEFAULT_MATCHES;
+    unsigned int seed = time(NULL);
+    int lanes = 0;
+    bool eventDriven = false, swept = false;
+    const char* recordPath = NULL;
+    int rollbackDepth = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "b:ecr:k:")) != -1) {
+        switch (opt) {
+            case 'b':
+                lanes = atoi(optarg);
+                break;
+            case 'e':
+                eventDriven = true;
+                break;
+            case 'c':
+                swept = true;
+                break;
+            case 'r':
+                recordPath = optarg;
+                break;
+            case 'k':
+                rollbackDepth = atoi(optarg);
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    bool rollback = rollbackDepth >= 0;
+    if (argc - optind > 2 || argc < optind || (lanes > 0 && (eventDriven || swept)) || (recordPath && (lanes > 0 || eventDriven))
+            || (rollback && (lanes > 0 || eventDriven || recordPath || rollbackDepth > ROLLBACK_TICKS))) {
+        fprintf(stderr, "usage: %s [-b lanes | -e | -r file | -k ticks] [-c] [matches] [seed]\n", argv[0]);
+        fprintf(stderr, "-k takes at most %d ticks\n", ROLLBACK_TICKS);
+        return 1;
+    }
+    if (argc - optind > 0) matches = strtoul(argv[optind], NULL, 10);
+    if (argc - optind > 1) seed = strtoul(argv[optind + 1], NULL, 10);
+
+    unsigned long totalTicks = 0;
+
+    double start = now();
+    if (lanes > 0) {
+        totalTicks = playBatch(matches, lanes, seed, recordResult);
+    } else {
+        for (unsigned long i = 0; i < matches; i++) {
+            matchState m;
+            initMatch(&m, seed + i);
+            m.sweptCollisions = swept;
+            if (recordPath && i == 0) {
+                replayWriter w;
+                if (!createReplay(&w, recordPath, seed, &m)) return 1;
+                totalTicks += playMatch(&m, &w);
+                if (!finishReplay(&w, &m)) {
+                    fprintf(stderr, "failed to write %s\n", recordPath);
+                    return 1;
+                }
+            } else if (rollback) {
+                totalTicks += playMatchRollback(&m, rollbackDepth);
+            } else {
+                totalTicks += eventDriven ? playMatchEvents(&m) : playMatch(&m, NULL);
+            }
+            recordResult(&m);
+        }
+    }
+    double elapsed = now() - start;
+
+    printf("seed %u, %lu matches, %lu ticks in %.3f s\n", seed, matches, totalTicks, elapsed);
+    printf("%.0f ticks/sec, %.1f matches/sec\n", totalTicks / elapsed, matches / elapsed);
+    if (rollbackDepth > 0) {
+        printf("%lu ticks resimulated, %.1f ns per tick, %lu rollbacks differed from the present\n",
+                resimulated, elapsed / (totalTicks + resimulated) * 1e9, mismatches);
+    }
+
+    unsigned long leftTotal = 0, rightTotal = 0;
+    for (int i = 0; i < TARGET_SCORE; i++) {
+        leftTotal += leftWins[i];
+        rightTotal += rightWins[i];
+    }
+    printf("left wins %lu, right wins %lu, unfinished %lu\n", leftTotal, rightTotal, unfinished);
+    printf("final score  count\n");
+    for (int i = 0; i < TARGET_SCORE; i++) {
+        if (leftWins[i]) printf("%5d-%-5d  %lu\n", (int) TARGET_SCORE, i, leftWins[i]);
+    }
+    for (int i = TARGET_SCORE - 1; i >= 0; i--) {
+        if (rightWins[i]) printf("%5d-%-5d  %lu\n", i, (int) TARGET_SCORE, rightWins[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "pong_stats.h"
+
+#include <stdlib.h>
+
+const char* const phaseNames[PHASE_COUNT] = {
+    [CONTROLLER_PHASE] = "controllers",
+    [PHYSICS_PHASE] = "physics",
+    [TICK_LATENESS_PHASE] = "tick_late",
+    [DISPLAY_PHASE] = "display",
+    [SWAP_PHASE] = "swap",
+    [FRAME_PHASE] = "frame"
+};
+
+const char* const legNames[LEG_COUNT] = {
+    [INPUT_TO_TICK] = "input_to_tick",
+    [TICK_TO_PRESENT] = "tick_to_present",
+    [INPUT_TO_PRESENT] = "input_to_present"
+};
+
+void resetStats(frameStats* s) {
+    s->frames = 0;
+}
+
+void recordFrame(frameStats* s, const double* durations) {
+    unsigned long slot = s->frames++ % STATS_WINDOW;
+    for (int p = 0; p < PHASE_COUNT; p++) s->samples[p][slot] = durations[p];
+}
+
+/**
+ * qsort comparator for doubles
+*/
+static int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+phaseSummary summarizeSamples(const double* samples, int n, double* sorted) {
+    phaseSummary summary = {0, 0, 0};
+    if (n == 0) return summary;
+    for (int i = 0; i < n; i++) sorted[i] = samples[i];
+    qsort(sorted, n, sizeof(double), compareDoubles);
+    // nearest rank
+    summary.p50 = sorted[(n - 1) / 2];
+    summary.p99 = sorted[(n * 99 + 99) / 100 - 1];
+    summary.max = sorted[n - 1];
+    return summary;
+}
+
+phaseSummary summarizePhase(const frameStats* s, framePhase phase) {
+    double sorted[STATS_WINDOW];
+    return summarizeSamples(s->samples[phase], s->frames < STATS_WINDOW ? s->frames : STATS_WINDOW, sorted);
+}
+
+void resetLatency(latencyStats* s) {
+    s->inputs = 0;
+}
+
+void recordLatency(latencyStats* s, double inputTime, double tickTime, double presentTime) {
+    unsigned long slot = s->inputs++ % LATENCY_WINDOW;
+    s->samples[INPUT_TO_TICK][slot] = tickTime - inputTime;
+    s->samples[TICK_TO_PRESENT][slot] = presentTime - tickTime;
+    s->samples[INPUT_TO_PRESENT][slot] = presentTime - inputTime;
+}
+
+phaseSummary summarizeLatency(const latencyStats* s, latencyLeg leg) {
+    double sorted[LATENCY_WINDOW];
+    return summarizeSamples(s->samples[leg], s->inputs < LATENCY_WINDOW ? s->inputs : LATENCY_WINDOW, sorted);
+}
@@ -0,0 +1,90 @@
+#ifndef PONG_STATS_H
+#define PONG_STATS_H
+
+// frames kept for the rolling percentiles
+#define STATS_WINDOW (512)
+
+// timed parts of a frame, the first three come from the simulation tick shown in the frame
+typedef enum {
+    CONTROLLER_PHASE, PHYSICS_PHASE, TICK_LATENESS_PHASE, DISPLAY_PHASE, SWAP_PHASE, FRAME_PHASE
+} framePhase;
+
+#define PHASE_COUNT (FRAME_PHASE + 1)
+
+// short names, also used as csv column names
+extern const char* const phaseNames[PHASE_COUNT];
+
+/**
+ * fixed size ring of the last STATS_WINDOW frames' phase durations, in seconds
+*/
+typedef struct {
+    double samples[PHASE_COUNT][STATS_WINDOW];
+    unsigned long frames;
+} frameStats;
+
+/**
+ * rollup of one phase over the window, in seconds
+*/
+typedef struct {
+    double p50, p99, max;
+} phaseSummary;
+
+// keyboard inputs kept for the latency report
+#define LATENCY_WINDOW (4096)
+
+// legs of an input's trip to the screen
+typedef enum {
+    INPUT_TO_TICK, TICK_TO_PRESENT, INPUT_TO_PRESENT
+} latencyLeg;
+
+#define LEG_COUNT (INPUT_TO_PRESENT + 1)
+
+extern const char* const legNames[LEG_COUNT];
+
+/**
+ * fixed size ring of the last LATENCY_WINDOW inputs' latencies, in seconds
+*/
+typedef struct {
+    double samples[LEG_COUNT][LATENCY_WINDOW];
+    unsigned long inputs;
+} latencyStats;
+
+/**
+ * empties the ring
+*/
+void resetStats(frameStats* s);
+
+/**
+ * adds one frame, durations holds PHASE_COUNT values indexed by framePhase
+*/
+void recordFrame(frameStats* s, const double* durations);
+
+/**
+ * percentiles and maximum of a phase over the frames in the window
+ * all zero before the first frame
+*/
+phaseSummary summarizePhase(const frameStats* s, framePhase phase);
+
+/**
+ * percentiles and maximum of any n samples, sorted is scratch space for n values
+*/
+phaseSummary summarizeSamples(const double* samples, int n, double* sorted);
+
+/**
+ * empties the ring
+*/
+void resetLatency(latencyStats* s);
+
+/**
+ * adds one input given when it was received, when the tick that first moved a paddle for it finished
+ * and when the first frame showing that tick was presented
+*/
+void recordLatency(latencyStats* s, double inputTime, double tickTime, double presentTime);
+
+/**
+ * percentiles and maximum of a leg over the inputs in the window
+ * all zero before the first input
+*/
+phaseSummary summarizeLatency(const latencyStats* s, latencyLeg leg);
+
+#endif
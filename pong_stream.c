@@ -0,0 +1,298 @@
+#include "pong_stream.h"
+
+#include <math.h>
+#include <string.h>
+
+/*
+ * frame layout, fields are packed least significant bit first
+ *   full      1, keyframe bit, keyframe id (8), tick (32), ball x (15), ball y (14), ball velocity x and y (12 each),
+ *             left and right paddle y (13 each), left and right score (4 each), flags (3)
+ *   delta     0, keyframe id (8), ticks since the keyframe (8), then for ball x, ball y, ball velocity x and y,
+ *             left and right paddle y a difference (see pong_stream.h), then a bit set if the scores or flags
+ *             changed since the keyframe, followed by them in full if so
+ * velocities are stored offset by half their range, positions offset by STREAM_MARGIN
+*/
+
+#define POSITION_SCALE (8)
+#define VELOCITY_SCALE (64)
+// pixels outside the court a ball can be streamed at
+#define STREAM_MARGIN (256)
+#define BALL_X_BITS (15)
+#define BALL_Y_BITS (14)
+#define VELOCITY_BITS (12)
+#define PADDLE_BITS (13)
+#define SCORE_BITS (4)
+#define FLAG_BITS (3)
+#define KEY_ID_BITS (8)
+#define AGE_BITS (8)
+#define WIDTH_BITS (4)
+#define KEY_IDS (1 << KEY_ID_BITS)
+
+#if STREAM_KEY_HISTORY * STREAM_KEY_INTERVAL >= (1 << AGE_BITS)
+#error "a delta's age must fit in AGE_BITS"
+#endif
+
+// fields coded as differences, in order
+enum {BALL_X, BALL_Y, BALL_VELOCITY_X, BALL_VELOCITY_Y, LEFT_PADDLE_Y, RIGHT_PADDLE_Y, DELTA_FIELDS};
+
+static const int fieldBits[DELTA_FIELDS] = {BALL_X_BITS, BALL_Y_BITS, VELOCITY_BITS, VELOCITY_BITS, PADDLE_BITS, PADDLE_BITS};
+
+// bit packing
+
+typedef struct {
+    unsigned char* p;
+    uint64_t bits;
+    int count;
+} bitWriter;
+
+typedef struct {
+    const unsigned char* p;
+    const unsigned char* end;
+    uint64_t bits;
+    int count;
+    bool overrun;
+} bitReader;
+
+static void putBits(bitWriter* w, uint32_t v, int n) {
+    w->bits |= (uint64_t) v << w->count;
+    w->count += n;
+    while (w->count >= 8) {
+        *w->p++ = w->bits;
+        w->bits >>= 8;
+        w->count -= 8;
+    }
+}
+
+/**
+ * writes out the last partial byte, returns the end of the data
+*/
+static unsigned char* flushBits(bitWriter* w) {
+    if (w->count > 0) *w->p++ = w->bits;
+    return w->p;
+}
+
+static uint32_t getBits(bitReader* r, int n) {
+    while (r->count < n) {
+        if (r->p == r->end) {
+            r->overrun = true;
+            return 0;
+        }
+        r->bits |= (uint64_t) *r->p++ << r->count;
+        r->count += 8;
+    }
+    uint32_t v = r->bits & ((1ull << n) - 1);
+    r->bits >>= n;
+    r->count -= n;
+    return v;
+}
+
+// differences
+
+static void putDifference(bitWriter* w, int32_t d) {
+    if (d == 0) {
+        putBits(w, 0, 1);
+        return;
+    }
+    uint32_t zigzag = d < 0 ? ((uint32_t) -d << 1) - 1 : (uint32_t) d << 1;
+    int width = 32 - __builtin_clz(zigzag);
+    putBits(w, 1, 1);
+    putBits(w, width - 1, WIDTH_BITS);
+    putBits(w, zigzag, width);
+}
+
+static int32_t getDifference(bitReader* r) {
+    if (!getBits(r, 1)) return 0;
+    int width = getBits(r, WIDTH_BITS) + 1;
+    uint32_t zigzag = getBits(r, width);
+    return zigzag & 1 ? -(int32_t) ((zigzag + 1) >> 1) : (int32_t) (zigzag >> 1);
+}
+
+// quantization
+
+static int32_t quantize(double x, double scale, double offset, int bits) {
+    double q = round((x + offset) * scale);
+    return (int32_t) fmin(fmax(q, 0), (1 << bits) - 1);
+}
+
+void quantizeFrame(streamFrame* f, const matchState* m, uint32_t tick, int flags) {
+    f->tick = tick;
+    f->ballX = quantize(m->ballX, POSITION_SCALE, STREAM_MARGIN, BALL_X_BITS);
+    f->ballY = quantize(m->ballY, POSITION_SCALE, STREAM_MARGIN, BALL_Y_BITS);
+    double velocityOffset = (1 << (VELOCITY_BITS - 1)) / (double) VELOCITY_SCALE;
+    f->ballVelocityX = quantize(m->ballVelocityX, VELOCITY_SCALE, velocityOffset, VELOCITY_BITS);
+    f->ballVelocityY = quantize(m->ballVelocityY, VELOCITY_SCALE, velocityOffset, VELOCITY_BITS);
+    f->leftPaddleY = quantize(m->leftPaddleY, POSITION_SCALE, 0, PADDLE_BITS);
+    f->rightPaddleY = quantize(m->rightPaddleY, POSITION_SCALE, 0, PADDLE_BITS);
+    f->leftScore = min(m->leftScore, (1 << SCORE_BITS) - 1);
+    f->rightScore = min(m->rightScore, (1 << SCORE_BITS) - 1);
+    f->flags = flags & ((1 << FLAG_BITS) - 1);
+}
+
+void restoreFrame(matchState* m, const streamFrame* f) {
+    int velocityOffset = 1 << (VELOCITY_BITS - 1);
+    m->ballX = (float) f->ballX / POSITION_SCALE - STREAM_MARGIN;
+    m->ballY = (float) f->ballY / POSITION_SCALE - STREAM_MARGIN;
+    m->ballVelocityX = (float) (f->ballVelocityX - velocityOffset) / VELOCITY_SCALE;
+    m->ballVelocityY = (float) (f->ballVelocityY - velocityOffset) / VELOCITY_SCALE;
+    m->ballSpeed = hypotf(m->ballVelocityX, m->ballVelocityY);
+    m->leftPaddleY = (float) f->leftPaddleY / POSITION_SCALE;
+    m->rightPaddleY = (float) f->rightPaddleY / POSITION_SCALE;
+    m->leftScore = f->leftScore;
+    m->rightScore = f->rightScore;
+    m->inPlay = f->flags & STREAM_IN_PLAY;
+}
+
+static void frameFields(const streamFrame* f, int32_t* fields) {
+    fields[BALL_X] = f->ballX;
+    fields[BALL_Y] = f->ballY;
+    fields[BALL_VELOCITY_X] = f->ballVelocityX;
+    fields[BALL_VELOCITY_Y] = f->ballVelocityY;
+    fields[LEFT_PADDLE_Y] = f->leftPaddleY;
+    fields[RIGHT_PADDLE_Y] = f->rightPaddleY;
+}
+
+static void setFrameFields(streamFrame* f, const int32_t* fields) {
+    f->ballX = fields[BALL_X];
+    f->ballY = fields[BALL_Y];
+    f->ballVelocityX = fields[BALL_VELOCITY_X];
+    f->ballVelocityY = fields[BALL_VELOCITY_Y];
+    f->leftPaddleY = fields[LEFT_PADDLE_Y];
+    f->rightPaddleY = fields[RIGHT_PADDLE_Y];
+}
+
+/**
+ * a keyframe's fields carried age ticks forward, the ball moving in a straight line at the keyframe's velocity
+ * done in integers so both ends get the same prediction
+*/
+static void predictFields(const streamFrame* key, int age, int32_t* fields) {
+    frameFields(key, fields);
+    int32_t velocityOffset = 1 << (VELOCITY_BITS - 1);
+    int32_t ratio = VELOCITY_SCALE / POSITION_SCALE;
+    for (int axis = 0; axis < 2; axis++) {
+        int32_t travel = (fields[BALL_VELOCITY_X + axis] - velocityOffset) * age;
+        // floor division, so the prediction is the same for either sign
+        int32_t moved = travel >= 0 ? travel / ratio : -((-travel + ratio - 1) / ratio);
+        fields[BALL_X + axis] = min(max(fields[BALL_X + axis] + moved, 0), (1 << fieldBits[BALL_X + axis]) - 1);
+    }
+}
+
+// encoding
+
+static int encodeFull(unsigned char* out, const streamFrame* f, bool key, int keyId) {
+    bitWriter w = {out, 0, 0};
+    putBits(&w, 1, 1);
+    putBits(&w, key, 1);
+    putBits(&w, keyId, KEY_ID_BITS);
+    putBits(&w, f->tick, 32);
+    int32_t fields[DELTA_FIELDS];
+    frameFields(f, fields);
+    for (int i = 0; i < DELTA_FIELDS; i++) putBits(&w, fields[i], fieldBits[i]);
+    putBits(&w, f->leftScore, SCORE_BITS);
+    putBits(&w, f->rightScore, SCORE_BITS);
+    putBits(&w, f->flags, FLAG_BITS);
+    return flushBits(&w) - out;
+}
+
+static int encodeDelta(unsigned char* out, const streamFrame* f, const streamFrame* key, int keyId) {
+    bitWriter w = {out, 0, 0};
+    int age = f->tick - key->tick;
+    putBits(&w, 0, 1);
+    putBits(&w, keyId, KEY_ID_BITS);
+    putBits(&w, age, AGE_BITS);
+    int32_t fields[DELTA_FIELDS], predicted[DELTA_FIELDS];
+    frameFields(f, fields);
+    predictFields(key, age, predicted);
+    for (int i = 0; i < DELTA_FIELDS; i++) putDifference(&w, fields[i] - predicted[i]);
+    bool changed = f->leftScore != key->leftScore || f->rightScore != key->rightScore || f->flags != key->flags;
+    putBits(&w, changed, 1);
+    if (changed) {
+        putBits(&w, f->leftScore, SCORE_BITS);
+        putBits(&w, f->rightScore, SCORE_BITS);
+        putBits(&w, f->flags, FLAG_BITS);
+    }
+    return flushBits(&w) - out;
+}
+
+void initStreamSender(streamSender* s) {
+    memset(s, 0, sizeof(*s));
+    s->newestKey = -1;
+}
+
+bool beginStreamTick(streamSender* s, const streamFrame* f) {
+    s->current = *f;
+    const streamFrame* newest = &s->keys[s->newestKey & (STREAM_KEY_HISTORY - 1)];
+    s->currentIsKey = s->keyCount == 0 || f->tick - newest->tick >= STREAM_KEY_INTERVAL;
+    if (s->currentIsKey) {
+        s->newestKey = (s->newestKey + 1) % KEY_IDS;
+        s->keyCount++;
+        s->keys[s->newestKey & (STREAM_KEY_HISTORY - 1)] = *f;
+    }
+    memset(s->encodedSize, 0, sizeof(s->encodedSize));
+    return s->currentIsKey;
+}
+
+const unsigned char* streamFrameFor(streamSender* s, int acked, int* size) {
+    int age = (s->newestKey - acked + KEY_IDS) % KEY_IDS;
+    bool held = acked >= 0 && age < STREAM_KEY_HISTORY && (unsigned long) age < s->keyCount;
+    int slot = s->currentIsKey || !held ? STREAM_KEY_HISTORY : acked & (STREAM_KEY_HISTORY - 1);
+    if (s->encodedSize[slot] == 0) {
+        s->encodedSize[slot] = slot == STREAM_KEY_HISTORY
+                ? encodeFull(s->encoded[slot], &s->current, s->currentIsKey, s->newestKey)
+                : encodeDelta(s->encoded[slot], &s->current, &s->keys[slot], acked);
+        s->encodings++;
+    }
+    *size = s->encodedSize[slot];
+    return s->encoded[slot];
+}
+
+// decoding
+
+void initStreamReceiver(streamReceiver* r) {
+    memset(r, 0, sizeof(*r));
+    for (int i = 0; i < STREAM_KEY_HISTORY; i++) r->keyIds[i] = -1;
+}
+
+bool decodeStreamFrame(streamReceiver* r, const unsigned char* p, int size, streamFrame* f, int* keyId) {
+    bitReader in = {p, p + size, 0, 0, false};
+    *keyId = -1;
+    int32_t fields[DELTA_FIELDS];
+    if (getBits(&in, 1)) {
+        bool key = getBits(&in, 1);
+        int id = getBits(&in, KEY_ID_BITS);
+        f->tick = getBits(&in, 32);
+        for (int i = 0; i < DELTA_FIELDS; i++) fields[i] = getBits(&in, fieldBits[i]);
+        setFrameFields(f, fields);
+        f->leftScore = getBits(&in, SCORE_BITS);
+        f->rightScore = getBits(&in, SCORE_BITS);
+        f->flags = getBits(&in, FLAG_BITS);
+        if (in.overrun) return false;
+        if (key) {
+            *keyId = id;
+            r->keys[id & (STREAM_KEY_HISTORY - 1)] = *f;
+            r->keyIds[id & (STREAM_KEY_HISTORY - 1)] = id;
+        }
+        return true;
+    }
+    int id = getBits(&in, KEY_ID_BITS);
+    int age = getBits(&in, AGE_BITS);
+    const streamFrame* key = &r->keys[id & (STREAM_KEY_HISTORY - 1)];
+    if (in.overrun || r->keyIds[id & (STREAM_KEY_HISTORY - 1)] != id) return false;
+    predictFields(key, age, fields);
+    for (int i = 0; i < DELTA_FIELDS; i++) {
+        // min and max evaluate their arguments more than once
+        int32_t field = fields[i] + getDifference(&in);
+        fields[i] = min(max(field, 0), (1 << fieldBits[i]) - 1);
+    }
+    setFrameFields(f, fields);
+    f->tick = key->tick + age;
+    if (getBits(&in, 1)) {
+        f->leftScore = getBits(&in, SCORE_BITS);
+        f->rightScore = getBits(&in, SCORE_BITS);
+        f->flags = getBits(&in, FLAG_BITS);
+    } else {
+        f->leftScore = key->leftScore;
+        f->rightScore = key->rightScore;
+        f->flags = key->flags;
+    }
+    return !in.overrun;
+}
@@ -0,0 +1,104 @@
+#ifndef PONG_STREAM_H
+#define PONG_STREAM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pong_core.h"
+
+/*
+ * compact match state for spectators, bit packed and delta encoded against keyframes
+ * a full frame holds every field quantized: positions to 1/8 pixel, velocities to 1/64 pixel per tick
+ * a keyframe is a full frame the receiver keeps, one is due every STREAM_KEY_INTERVAL ticks
+ * a delta frame names a keyframe and holds each field's difference from it, ball positions from where the
+ * keyframe's velocity would have carried the ball, so they cost a bit each until the ball bounces
+ * each difference is a zero bit, or a one bit, its width (4 bits) and its zigzag encoded value
+ * the sender encodes a tick once per keyframe its receivers have acknowledged, not once per receiver,
+ * so the same bytes go out to every spectator holding the same keyframe
+*/
+
+// ticks between keyframes
+#define STREAM_KEY_INTERVAL (30)
+// keyframes both ends keep, a delta can refer to any of them, must be a power of two
+#define STREAM_KEY_HISTORY (4)
+// largest encoded frame in bytes
+#define STREAM_MAX_FRAME (32)
+
+// frame flags
+#define STREAM_IN_PLAY (1)
+// between rounds or before the first serve
+#define STREAM_SERVING (2)
+#define STREAM_OVER (4)
+
+/**
+ * match state as it is streamed, positions and velocities in quantized units
+*/
+typedef struct {
+    uint32_t tick;
+    int32_t ballX, ballY, ballVelocityX, ballVelocityY, leftPaddleY, rightPaddleY;
+    int leftScore, rightScore;
+    int flags;
+} streamFrame;
+
+/**
+ * quantizes a match at a tick, clamping anything outside the encodable range
+*/
+void quantizeFrame(streamFrame* f, const matchState* m, uint32_t tick, int flags);
+
+/**
+ * sets the ball, paddles and scores of a match from a frame
+*/
+void restoreFrame(matchState* m, const streamFrame* f);
+
+/**
+ * the sending end of one match's stream, plain data
+*/
+typedef struct {
+    streamFrame keys[STREAM_KEY_HISTORY];
+    // id of the newest keyframe (ids count up modulo 256) and how many have been made
+    int newestKey;
+    unsigned long keyCount;
+    streamFrame current;
+    bool currentIsKey;
+    // this tick's encodings, against each keyframe slot and in full (the last), made on first use
+    unsigned char encoded[STREAM_KEY_HISTORY + 1][STREAM_MAX_FRAME];
+    int encodedSize[STREAM_KEY_HISTORY + 1];
+    // frames encoded so far
+    unsigned long encodings;
+} streamSender;
+
+void initStreamSender(streamSender* s);
+
+/**
+ * sets the frame sent this tick, making it a keyframe when one is due
+ * returns true if it is a keyframe
+*/
+bool beginStreamTick(streamSender* s, const streamFrame* f);
+
+/**
+ * this tick's frame for a receiver whose newest acknowledged keyframe is acked (-1 for none)
+ * a keyframe tick sends the keyframe to everyone, otherwise receivers get a delta if their keyframe is still
+ * held and a full frame if not
+ * returns the encoded bytes, valid until the next tick, and sets size
+*/
+const unsigned char* streamFrameFor(streamSender* s, int acked, int* size);
+
+/**
+ * the receiving end of one match's stream, plain data
+*/
+typedef struct {
+    streamFrame keys[STREAM_KEY_HISTORY];
+    // id held in each slot, -1 if empty
+    int keyIds[STREAM_KEY_HISTORY];
+} streamReceiver;
+
+void initStreamReceiver(streamReceiver* r);
+
+/**
+ * decodes a frame, keeping it if it is a keyframe
+ * keyId is set to the keyframe's id, which should be acknowledged, or -1 if it isn't one
+ * returns false if the frame is malformed or refers to a keyframe the receiver doesn't hold
+*/
+bool decodeStreamFrame(streamReceiver* r, const unsigned char* p, int size, streamFrame* f, int* keyId);
+
+#endif
@@ -0,0 +1,56 @@
+#include "pong_sync.h"
+
+#include <string.h>
+
+void initTripleBuffer(tripleBuffer* tb, void* a, void* b, void* c) {
+    tb->slots[0] = a;
+    tb->slots[1] = b;
+    tb->slots[2] = c;
+    tb->back = 0;
+    atomic_init(&tb->middle, 1);
+    tb->front = 2;
+}
+
+void* tripleBufferBack(tripleBuffer* tb) {
+    return tb->slots[tb->back];
+}
+
+void publishTripleBuffer(tripleBuffer* tb) {
+    // release so the reader sees the filled slot, acquire so the slot we get back is no longer being read
+    unsigned int old = atomic_exchange_explicit(&tb->middle, tb->back | TRIPLE_BUFFER_FRESH, memory_order_acq_rel);
+    tb->back = old & ~TRIPLE_BUFFER_FRESH;
+}
+
+const void* readTripleBuffer(tripleBuffer* tb) {
+    if (atomic_load_explicit(&tb->middle, memory_order_relaxed) & TRIPLE_BUFFER_FRESH) {
+        unsigned int old = atomic_exchange_explicit(&tb->middle, tb->front, memory_order_acq_rel);
+        tb->front = old & ~TRIPLE_BUFFER_FRESH;
+    }
+    return tb->slots[tb->front];
+}
+
+void initQueue(spscQueue* q, void* storage, size_t itemSize, unsigned int capacity) {
+    q->items = storage;
+    q->itemSize = itemSize;
+    q->capacity = capacity;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+}
+
+bool pushQueue(spscQueue* q, const void* item) {
+    unsigned int tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&q->head, memory_order_acquire);
+    if (tail - head == q->capacity) return false;
+    memcpy(q->items + (tail & (q->capacity - 1)) * q->itemSize, item, q->itemSize);
+    atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool popQueue(spscQueue* q, void* item) {
+    unsigned int head = atomic_load_explicit(&q->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+    if (head == tail) return false;
+    memcpy(item, q->items + (head & (q->capacity - 1)) * q->itemSize, q->itemSize);
+    atomic_store_explicit(&q->head, head + 1, memory_order_release);
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef PONG_SYNC_H
+#define PONG_SYNC_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * lock-free triple buffer for handing the latest state from one writer thread to one reader thread
+ * the writer fills the back slot and publishes it, the reader takes whichever slot was published last
+ * neither side ever waits for the other, states the reader is too slow to see are skipped
+ * slots are caller owned, all three must hold a valid state before the reader starts
+*/
+typedef struct {
+    void* slots[3];
+    // slot between the two sides, with TRIPLE_BUFFER_FRESH set until the reader picks it up
+    atomic_uint middle;
+    // owned by the writer and reader respectively
+    unsigned int back, front;
+} tripleBuffer;
+
+#define TRIPLE_BUFFER_FRESH (4u)
+
+/**
+ * sets up a triple buffer over three caller owned slots
+*/
+void initTripleBuffer(tripleBuffer* tb, void* a, void* b, void* c);
+
+/**
+ * slot the writer may fill, stays valid until publishTripleBuffer
+*/
+void* tripleBufferBack(tripleBuffer* tb);
+
+/**
+ * makes the back slot the latest state and hands the writer a new back slot
+*/
+void publishTripleBuffer(tripleBuffer* tb);
+
+/**
+ * latest published state, stays valid until the reader's next call
+*/
+const void* readTripleBuffer(tripleBuffer* tb);
+
+/**
+ * lock-free single producer single consumer ring of fixed size items
+ * capacity must be a power of two, storage is caller owned and holds capacity items
+*/
+typedef struct {
+    unsigned char* items;
+    size_t itemSize;
+    unsigned int capacity;
+    // free running counters, only the producer advances tail and only the consumer advances head
+    atomic_uint head, tail;
+} spscQueue;
+
+/**
+ * sets up an empty queue over caller owned storage
+*/
+void initQueue(spscQueue* q, void* storage, size_t itemSize, unsigned int capacity);
+
+/**
+ * copies an item onto the queue, producer side
+ * returns false if the queue is full
+*/
+bool pushQueue(spscQueue* q, const void* item);
+
+/**
+ * copies the oldest item off the queue, consumer side
+ * returns false if the queue is empty
+*/
+bool popQueue(spscQueue* q, void* item);
+
+#endif
@@ -0,0 +1,317 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "pong_core.h"
+
+#define MAX_ENTRANTS (64)
+#define NAME_LENGTH (32)
+#define DEFAULT_ROUNDS (10)
+#define ELO_BASE (1500.)
+#define ELO_FIT_ITERATIONS (1000)
+
+/**
+ * one computer configuration entered into the tournament
+*/
+typedef struct {
+    char name[NAME_LENGTH];
+    computerConfig config;
+} entrant;
+
+/**
+ * a single scheduled match and its outcome
+*/
+typedef struct {
+    int left, right;
+    unsigned char leftScore, rightScore;
+    // false if the match hit MAX_MATCH_TICKS, scored as a draw
+    bool finished;
+} fixture;
+
+/**
+ * a worker's share of the fixture list, [begin, end) still to be played
+ * owner takes from the front, thieves take the back half
+*/
+typedef struct {
+    pthread_mutex_t lock;
+    unsigned long begin, end;
+} workQueue;
+
+entrant entrants[MAX_ENTRANTS];
+int entrantCount = 0;
+
+fixture* fixtures;
+unsigned long fixtureCount;
+unsigned int tournamentSeed;
+
+workQueue* queues;
+int workerCount;
+
+/**
+ * reads entrants from a config file
+ * one entrant per line: name flat top bottom aggressive easy erratic_up erratic_down tolerance
+ * blank lines and lines starting with # are skipped
+ * returns false on a malformed file
+*/
+bool readEntrants(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    char line[256];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineNumber++;
+        char* start = line + strspn(line, " \t\r\n");
+        if (*start == '\0' || *start == '#') continue;
+        if (entrantCount == MAX_ENTRANTS) {
+            fprintf(stderr, "%s: more than %d entrants\n", path, MAX_ENTRANTS);
+            fclose(f);
+            return false;
+        }
+        entrant* e = &entrants[entrantCount];
+        int* w = e->config.shotWeights;
+        int n = sscanf(start, "%31s %d %d %d %d %d %d %d %lf", e->name,
+                &w[FLAT], &w[TOP], &w[BOTTOM], &w[AGGRESSIVE], &w[EASY], &w[ERRATIC_UP], &w[ERRATIC_DOWN],
+                &e->config.aimingTolerance);
+        if (n != 9) {
+            fprintf(stderr, "%s:%d: expected name, 7 shot weights and a tolerance\n", path, lineNumber);
+            fclose(f);
+            return false;
+        }
+        entrantCount++;
+    }
+    fclose(f);
+    return true;
+}
+
+/**
+ * plays fixture i to completion
+ * the match is seeded from its index alone so results do not depend on which thread plays it
+*/
+void playFixture(unsigned long i) {
+    fixture* fx = &fixtures[i];
+    matchState m;
+    initMatch(&m, tournamentSeed + i);
+    m.leftConfig = entrants[fx->left].config;
+    m.rightConfig = entrants[fx->right].config;
+    serveBall(&m);
+    fx->finished = false;
+    for (unsigned long t = 0; t < MAX_MATCH_TICKS; t++) {
+        direction left = leftComputerController(&m);
+        direction right = rightComputerController(&m);
+        matchEvent e = stepMatch(&m, left, right);
+        if (e == LEFT_WIN || e == RIGHT_WIN) {
+            fx->finished = true;
+            break;
+        }
+        if (e != NO_EVENT) serveBall(&m);
+    }
+    fx->leftScore = m.leftScore;
+    fx->rightScore = m.rightScore;
+}
+
+/**
+ * takes the next fixture from the worker's own queue
+ * returns false when the queue is empty
+*/
+bool popFixture(workQueue* q, unsigned long* i) {
+    pthread_mutex_lock(&q->lock);
+    bool found = q->begin < q->end;
+    if (found) *i = q->begin++;
+    pthread_mutex_unlock(&q->lock);
+    return found;
+}
+
+/**
+ * moves the back half of another worker's queue into the thief's queue
+ * returns false when every other queue is empty
+*/
+bool stealFixtures(int thief) {
+    for (int k = 1; k < workerCount; k++) {
+        workQueue* victim = &queues[(thief + k) % workerCount];
+        pthread_mutex_lock(&victim->lock);
+        if (victim->begin >= victim->end) {
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+        unsigned long split = victim->end - (victim->end - victim->begin + 1) / 2;
+        unsigned long end = victim->end;
+        victim->end = split;
+        pthread_mutex_unlock(&victim->lock);
+
+        workQueue* own = &queues[thief];
+        pthread_mutex_lock(&own->lock);
+        own->begin = split;
+        own->end = end;
+        pthread_mutex_unlock(&own->lock);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * worker thread, plays its own fixtures then steals until nothing is left
+*/
+void* worker(void* arg) {
+    int id = (int) (long) arg;
+    unsigned long i;
+    do {
+        while (popFixture(&queues[id], &i)) playFixture(i);
+    } while (stealFixtures(id));
+    return NULL;
+}
+
+/**
+ * fits Bradley-Terry strengths to the match results and converts them to an Elo scale
+ * independent of the order matches were played in
+*/
+void fitRatings(const double* wins, const double* games, double* rating) {
+    double strength[MAX_ENTRANTS];
+    for (int i = 0; i < entrantCount; i++) strength[i] = 1;
+    for (int iter = 0; iter < ELO_FIT_ITERATIONS; iter++) {
+        double logSum = 0;
+        for (int i = 0; i < entrantCount; i++) {
+            double totalWins = 0, denominator = 0;
+            for (int j = 0; j < entrantCount; j++) {
+                if (i == j) continue;
+                // half a win each way keeps undefeated or winless entrants finite
+                totalWins += wins[i * MAX_ENTRANTS + j] + .5;
+                denominator += (games[i * MAX_ENTRANTS + j] + 1) / (strength[i] + strength[j]);
+            }
+            strength[i] = totalWins / denominator;
+            logSum += log(strength[i]);
+        }
+        // normalize so the geometric mean stays at 1
+        double scale = exp(logSum / entrantCount);
+        for (int i = 0; i < entrantCount; i++) strength[i] /= scale;
+    }
+    for (int i = 0; i < entrantCount; i++) rating[i] = ELO_BASE + 400. * log10(strength[i]);
+}
+
+/**
+ * round robin tournament between computer configurations
+ * usage: pong-tournament [-j threads] [-r rounds] [-s seed] entrants-file
+ * every ordered pair of entrants plays rounds matches, so each pairing is played from both sides
+ * matches still going after MAX_MATCH_TICKS count as draws
+*/
+int main(int argc, char** argv) {
+    int rounds = DEFAULT_ROUNDS;
+    workerCount = sysconf(_SC_NPROCESSORS_ONLN);
+    tournamentSeed = time(NULL);
+    int opt;
+    while ((opt = getopt(argc, argv, "j:r:s:")) != -1) {
+        switch (opt) {
+            case 'j':
+                workerCount = atoi(optarg);
+                break;
+            case 'r':
+                rounds = atoi(optarg);
+                break;
+            case 's':
+                tournamentSeed = strtoul(optarg, NULL, 10);
+                break;
+            default:
+                optind = argc;
+                break;
+        }
+    }
+    if (optind != argc - 1 || workerCount < 1 || rounds < 1) {
+        fprintf(stderr, "usage: %s [-j threads] [-r rounds] [-s seed] entrants-file\n", argv[0]);
+        fprintf(stderr, "entrant lines: name flat top bottom aggressive easy erratic_up erratic_down tolerance\n");
+        return 1;
+    }
+    if (!readEntrants(argv[optind])) return 1;
+    if (entrantCount < 2) {
+        fprintf(stderr, "need at least two entrants\n");
+        return 1;
+    }
+
+    fixtureCount = (unsigned long) entrantCount * (entrantCount - 1) * rounds;
+    fixtures = malloc(fixtureCount * sizeof(fixture));
+    queues = malloc(workerCount * sizeof(workQueue));
+    pthread_t* threads = malloc(workerCount * sizeof(pthread_t));
+    if (!fixtures || !queues || !threads) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    unsigned long n = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < entrantCount; i++) {
+            for (int j = 0; j < entrantCount; j++) {
+                if (i == j) continue;
+                fixtures[n].left = i;
+                fixtures[n].right = j;
+                n++;
+            }
+        }
+    }
+    for (int w = 0; w < workerCount; w++) {
+        pthread_mutex_init(&queues[w].lock, NULL);
+        queues[w].begin = fixtureCount * w / workerCount;
+        queues[w].end = fixtureCount * (w + 1) / workerCount;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int w = 0; w < workerCount; w++) pthread_create(&threads[w], NULL, worker, (void*) (long) w);
+    for (int w = 0; w < workerCount; w++) pthread_join(threads[w], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = end.tv_sec - start.tv_sec + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    // tally in fixture order so the report is the same for any thread count
+    static double wins[MAX_ENTRANTS * MAX_ENTRANTS], games[MAX_ENTRANTS * MAX_ENTRANTS];
+    unsigned long won[MAX_ENTRANTS] = {0}, lost[MAX_ENTRANTS] = {0}, drawn[MAX_ENTRANTS] = {0};
+    unsigned long pointsFor[MAX_ENTRANTS] = {0}, pointsAgainst[MAX_ENTRANTS] = {0};
+    for (unsigned long i = 0; i < fixtureCount; i++) {
+        fixture* fx = &fixtures[i];
+        games[fx->left * MAX_ENTRANTS + fx->right]++;
+        games[fx->right * MAX_ENTRANTS + fx->left]++;
+        if (fx->finished) {
+            int winner = fx->leftScore > fx->rightScore ? fx->left : fx->right;
+            int loser = winner == fx->left ? fx->right : fx->left;
+            wins[winner * MAX_ENTRANTS + loser]++;
+            won[winner]++;
+            lost[loser]++;
+        } else {
+            wins[fx->left * MAX_ENTRANTS + fx->right] += .5;
+            wins[fx->right * MAX_ENTRANTS + fx->left] += .5;
+            drawn[fx->left]++;
+            drawn[fx->right]++;
+        }
+        pointsFor[fx->left] += fx->leftScore;
+        pointsAgainst[fx->left] += fx->rightScore;
+        pointsFor[fx->right] += fx->rightScore;
+        pointsAgainst[fx->right] += fx->leftScore;
+    }
+    double rating[MAX_ENTRANTS];
+    fitRatings(wins, games, rating);
+
+    int order[MAX_ENTRANTS];
+    for (int i = 0; i < entrantCount; i++) order[i] = i;
+    // insertion sort by rating, ties keep file order
+    for (int i = 1; i < entrantCount; i++) {
+        int o = order[i], j = i;
+        for (; j > 0 && rating[order[j - 1]] < rating[o]; j--) order[j] = order[j - 1];
+        order[j] = o;
+    }
+
+    printf("seed %u, %d entrants, %lu matches on %d threads in %.3f s\n", tournamentSeed, entrantCount, fixtureCount, workerCount, elapsed);
+    printf("rank  %-*s  rating    won   lost  drawn    for  against\n", NAME_LENGTH - 1, "name");
+    for (int r = 0; r < entrantCount; r++) {
+        int i = order[r];
+        printf("%4d  %-*s  %6.1f  %5lu  %5lu  %5lu  %5lu  %7lu\n", r + 1, NAME_LENGTH - 1, entrants[i].name, rating[i],
+                won[i], lost[i], drawn[i], pointsFor[i], pointsAgainst[i]);
+    }
+
+    for (int w = 0; w < workerCount; w++) pthread_mutex_destroy(&queues[w].lock);
+    free(threads);
+    free(queues);
+    free(fixtures);
+    return 0;
+}
@@ -0,0 +1,180 @@
+#include "pong_trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+// events per chunk of a thread's buffer, chunks are chained as they fill
+#define TRACE_CHUNK_EVENTS (16384)
+
+/**
+ * one recorded event, phase is the chrome trace ph field
+*/
+typedef struct {
+    const char* name;
+    const char* argName;
+    long arg;
+    double timestamp;
+    char phase;
+} traceEvent;
+
+typedef struct traceChunk {
+    traceEvent events[TRACE_CHUNK_EVENTS];
+    // events filled so far, published with release so the exit handler only reads finished events
+    atomic_int count;
+    _Atomic(struct traceChunk*) next;
+} traceChunk;
+
+/**
+ * one thread's events
+*/
+typedef struct traceBuffer {
+    int tid;
+    const char* threadName;
+    traceChunk* first;
+    traceChunk* last;
+    struct traceBuffer* next;
+} traceBuffer;
+
+static atomic_bool tracing = false;
+static FILE* traceFile;
+static double traceStart;
+
+// every thread's buffer, only locked when a thread records its first event
+static pthread_mutex_t buffersLock = PTHREAD_MUTEX_INITIALIZER;
+static traceBuffer* buffers = NULL;
+static int nextTid = 1;
+
+static __thread traceBuffer* localBuffer = NULL;
+
+/**
+ * microseconds on the monotonic clock
+*/
+static double traceClock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/**
+ * chunk with room for one more event
+*/
+static traceChunk* newChunk() {
+    traceChunk* c = malloc(sizeof(traceChunk));
+    if (!c) return NULL;
+    atomic_init(&c->count, 0);
+    atomic_init(&c->next, NULL);
+    return c;
+}
+
+/**
+ * the calling thread's buffer, registered on first use
+*/
+static traceBuffer* threadBuffer() {
+    if (localBuffer) return localBuffer;
+    traceBuffer* b = malloc(sizeof(traceBuffer));
+    traceChunk* c = newChunk();
+    if (!b || !c) {
+        free(b);
+        free(c);
+        return NULL;
+    }
+    b->threadName = NULL;
+    b->first = b->last = c;
+    pthread_mutex_lock(&buffersLock);
+    b->tid = nextTid++;
+    b->next = buffers;
+    buffers = b;
+    pthread_mutex_unlock(&buffersLock);
+    localBuffer = b;
+    return b;
+}
+
+/**
+ * appends an event to the calling thread's buffer, dropped if memory runs out
+*/
+static void record(char phase, const char* name, const char* argName, long arg) {
+    if (!atomic_load_explicit(&tracing, memory_order_relaxed)) return;
+    traceBuffer* b = threadBuffer();
+    if (!b) return;
+    traceChunk* c = b->last;
+    int n = atomic_load_explicit(&c->count, memory_order_relaxed);
+    if (n == TRACE_CHUNK_EVENTS) {
+        traceChunk* fresh = newChunk();
+        if (!fresh) return;
+        atomic_store_explicit(&c->next, fresh, memory_order_release);
+        b->last = c = fresh;
+        n = 0;
+    }
+    c->events[n] = (traceEvent) {name, argName, arg, traceClock() - traceStart, phase};
+    atomic_store_explicit(&c->count, n + 1, memory_order_release);
+}
+
+/**
+ * writes every thread's events, installed with atexit
+ * threads still running may keep recording, only events finished before this point are written
+*/
+static void writeTrace() {
+    atomic_store(&tracing, false);
+    pthread_mutex_lock(&buffersLock);
+    fprintf(traceFile, "{\"traceEvents\":[\n");
+    bool first = true;
+    for (traceBuffer* b = buffers; b; b = b->next) {
+        if (b->threadName) {
+            fprintf(traceFile, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",\n", b->tid, b->threadName);
+            first = false;
+        }
+        for (traceChunk* c = b->first; c; c = atomic_load_explicit(&c->next, memory_order_acquire)) {
+            int n = atomic_load_explicit(&c->count, memory_order_acquire);
+            for (int i = 0; i < n; i++) {
+                const traceEvent* e = &c->events[i];
+                fprintf(traceFile, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d",
+                        first ? "" : ",\n", e->name, e->phase, e->timestamp, b->tid);
+                if (e->phase == 'i') fprintf(traceFile, ",\"s\":\"t\"");
+                if (e->argName) fprintf(traceFile, ",\"args\":{\"%s\":%ld}", e->argName, e->arg);
+                fputc('}', traceFile);
+                first = false;
+            }
+        }
+    }
+    fprintf(traceFile, "\n]}\n");
+    pthread_mutex_unlock(&buffersLock);
+    fclose(traceFile);
+}
+
+bool startTrace(const char* path) {
+    traceFile = fopen(path, "w");
+    if (!traceFile) {
+        perror(path);
+        return false;
+    }
+    traceStart = traceClock();
+    atexit(writeTrace);
+    atomic_store(&tracing, true);
+    return true;
+}
+
+void traceThreadName(const char* name) {
+    if (!atomic_load_explicit(&tracing, memory_order_relaxed)) return;
+    traceBuffer* b = threadBuffer();
+    if (b) b->threadName = name;
+}
+
+void traceBegin(const char* name) {
+    record('B', name, NULL, 0);
+}
+
+void traceEnd(const char* name) {
+    record('E', name, NULL, 0);
+}
+
+void traceEndArg(const char* name, const char* argName, long value) {
+    record('E', name, argName, value);
+}
+
+void traceInstant(const char* name) {
+    record('i', name, NULL, 0);
+}
@@ -0,0 +1,38 @@
+#ifndef PONG_TRACE_H
+#define PONG_TRACE_H
+
+#include <stdbool.h>
+
+/**
+ * starts recording trace events, written to path in chrome trace event format when the program exits
+ * every thread appends to its own buffer, nothing is shared on the recording path
+ * returns false if the file can't be created
+*/
+bool startTrace(const char* path);
+
+/**
+ * names the calling thread in the trace
+*/
+void traceThreadName(const char* name);
+
+/**
+ * opens a span on the calling thread, name must be a string literal (only the pointer is kept)
+*/
+void traceBegin(const char* name);
+
+/**
+ * closes the innermost open span
+*/
+void traceEnd(const char* name);
+
+/**
+ * closes the innermost open span and attaches one integer argument to it
+*/
+void traceEndArg(const char* name, const char* argName, long value);
+
+/**
+ * marks a point in time on the calling thread
+*/
+void traceInstant(const char* name);
+
+#endif
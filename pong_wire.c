@@ -0,0 +1,164 @@
+#include "pong_wire.h"
+
+#include <string.h>
+
+#define WIRE_MAGIC "PS"
+
+// low level encoding
+
+static unsigned char* putInt(unsigned char* p, uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) *p++ = v >> (8 * i) & 0xff;
+    return p;
+}
+
+static uint32_t getInt(const unsigned char* p, int bytes) {
+    uint32_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint32_t) p[i] << (8 * i);
+    return v;
+}
+
+static unsigned char* putFloat(unsigned char* p, float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return putInt(p, bits, 4);
+}
+
+static float getFloat(const unsigned char* p) {
+    uint32_t bits = getInt(p, 4);
+    float x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+/**
+ * size of each entry of a message type, 0 for unknown types
+*/
+static int entrySize(int type) {
+    switch (type) {
+        case JOIN_MESSAGE:
+            return 0;
+        case SEATS_MESSAGE:
+            return WIRE_SEAT_SIZE;
+        case INPUTS_MESSAGE:
+            return WIRE_INPUT_SIZE;
+        case STATES_MESSAGE:
+            return WIRE_STATE_SIZE;
+        case WATCH_MESSAGE:
+            return WIRE_WATCH_SIZE;
+        case FRAMES_MESSAGE:
+            return WIRE_FRAME_HEADER_SIZE;
+        case ACKS_MESSAGE:
+            return WIRE_ACK_SIZE;
+    }
+    return -1;
+}
+
+unsigned char* putWireHeader(unsigned char* p, wireMessage type, int count) {
+    memcpy(p, WIRE_MAGIC, 2);
+    p[2] = type;
+    return putInt(p + 3, count, 2);
+}
+
+void setWireCount(unsigned char* packet, int count) {
+    putInt(packet + 3, count, 2);
+}
+
+bool getWireHeader(const unsigned char* p, int size, wireMessage* type, int* count) {
+    if (size < WIRE_HEADER_SIZE || memcmp(p, WIRE_MAGIC, 2) != 0) return false;
+    int entry = entrySize(p[2]);
+    if (entry < 0) return false;
+    *type = p[2];
+    *count = getInt(p + 3, 2);
+    return size >= WIRE_HEADER_SIZE + *count * entry;
+}
+
+unsigned char* putWireSeat(unsigned char* p, wireSeat s) {
+    p = putInt(p, s.match, 4);
+    *p++ = s.side;
+    return p;
+}
+
+const unsigned char* getWireSeat(const unsigned char* p, wireSeat* s) {
+    s->match = getInt(p, 4);
+    s->side = p[4] != 0;
+    return p + WIRE_SEAT_SIZE;
+}
+
+unsigned char* putWireInput(unsigned char* p, wireInput in) {
+    p = putWireSeat(p, in.seat);
+    *p++ = in.input;
+    return p;
+}
+
+const unsigned char* getWireInput(const unsigned char* p, wireInput* in) {
+    p = getWireSeat(p, &in->seat);
+    in->input = *p <= STATIC ? (direction) *p : STATIC;
+    return p + 1;
+}
+
+unsigned char* putWireState(unsigned char* p, const wireState* s) {
+    p = putInt(p, s->match, 4);
+    p = putInt(p, s->tick, 4);
+    p = putFloat(p, s->ballX);
+    p = putFloat(p, s->ballY);
+    p = putFloat(p, s->ballVelocityX);
+    p = putFloat(p, s->ballVelocityY);
+    p = putFloat(p, s->leftPaddleY);
+    p = putFloat(p, s->rightPaddleY);
+    *p++ = s->leftScore;
+    *p++ = s->rightScore;
+    *p++ = s->flags;
+    return p;
+}
+
+const unsigned char* getWireState(const unsigned char* p, wireState* s) {
+    s->match = getInt(p, 4);
+    s->tick = getInt(p + 4, 4);
+    s->ballX = getFloat(p + 8);
+    s->ballY = getFloat(p + 12);
+    s->ballVelocityX = getFloat(p + 16);
+    s->ballVelocityY = getFloat(p + 20);
+    s->leftPaddleY = getFloat(p + 24);
+    s->rightPaddleY = getFloat(p + 28);
+    s->leftScore = p[32];
+    s->rightScore = p[33];
+    s->flags = p[34];
+    return p + WIRE_STATE_SIZE;
+}
+
+unsigned char* putWireAck(unsigned char* p, wireAck a) {
+    p = putInt(p, a.match, 4);
+    *p++ = a.key;
+    return p;
+}
+
+const unsigned char* getWireAck(const unsigned char* p, wireAck* a) {
+    a->match = getInt(p, 4);
+    a->key = p[4];
+    return p + WIRE_ACK_SIZE;
+}
+
+unsigned char* putWireMatch(unsigned char* p, uint32_t match) {
+    return putInt(p, match, 4);
+}
+
+const unsigned char* getWireMatch(const unsigned char* p, uint32_t* match) {
+    *match = getInt(p, 4);
+    return p + WIRE_WATCH_SIZE;
+}
+
+unsigned char* putWireFrame(unsigned char* p, uint32_t match, const unsigned char* frame, int size) {
+    p = putInt(p, match, 4);
+    *p++ = size;
+    memcpy(p, frame, size);
+    return p + size;
+}
+
+const unsigned char* getWireFrame(const unsigned char* p, const unsigned char* end, uint32_t* match,
+        const unsigned char** frame, int* size) {
+    if (end - p < WIRE_FRAME_HEADER_SIZE || end - p < WIRE_FRAME_HEADER_SIZE + p[4]) return NULL;
+    *match = getInt(p, 4);
+    *size = p[4];
+    *frame = p + WIRE_FRAME_HEADER_SIZE;
+    return *frame + *size;
+}
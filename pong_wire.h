@@ -0,0 +1,120 @@
+#ifndef PONG_WIRE_H
+#define PONG_WIRE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pong_core.h"
+
+/*
+ * protocol between pong-server and its clients, one UDP datagram per message
+ * every message is a header ("PS", type byte, entry count, 2 bytes) followed by count fixed size entries,
+ * integers and floats are little endian
+ *   join      client to server, asks for count seats; pairs of seats asked for together share a match
+ *   seats     server to client, the seats given: match id (4), side (1, 0 is left)
+ *   inputs    client to server, a direction for each seat: match id (4), side (1), direction (1)
+ *   states    server to client, one entry per match the client has a seat in, every tick:
+ *             match id (4), match tick (4), ball x, y, velocity x, y, left and right paddle y (floats),
+ *             left and right score (1 each), flags (1: in play, 2: match over)
+ *   watch     client to server, matches to spectate: match id (4)
+ *   frames    server to client, one entry per match spectated, every tick: match id (4), length (1), then a
+ *             pong_stream.h frame of that length
+ *   acks      client to server, keyframes received: match id (4), keyframe id (1)
+ * a client address can hold any number of seats and spectate any number of matches, the server packs all of a
+ * client's states or frames for a tick into as few datagrams as fit
+ * a match id carries the server worker hosting it in its top 8 bits, players only get seats on the worker their
+ * address is routed to, watch and ack entries reaching another worker are passed on to the hosting one
+*/
+
+#define WIRE_PORT (7100)
+// largest datagram either side sends, fits an ethernet frame
+#define WIRE_MAX_PACKET (1400)
+#define WIRE_HEADER_SIZE (5)
+#define WIRE_SEAT_SIZE (5)
+#define WIRE_INPUT_SIZE (6)
+#define WIRE_STATE_SIZE (35)
+#define WIRE_WATCH_SIZE (4)
+#define WIRE_ACK_SIZE (5)
+// size of a frame entry before its data
+#define WIRE_FRAME_HEADER_SIZE (5)
+#define WIRE_WORKER_SHIFT (24)
+#define WIRE_IN_PLAY (1)
+#define WIRE_OVER (2)
+
+typedef enum {
+    JOIN_MESSAGE = 1, SEATS_MESSAGE, INPUTS_MESSAGE, STATES_MESSAGE, WATCH_MESSAGE, FRAMES_MESSAGE, ACKS_MESSAGE
+} wireMessage;
+
+/**
+ * a player's place in a match
+*/
+typedef struct {
+    uint32_t match;
+    int side;
+} wireSeat;
+
+typedef struct {
+    wireSeat seat;
+    direction input;
+} wireInput;
+
+/**
+ * what a player sees of a match after a tick
+*/
+typedef struct {
+    uint32_t match, tick;
+    float ballX, ballY, ballVelocityX, ballVelocityY, leftPaddleY, rightPaddleY;
+    int leftScore, rightScore;
+    int flags;
+} wireState;
+
+typedef struct {
+    uint32_t match;
+    int key;
+} wireAck;
+
+/**
+ * entries of a given size that fit in one datagram
+*/
+#define WIRE_ENTRIES(size) ((WIRE_MAX_PACKET - WIRE_HEADER_SIZE) / (size))
+
+/**
+ * writes a message header, returns the end of it
+*/
+unsigned char* putWireHeader(unsigned char* p, wireMessage type, int count);
+
+/**
+ * updates the entry count of a message already started
+*/
+void setWireCount(unsigned char* packet, int count);
+
+/**
+ * checks a datagram's header, type and count receive it
+ * returns false if it isn't a message or is too short for its entries (frames are checked by getWireFrame)
+*/
+bool getWireHeader(const unsigned char* p, int size, wireMessage* type, int* count);
+
+unsigned char* putWireSeat(unsigned char* p, wireSeat s);
+const unsigned char* getWireSeat(const unsigned char* p, wireSeat* s);
+unsigned char* putWireInput(unsigned char* p, wireInput in);
+const unsigned char* getWireInput(const unsigned char* p, wireInput* in);
+unsigned char* putWireState(unsigned char* p, const wireState* s);
+const unsigned char* getWireState(const unsigned char* p, wireState* s);
+unsigned char* putWireAck(unsigned char* p, wireAck a);
+const unsigned char* getWireAck(const unsigned char* p, wireAck* a);
+unsigned char* putWireMatch(unsigned char* p, uint32_t match);
+const unsigned char* getWireMatch(const unsigned char* p, uint32_t* match);
+
+/**
+ * writes a frame entry, size is at most 255
+*/
+unsigned char* putWireFrame(unsigned char* p, uint32_t match, const unsigned char* frame, int size);
+
+/**
+ * reads a frame entry, frame points into the message
+ * returns the next entry, or NULL if the entry runs past end
+*/
+const unsigned char* getWireFrame(const unsigned char* p, const unsigned char* end, uint32_t* match,
+        const unsigned char** frame, int* size);
+
+#endif